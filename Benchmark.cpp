@@ -0,0 +1,234 @@
+// Standard Libraries
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+#include <QtMath>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexSparseMatrix.hpp"
+#include "HexSparseMatrixBuilder.hpp"
+
+static volatile qreal Sink = 0.; // Results are written here, so that the compiler can't drop the work that produces them.
+
+/* Random matrices are always drawn from the same seed, so that runs on
+ * different layouts, or on different commits, time the very same matrix.
+ */
+static HexSparseMatrix GetRandomMatrix(qint32 numberOfRows, qint32 numberOfColumns, qint32 valuesPerRow, quint32 seed)
+{
+	auto generator = std::mt19937(seed);
+	auto columns = std::uniform_int_distribution<qint32>(0, numberOfColumns - 1);
+	auto values = std::uniform_real_distribution<qreal>(-1., 1.);
+	auto builder = HexSparseMatrixBuilder(numberOfRows, numberOfColumns);
+	
+	builder.reserve(static_cast<qint64>(numberOfRows)*valuesPerRow);
+	
+	for (auto row = 0; row < numberOfRows; ++row)
+		for (auto count = 0; count < valuesPerRow; ++count)
+			builder.addValue(row, columns(generator), values(generator));
+	
+	return builder.build();
+}
+
+/* The sparse scalar product of two rows, merging their columns, which is
+ * the kernel Gram-Schmidt spends its time in. It used to be the Scalar of
+ * HexSparseMatrix, before the block Gram-Schmidt folded it into its panels.
+ */
+template<typename Matrix>
+static qreal Scalar(const Matrix& matrix, qint32 row1, qint32 row2)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	auto index1 = rowOffsets[row1];
+	auto index2 = rowOffsets[row2];
+	auto scalar = 0.;
+	
+	while (index1 < rowOffsets[row1 + 1] and index2 < rowOffsets[row2 + 1])
+	{
+		const auto column1 = pairs[index1].column;
+		const auto column2 = pairs[index2].column;
+		
+		if (column1 == column2)
+			scalar += static_cast<qreal>(pairs[index1++].value)*static_cast<qreal>(pairs[index2++].value);
+		else if (column1 < column2)
+			++index1;
+		else
+			++index2;
+	}
+	
+	return scalar;
+}
+
+/* Best of a few runs, in milliseconds, which is less noisy than the mean
+ * on a machine that does anything else.
+ */
+template<typename Function>
+static qreal Time(qint32 numberOfRuns, Function function)
+{
+	auto best = 0.;
+	
+	for (auto run = 0; run < numberOfRuns; ++run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const auto duration = std::chrono::duration<qreal, std::milli>(std::chrono::steady_clock::now() - start).count();
+		
+		best = (run == 0 ? duration : qMin(best, duration));
+	}
+	
+	return best;
+}
+
+/* The comment above HexBasicColumnValuePair claims that interleaving
+ * values and columns is the efficient layout. This times the kernels that
+ * walk the pairs on the same matrix stored with every layout.
+ */
+template<typename Layout>
+static void BenchmarkLayout(const char* name, const HexSparseMatrix& reference, const HexSparseMatrix& qrReference)
+{
+	using Matrix = HexBasicSparseMatrix<qreal, qint32, Layout>;
+	
+	const auto matrix = Matrix(reference);
+	const auto qrMatrix = Matrix(qrReference);
+	const auto numberOfRows = matrix.getNumberOfRows();
+	
+	auto x = std::vector<qreal>(matrix.getNumberOfColumns(), 1.);
+	auto y = std::vector<qreal>();
+	auto sum = 0.;
+	
+	const auto spmv = Time(10, [&](void) { matrix.multiply(x, y); });
+	const auto transposed = Time(5, [&](void) { sum += static_cast<qreal>(matrix.transposed().getPairs().size()); });
+	const auto scalar = Time(5, [&](void)
+	{
+		for (auto row = 0; row + 1 < numberOfRows; ++row)
+			sum += Scalar(matrix, row, row + 1);
+	});
+	
+	const auto gramSchmidt = Time(1, [&](void) { sum += static_cast<qreal>(qrMatrix.getDecomposition(HexQrMethod::GramSchmidt).triangular.getPairs().size()); });
+	const auto householder = Time(1, [&](void) { sum += static_cast<qreal>(qrMatrix.getDecomposition(HexQrMethod::Householder).triangular.getPairs().size()); });
+	
+	const auto bytesPerValue = (std::is_same_v<Layout, HexSplitLayout> ? sizeof(qreal) + sizeof(qint32) : sizeof(typename Matrix::Container::value_type));
+	const auto numberOfValues = static_cast<qreal>(matrix.getPairs().size());
+	
+	const auto flops = 2.*numberOfValues; // One multiplication and one addition per value.
+	const auto bytes = numberOfValues*static_cast<qreal>(bytesPerValue) + static_cast<qreal>((numberOfRows + 1)*sizeof(qint32) + x.size()*sizeof(qreal) + y.size()*sizeof(qreal)); // Every array once, x as if it stayed in cache.
+	
+	Sink = sum + y.front();
+	std::printf("%-12s %4zu B %10.2f %8.2f %8.2f %12.2f %10.2f %14.2f %14.2f\n", name, bytesPerValue, spmv, flops/spmv*1e-6, bytes/spmv*1e-6, transposed, scalar, gramSchmidt, householder);
+}
+
+/* Mixed precision stores floats but sums in double. This times the
+ * bandwidth-bound kernels with both storages, and measures how far the
+ * mixed results are from the all-double ones, in relative 2-norm, next to
+ * those of a product that also sums in float, which is what the double
+ * accumulation is there to avoid.
+ */
+static void BenchmarkMixedPrecision(const HexSparseMatrix& matrix, const HexSparseMatrix& qrMatrix)
+{
+	const auto mixedMatrix = HexMixedSparseMatrix(matrix);
+	const auto& pairs = mixedMatrix.getPairs();
+	const auto& rowOffsets = mixedMatrix.getRowOffsets();
+	
+	auto generator = std::mt19937(3);
+	auto distribution = std::uniform_real_distribution<qreal>(-1., 1.);
+	auto x = std::vector<qreal>(matrix.getNumberOfColumns());
+	
+	for (auto& val : x)
+		val = distribution(generator);
+	
+	const auto mixedX = std::vector<float>(x.cbegin(), x.cend());
+	const auto relativeError = [](const auto& result, const std::vector<qreal>& reference)
+	{
+		auto error = 0.;
+		auto norm = 0.;
+		
+		for (auto index = std::size_t(0); index < reference.size(); ++index)
+		{
+			error += (static_cast<qreal>(result[index]) - reference[index])*(static_cast<qreal>(result[index]) - reference[index]);
+			norm += reference[index]*reference[index];
+		}
+		
+		return qSqrt(error/norm);
+	};
+	
+	auto y = std::vector<qreal>();
+	auto mixedY = std::vector<float>();
+	auto floatY = std::vector<float>(matrix.getNumberOfRows(), 0.f);
+	auto z = std::vector<qreal>();
+	auto mixedZ = std::vector<float>();
+	
+	const auto spmv = Time(10, [&](void) { matrix.multiply(x, y); });
+	const auto mixedSpmv = Time(10, [&](void) { mixedMatrix.multiply(mixedX, mixedY); });
+	const auto spmvT = Time(5, [&](void) { matrix.multiplyTransposed(x, z); });
+	const auto mixedSpmvT = Time(5, [&](void) { mixedMatrix.multiplyTransposed(mixedX, mixedZ); });
+	const auto transposed = Time(5, [&](void) { Sink = static_cast<qreal>(matrix.transposed().getPairs().size()); });
+	const auto mixedTransposed = Time(5, [&](void) { Sink = static_cast<qreal>(mixedMatrix.transposed().getPairs().size()); });
+	
+	for (auto row = 0; row < mixedMatrix.getNumberOfRows(); ++row) // The same product, summed in float.
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+			floatY[row] += pairs[index].value*mixedX[pairs[index].column];
+	
+	std::printf("\n%-22s %10s %10s %16s\n", "Mixed precision", "double", "mixed", "relative error");
+	std::printf("%-22s %10.2f %10.2f %16.2e   (%.2e summed in float)\n", "SpMV", spmv, mixedSpmv, relativeError(mixedY, y), relativeError(floatY, y));
+	std::printf("%-22s %10.2f %10.2f %16.2e\n", "multiplyTransposed", spmvT, mixedSpmvT, relativeError(mixedZ, z));
+	std::printf("%-22s %10.2f %10.2f\n", "transposed", transposed, mixedTransposed);
+	
+	const auto decomposition = qrMatrix.getDecomposition();
+	const auto mixedDecomposition = HexMixedSparseMatrix(qrMatrix).getDecomposition();
+	
+	const auto largestDifference = [](const auto& mixed, const auto& reference) // Relative to the largest coefficient of the reference.
+	{
+		const auto mixedValues = mixed.getDenseMatrix();
+		const auto values = reference.getDenseMatrix();
+		
+		auto difference = 0.;
+		auto largest = 0.;
+		
+		for (auto index = std::size_t(0); index < values.size() and index < mixedValues.size(); ++index)
+		{
+			difference = qMax(difference, qAbs(static_cast<qreal>(mixedValues[index]) - values[index]));
+			largest = qMax(largest, qAbs(values[index]));
+		}
+		
+		return (mixedValues.size() == values.size() ? difference/largest : std::numeric_limits<qreal>::infinity());
+	};
+	
+	std::printf("%-22s %d x %d: Q differs by %.2e, R by %.2e, rank %d against %d\n", "QR (Gram-Schmidt)", qrMatrix.getNumberOfRows(), qrMatrix.getNumberOfColumns(), largestDifference(mixedDecomposition.unitary, decomposition.unitary), largestDifference(mixedDecomposition.triangular, decomposition.triangular), HexMixedSparseMatrix(qrMatrix).getRank(), qrMatrix.getRank());
+}
+
+/* Usage: benchmark [rows [values per row]]. Matrices are square. QR runs
+ * on a smaller matrix, since Gram-Schmidt fills in much more than SpMV.
+ */
+int main(int argc, char* argv[])
+{
+	const auto numberOfRows = (argc > 1 ? std::atoi(argv[1]) : 200000);
+	const auto valuesPerRow = (argc > 2 ? std::atoi(argv[2]) : 15);
+	
+	if (numberOfRows < 2 or valuesPerRow < 1)
+	{
+		std::fprintf(stderr, "Usage: %s [rows [values per row]]\n", argv[0]);
+		return 1;
+	}
+	
+	const auto matrix = GetRandomMatrix(numberOfRows, numberOfRows, valuesPerRow, 1);
+	const auto qrMatrix = GetRandomMatrix(400, 300, 6, 2);
+	
+	std::printf("%d x %d, %zu values; QR on 400 x 300, %zu values. Times in ms, best of several runs.\n\n", numberOfRows, numberOfRows, matrix.getPairs().size(), qrMatrix.getPairs().size());
+	std::printf("SpMV runs on %d thread(s), GFLOP/s and effective GB/s are those of SpMV.\n\n", HexParallel::GetNumberOfThreads(static_cast<qint64>(matrix.getPairs().size())));
+	std::printf("%-12s %6s %10s %8s %8s %12s %10s %14s %14s\n", "Layout", "Pair", "SpMV", "GFLOP/s", "GB/s", "transposed", "Scalar", "QR (GS)", "QR (HH)");
+	
+	BenchmarkLayout<HexInterleavedLayout>("Interleaved", matrix, qrMatrix);
+	BenchmarkLayout<HexPackedLayout>("Packed", matrix, qrMatrix);
+	BenchmarkLayout<HexSplitLayout>("Split", matrix, qrMatrix);
+	BenchmarkMixedPrecision(matrix, GetRandomMatrix(120, 90, 5, 3));
+	
+	return 0;
+}
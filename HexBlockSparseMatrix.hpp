@@ -0,0 +1,567 @@
+#ifndef __HEX_BLOCK_SPARSE_MATRIX_HPP__
+#define __HEX_BLOCK_SPARSE_MATRIX_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrix.hpp"
+
+/* Block size has to be known at compile time for the kernels to be any
+ * good, so detecting it is a separate step: Detect returns the block size
+ * that would take the least memory, or 1 if no block size beats CSR, and
+ * the caller then picks the matching HexBlockSparseMatrix.
+ */
+class HexBlockSize
+{
+	public:
+	
+		static constexpr qint32						MaximumBlockSize = 8;
+		
+		template<typename Matrix> inline static qint32			Detect(const Matrix&, qint32 = MaximumBlockSize);
+		template<typename Matrix> inline static qint64			GetNumberOfBlocks(const Matrix&, qint32);
+};
+
+/* Block sizes are tried from the largest to the smallest, so that a matrix
+ * made of 4×4 blocks isn't mistaken for one made of 2×2 blocks, which would
+ * fit it just as well. Blocks are aligned on multiples of the block size.
+ */
+template<typename Matrix>
+qint32 HexBlockSize::Detect(const Matrix& matrix, qint32 maximumBlockSize)
+{
+	using Pair = typename Matrix::ColumnValuePair;
+	
+	const auto numberOfValues = static_cast<qint64>(matrix.getPairs().size());
+	const auto csrBytes = numberOfValues*static_cast<qint64>(sizeof(Pair)); // Pairs already hold a value and an index each.
+	
+	auto bestBytes = csrBytes;
+	auto bestBlockSize = 1;
+	
+	for (auto blockSize = maximumBlockSize; blockSize > 1; --blockSize)
+	{
+		const auto numberOfBlocks = HexBlockSize::GetNumberOfBlocks(matrix, blockSize);
+		const auto blockBytes = numberOfBlocks*(blockSize*blockSize*static_cast<qint64>(sizeof(Pair::value)) + static_cast<qint64>(sizeof(Pair::column)));
+		
+		if (blockBytes < bestBytes)
+		{
+			bestBytes = blockBytes;
+			bestBlockSize = blockSize;
+		}
+	}
+	
+	return bestBlockSize;
+}
+
+template<typename Matrix>
+qint64 HexBlockSize::GetNumberOfBlocks(const Matrix& matrix, qint32 blockSize)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = static_cast<qint64>(matrix.getNumberOfRows());
+	const auto numberOfBlockColumns = (static_cast<qint64>(matrix.getNumberOfColumns()) + blockSize - 1)/blockSize;
+	
+	auto markers = std::vector<qint64>(numberOfBlockColumns, -1);
+	auto numberOfBlocks = static_cast<qint64>(0);
+	
+	for (auto row = static_cast<qint64>(0); row < numberOfRows; ++row)
+	{
+		const auto blockRow = row/blockSize;
+		
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto blockColumn = pairs[index].column/blockSize;
+			
+			if (markers[blockColumn] != blockRow)
+			{
+				markers[blockColumn] = blockRow;
+				++numberOfBlocks;
+			}
+		}
+	}
+	
+	return numberOfBlocks;
+}
+
+/* This is the BSR format: the matrix is cut into BlockSize × BlockSize
+ * blocks, and only the blocks that hold at least one non-zero value are
+ * stored, each one with a single column index and its values in row-major
+ * order. When the matrix dimensions aren't multiples of BlockSize, the
+ * last blocks are padded with zeroes. Rows and columns are swapped at
+ * block granularity, so their indexes are block indexes.
+ */
+template<qint32 BlockSize, typename Value = qreal, typename Index = qint32>
+class HexBlockSparseMatrix
+{
+	public:
+	
+		using Accumulator = typename HexScalarTraits<Value>::Accumulator;
+		
+		static constexpr qint32							BlockArea = BlockSize*BlockSize;
+		
+	private:
+	
+		std::vector<Value>							blockValues;
+		std::vector<Index>							blockColumns;
+		std::vector<Index>							blockRowOffsets;
+		
+		Index									numberOfRows = 0;
+		Index									numberOfColumns = 0;
+		
+	public:
+	
+		inline									HexBlockSparseMatrix(void);
+		template<typename Layout> inline explicit				HexBlockSparseMatrix(const HexBasicSparseMatrix<Value, Index, Layout>&);
+		
+		inline const std::vector<Index>&					getBlockColumns(void) const;
+		inline const std::vector<Index>&					getBlockRowOffsets(void) const;
+		inline const std::vector<Value>&					getBlockValues(void) const;
+		inline Index								getNumberOfBlockColumns(void) const;
+		inline Index								getNumberOfBlockRows(void) const;
+		inline Index								getNumberOfBlocks(void) const;
+		inline Index								getNumberOfColumns(void) const;
+		inline Index								getNumberOfRows(void) const;
+		inline HexBasicSparseMatrix<Value, Index>				getSparseMatrix(void) const;
+		inline void								multiply(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiply(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline void								swapColumns(Index, Index);
+		inline void								swapRows(Index, Index);
+		inline void								transpose(void);
+		inline HexBlockSparseMatrix						transposed(void) const;
+};
+
+template<qint32 BlockSize, typename Value, typename Index>
+HexBlockSparseMatrix<BlockSize, Value, Index>::HexBlockSparseMatrix(void)
+{
+}
+
+/* Every block row is converted twice, once to count its blocks and once
+ * to fill them, so that the blocks are allocated once with their exact
+ * size. Block rows are split between threads by number of values.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+template<typename Layout>
+HexBlockSparseMatrix<BlockSize, Value, Index>::HexBlockSparseMatrix(const HexBasicSparseMatrix<Value, Index, Layout>& matrix)
+{
+	HexBlockSparseMatrix::numberOfRows = matrix.getNumberOfRows();
+	HexBlockSparseMatrix::numberOfColumns = matrix.getNumberOfColumns();
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfBlockRows = HexBlockSparseMatrix::getNumberOfBlockRows();
+	const auto numberOfBlockColumns = HexBlockSparseMatrix::getNumberOfBlockColumns();
+	
+	HexBlockSparseMatrix::blockRowOffsets.assign(numberOfBlockRows + 1, 0);
+	
+	if (pairs.empty())
+		return;
+	
+	auto blockRowWork = std::vector<Index>(numberOfBlockRows + 1, 0);
+	
+	for (auto blockRow = Index(0); blockRow <= numberOfBlockRows; ++blockRow)
+		blockRowWork[blockRow] = rowOffsets[qMin(blockRow*BlockSize, HexBlockSparseMatrix::numberOfRows)];
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(pairs.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(blockRowWork, numberOfThreads);
+	
+	auto markers = std::vector<std::vector<Index>>(numberOfThreads);
+	auto positions = std::vector<std::vector<Index>>(numberOfThreads);
+	auto touched = std::vector<std::vector<Index>>(numberOfThreads);
+	
+	const auto visit = [&](qint32 thread, Index blockRow, bool fill) // Returns the number of blocks of this block row.
+	{
+		auto& marker = markers[thread];
+		auto& position = positions[thread];
+		auto& blockColumnsOfRow = touched[thread];
+		
+		const auto firstRow = blockRow*BlockSize;
+		const auto lastRow = qMin(firstRow + BlockSize, HexBlockSparseMatrix::numberOfRows);
+		
+		blockColumnsOfRow.clear();
+		
+		for (auto index = rowOffsets[firstRow]; index < rowOffsets[lastRow]; ++index)
+		{
+			const auto blockColumn = pairs[index].column/BlockSize;
+			
+			if (marker[blockColumn] != blockRow)
+			{
+				marker[blockColumn] = blockRow;
+				blockColumnsOfRow.push_back(blockColumn);
+			}
+		}
+		
+		if (not fill)
+			return static_cast<Index>(blockColumnsOfRow.size());
+		
+		std::sort(blockColumnsOfRow.begin(), blockColumnsOfRow.end());
+		auto blockIndex = HexBlockSparseMatrix::blockRowOffsets[blockRow];
+		
+		for (const auto& blockColumn : blockColumnsOfRow)
+		{
+			position[blockColumn] = blockIndex;
+			HexBlockSparseMatrix::blockColumns[blockIndex] = blockColumn;
+			++blockIndex;
+		}
+		
+		for (auto row = firstRow; row < lastRow; ++row)
+		{
+			for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+			{
+				const auto& pr = pairs[index];
+				const auto block = static_cast<qint64>(position[pr.column/BlockSize])*BlockArea;
+				
+				HexBlockSparseMatrix::blockValues[block + (row - firstRow)*BlockSize + pr.column % BlockSize] = pr.value;
+			}
+		}
+		
+		return static_cast<Index>(blockColumnsOfRow.size());
+	};
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		markers[thread].assign(numberOfBlockColumns, -1);
+		positions[thread].assign(numberOfBlockColumns, 0);
+		
+		for (auto blockRow = boundaries[thread]; blockRow < boundaries[thread + 1]; ++blockRow)
+			HexBlockSparseMatrix::blockRowOffsets[blockRow + 1] = visit(thread, blockRow, false);
+	});
+	
+	for (auto blockRow = Index(0); blockRow < numberOfBlockRows; ++blockRow)
+		HexBlockSparseMatrix::blockRowOffsets[blockRow + 1] += HexBlockSparseMatrix::blockRowOffsets[blockRow];
+	
+	HexBlockSparseMatrix::blockColumns.resize(HexBlockSparseMatrix::blockRowOffsets.back());
+	HexBlockSparseMatrix::blockValues.assign(static_cast<std::size_t>(HexBlockSparseMatrix::blockRowOffsets.back())*BlockArea, Value());
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		markers[thread].assign(numberOfBlockColumns, -1); // Both passes visit the same block rows, so the markers have to be reset.
+		
+		for (auto blockRow = boundaries[thread]; blockRow < boundaries[thread + 1]; ++blockRow)
+			visit(thread, blockRow, true);
+	});
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+const std::vector<Index>& HexBlockSparseMatrix<BlockSize, Value, Index>::getBlockColumns(void) const
+{
+	return HexBlockSparseMatrix::blockColumns;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+const std::vector<Index>& HexBlockSparseMatrix<BlockSize, Value, Index>::getBlockRowOffsets(void) const
+{
+	return HexBlockSparseMatrix::blockRowOffsets;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+const std::vector<Value>& HexBlockSparseMatrix<BlockSize, Value, Index>::getBlockValues(void) const
+{
+	return HexBlockSparseMatrix::blockValues;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+Index HexBlockSparseMatrix<BlockSize, Value, Index>::getNumberOfBlockColumns(void) const
+{
+	return (HexBlockSparseMatrix::numberOfColumns + BlockSize - 1)/BlockSize;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+Index HexBlockSparseMatrix<BlockSize, Value, Index>::getNumberOfBlockRows(void) const
+{
+	return (HexBlockSparseMatrix::numberOfRows + BlockSize - 1)/BlockSize;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+Index HexBlockSparseMatrix<BlockSize, Value, Index>::getNumberOfBlocks(void) const
+{
+	return static_cast<Index>(HexBlockSparseMatrix::blockColumns.size());
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+Index HexBlockSparseMatrix<BlockSize, Value, Index>::getNumberOfColumns(void) const
+{
+	return HexBlockSparseMatrix::numberOfColumns;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+Index HexBlockSparseMatrix<BlockSize, Value, Index>::getNumberOfRows(void) const
+{
+	return HexBlockSparseMatrix::numberOfRows;
+}
+
+/* Zeroes stored inside the blocks are dropped, so converting a
+ * HexBasicSparseMatrix back and forth gives the same matrix.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+HexBasicSparseMatrix<Value, Index> HexBlockSparseMatrix<BlockSize, Value, Index>::getSparseMatrix(void) const
+{
+	auto pairs = std::vector<HexBasicColumnValuePair<Value, Index>>();
+	auto rowOffsets = std::vector<Index>(HexBlockSparseMatrix::numberOfRows + 1, 0);
+	
+	pairs.reserve(HexBlockSparseMatrix::blockValues.size());
+	
+	for (auto row = Index(0); row < HexBlockSparseMatrix::numberOfRows; ++row)
+	{
+		const auto blockRow = row/BlockSize;
+		const auto rowInBlock = row % BlockSize;
+		
+		for (auto index = HexBlockSparseMatrix::blockRowOffsets[blockRow]; index < HexBlockSparseMatrix::blockRowOffsets[blockRow + 1]; ++index)
+		{
+			const auto block = HexBlockSparseMatrix::blockValues.cbegin() + static_cast<qint64>(index)*BlockArea + rowInBlock*BlockSize;
+			const auto firstColumn = HexBlockSparseMatrix::blockColumns[index]*BlockSize;
+			
+			for (auto k = 0; k < BlockSize; ++k)
+			{
+				if (block[k] != Value() and firstColumn + k < HexBlockSparseMatrix::numberOfColumns)
+					pairs.emplace_back(block[k], firstColumn + k);
+			}
+		}
+		
+		rowOffsets[row + 1] = static_cast<Index>(pairs.size());
+	}
+	
+	return HexBasicSparseMatrix<Value, Index>(std::move(pairs), std::move(rowOffsets), HexBlockSparseMatrix::numberOfColumns);
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+void HexBlockSparseMatrix<BlockSize, Value, Index>::multiply(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBlockSparseMatrix::multiply(Value(1), x, Value(), y);
+}
+
+/* Same contract as HexBasicSparseMatrix::multiply, y = alpha*A*x + beta*y.
+ * Each block costs one column index for BlockArea values, and its inner
+ * loops have a fixed length, so the compiler unrolls them completely. When
+ * the last block column is padded, x is padded too rather than checking
+ * bounds in the inner loop.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+void HexBlockSparseMatrix<BlockSize, Value, Index>::multiply(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBlockSparseMatrix::numberOfColumns))
+		return;
+	
+	y.resize(HexBlockSparseMatrix::numberOfRows, Value());
+	
+	auto paddedX = std::vector<Value>();
+	auto xData = x.data();
+	
+	if (x.size() < static_cast<std::size_t>(HexBlockSparseMatrix::getNumberOfBlockColumns())*BlockSize)
+	{
+		paddedX.assign(static_cast<std::size_t>(HexBlockSparseMatrix::getNumberOfBlockColumns())*BlockSize, Value());
+		std::copy(x.cbegin(), x.cend(), paddedX.begin());
+		xData = paddedX.data();
+	}
+	
+	const auto accumulatedAlpha = static_cast<Accumulator>(alpha);
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBlockSparseMatrix::blockValues.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(HexBlockSparseMatrix::blockRowOffsets, numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto blockRow = boundaries[thread]; blockRow < boundaries[thread + 1]; ++blockRow)
+		{
+			auto sums = std::array<Accumulator, BlockSize>();
+			
+			for (auto index = HexBlockSparseMatrix::blockRowOffsets[blockRow]; index < HexBlockSparseMatrix::blockRowOffsets[blockRow + 1]; ++index)
+			{
+				const auto block = HexBlockSparseMatrix::blockValues.data() + static_cast<qint64>(index)*BlockArea;
+				const auto xBlock = xData + static_cast<qint64>(HexBlockSparseMatrix::blockColumns[index])*BlockSize;
+				
+				for (auto i = 0; i < BlockSize; ++i)
+				{
+					for (auto j = 0; j < BlockSize; ++j)
+						sums[i] += static_cast<Accumulator>(block[i*BlockSize + j])*static_cast<Accumulator>(xBlock[j]);
+				}
+			}
+			
+			const auto firstRow = blockRow*BlockSize;
+			const auto numberOfRowsInBlock = qMin(static_cast<Index>(BlockSize), HexBlockSparseMatrix::numberOfRows - firstRow);
+			
+			for (auto i = 0; i < numberOfRowsInBlock; ++i)
+				y[firstRow + i] = HexScalarTraits<Value>::UpdateOutput(accumulatedAlpha*sums[i], beta, y[firstRow + i]);
+		}
+	});
+}
+
+/* Swapping a padded block column with a full one would move values
+ * out of the matrix, so the last block column can only be swapped
+ * when the number of columns is a multiple of BlockSize.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+void HexBlockSparseMatrix<BlockSize, Value, Index>::swapColumns(Index blockColumn1, Index blockColumn2)
+{
+	const auto numberOfBlockColumns = HexBlockSparseMatrix::getNumberOfBlockColumns();
+	const auto lastIsPadded = (HexBlockSparseMatrix::numberOfColumns % BlockSize != 0);
+	
+	if (blockColumn1 == blockColumn2 or blockColumn1 < 0 or blockColumn2 < 0)
+		return;
+	
+	if (blockColumn1 >= numberOfBlockColumns or blockColumn2 >= numberOfBlockColumns)
+		return;
+	
+	if (lastIsPadded and (blockColumn1 == numberOfBlockColumns - 1 or blockColumn2 == numberOfBlockColumns - 1))
+		return;
+	
+	if (blockColumn1 > blockColumn2)
+		std::swap(blockColumn1, blockColumn2);
+	
+	const auto valuesOf = [this](Index index) { return HexBlockSparseMatrix::blockValues.begin() + static_cast<qint64>(index)*BlockArea; };
+	
+	for (auto blockRow = Index(0); blockRow < HexBlockSparseMatrix::getNumberOfBlockRows(); ++blockRow) // We have to perform the swap block row by block row.
+	{
+		const auto beg = HexBlockSparseMatrix::blockColumns.begin() + HexBlockSparseMatrix::blockRowOffsets[blockRow];
+		const auto end = HexBlockSparseMatrix::blockColumns.begin() + HexBlockSparseMatrix::blockRowOffsets[blockRow + 1];
+		
+		const auto it1 = std::lower_bound(beg, end, blockColumn1);
+		const auto it2 = std::lower_bound(it1, end, blockColumn2);
+		
+		const auto found1 = (it1 != end and *it1 == blockColumn1);
+		const auto found2 = (it2 != end and *it2 == blockColumn2);
+		
+		const auto index1 = static_cast<Index>(it1 - HexBlockSparseMatrix::blockColumns.begin());
+		const auto index2 = static_cast<Index>(it2 - HexBlockSparseMatrix::blockColumns.begin());
+		
+		if (found1 and found2) // Both blocks exist, only their values move.
+			std::swap_ranges(valuesOf(index1), valuesOf(index1 + 1), valuesOf(index2));
+		else if (found1) // The block moves right, past the blocks between both columns.
+		{
+			std::rotate(it1, it1 + 1, it2);
+			std::rotate(valuesOf(index1), valuesOf(index1 + 1), valuesOf(index2));
+			*(it2 - 1) = blockColumn2;
+		}
+		else if (found2) // The block moves left, before the blocks between both columns.
+		{
+			std::rotate(it1, it2, it2 + 1);
+			std::rotate(valuesOf(index1), valuesOf(index2), valuesOf(index2 + 1));
+			*it1 = blockColumn1;
+		}
+	}
+}
+
+/* Same restriction as swapColumns with the last block row. The blocks
+ * between both rows are copied once, whatever the lengths of both rows.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+void HexBlockSparseMatrix<BlockSize, Value, Index>::swapRows(Index blockRow1, Index blockRow2)
+{
+	const auto numberOfBlockRows = HexBlockSparseMatrix::getNumberOfBlockRows();
+	const auto lastIsPadded = (HexBlockSparseMatrix::numberOfRows % BlockSize != 0);
+	
+	if (blockRow1 == blockRow2 or blockRow1 < 0 or blockRow2 < 0)
+		return;
+	
+	if (blockRow1 >= numberOfBlockRows or blockRow2 >= numberOfBlockRows)
+		return;
+	
+	if (lastIsPadded and (blockRow1 == numberOfBlockRows - 1 or blockRow2 == numberOfBlockRows - 1))
+		return;
+	
+	if (blockRow1 > blockRow2)
+		std::swap(blockRow1, blockRow2);
+	
+	auto& offsets = HexBlockSparseMatrix::blockRowOffsets;
+	
+	const auto numberOfBlocks1 = offsets[blockRow1 + 1] - offsets[blockRow1];
+	const auto numberOfBlocks2 = offsets[blockRow2 + 1] - offsets[blockRow2];
+	
+	if (numberOfBlocks1 < 1 and numberOfBlocks2 < 1)
+		return;
+	
+	const auto rewrite = [&offsets, blockRow1, blockRow2](auto& vect, qint32 stride)
+	{
+		const auto beg1 = vect.cbegin() + static_cast<qint64>(offsets[blockRow1])*stride;
+		const auto end1 = vect.cbegin() + static_cast<qint64>(offsets[blockRow1 + 1])*stride;
+		const auto beg2 = vect.cbegin() + static_cast<qint64>(offsets[blockRow2])*stride;
+		const auto end2 = vect.cbegin() + static_cast<qint64>(offsets[blockRow2 + 1])*stride;
+		
+		auto newSpan = std::remove_cvref_t<decltype(vect)>();
+		newSpan.reserve(end2 - beg1);
+		
+		newSpan.insert(newSpan.end(), beg2, end2);
+		newSpan.insert(newSpan.end(), end1, beg2);
+		newSpan.insert(newSpan.end(), beg1, end1);
+		
+		std::copy(newSpan.cbegin(), newSpan.cend(), vect.begin() + (beg1 - vect.cbegin()));
+	};
+	
+	rewrite(HexBlockSparseMatrix::blockColumns, 1);
+	rewrite(HexBlockSparseMatrix::blockValues, BlockArea);
+	
+	const auto differenceOfBlocks = numberOfBlocks2 - numberOfBlocks1;
+	
+	for (auto blockRow = blockRow1 + 1; blockRow <= blockRow2; ++blockRow) // There is no difference beyond blockRow2 as the sum of past blocks is unchanged.
+		offsets[blockRow] += differenceOfBlocks;
+}
+
+template<qint32 BlockSize, typename Value, typename Index>
+void HexBlockSparseMatrix<BlockSize, Value, Index>::transpose(void)
+{
+	auto newMatrix = HexBlockSparseMatrix::transposed();
+	
+	HexBlockSparseMatrix::blockRowOffsets.swap(newMatrix.blockRowOffsets);
+	HexBlockSparseMatrix::blockColumns.swap(newMatrix.blockColumns);
+	HexBlockSparseMatrix::blockValues.swap(newMatrix.blockValues);
+	
+	std::swap(HexBlockSparseMatrix::numberOfRows, HexBlockSparseMatrix::numberOfColumns);
+}
+
+/* This is the same counting sort as HexBasicSparseMatrix::transposed,
+ * on blocks rather than values, and every block is transposed as it
+ * gets copied to its new place.
+ */
+template<qint32 BlockSize, typename Value, typename Index>
+HexBlockSparseMatrix<BlockSize, Value, Index> HexBlockSparseMatrix<BlockSize, Value, Index>::transposed(void) const
+{
+	const auto numberOfBlockRows = HexBlockSparseMatrix::getNumberOfBlockRows();
+	const auto numberOfBlockColumns = HexBlockSparseMatrix::getNumberOfBlockColumns();
+	
+	auto transposed = HexBlockSparseMatrix();
+	transposed.numberOfRows = HexBlockSparseMatrix::numberOfColumns;
+	transposed.numberOfColumns = HexBlockSparseMatrix::numberOfRows;
+	transposed.blockRowOffsets.assign(numberOfBlockColumns + 1, 0);
+	
+	for (const auto& blockColumn : HexBlockSparseMatrix::blockColumns)
+		++transposed.blockRowOffsets[blockColumn + 1];
+	
+	for (auto blockRow = Index(0); blockRow < numberOfBlockColumns; ++blockRow)
+		transposed.blockRowOffsets[blockRow + 1] += transposed.blockRowOffsets[blockRow];
+	
+	transposed.blockColumns.resize(HexBlockSparseMatrix::blockColumns.size());
+	transposed.blockValues.resize(HexBlockSparseMatrix::blockValues.size());
+	
+	auto blockIndexes = transposed.blockRowOffsets;
+	
+	for (auto blockRow = Index(0); blockRow < numberOfBlockRows; ++blockRow)
+	{
+		for (auto index = HexBlockSparseMatrix::blockRowOffsets[blockRow]; index < HexBlockSparseMatrix::blockRowOffsets[blockRow + 1]; ++index)
+		{
+			auto& newIndex = blockIndexes[HexBlockSparseMatrix::blockColumns[index]];
+			
+			const auto block = HexBlockSparseMatrix::blockValues.cbegin() + static_cast<qint64>(index)*BlockArea;
+			const auto newBlock = transposed.blockValues.begin() + static_cast<qint64>(newIndex)*BlockArea;
+			
+			for (auto i = 0; i < BlockSize; ++i)
+			{
+				for (auto j = 0; j < BlockSize; ++j)
+					newBlock[j*BlockSize + i] = block[i*BlockSize + j];
+			}
+			
+			transposed.blockColumns[newIndex] = blockRow;
+			++newIndex;
+		}
+	}
+	
+	return transposed;
+}
+
+#endif
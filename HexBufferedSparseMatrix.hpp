@@ -0,0 +1,414 @@
+#ifndef __HEX_BUFFERED_SPARSE_MATRIX_HPP__
+#define __HEX_BUFFERED_SPARSE_MATRIX_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrix.hpp"
+
+/* This is a HexSparseMatrix meant for workloads that write a lot. Rather
+ * than shifting the pairs and the row offsets on every setValue, writes go
+ * into a buffer of deltas sorted by row then by column, which costs
+ * O(log k) for k pending writes. A delta whose value is zero is a
+ * tombstone: it erases the value of the base matrix. Reads see the base
+ * matrix and the deltas merged together, and only the rows that actually
+ * have deltas pay for the merge. The deltas are folded into the base
+ * matrix once there are too many of them, or whenever compact() is called.
+ */
+
+class HexBufferedSparseMatrix
+{
+	private:
+	
+		static constexpr qint64							DefaultCompactionThreshold = 65536;
+		
+		HexSparseMatrix								matrix;
+		std::map<qint32, std::map<qint32, qreal>>				deltas;
+		
+		qint64									compactionThreshold = HexBufferedSparseMatrix::DefaultCompactionThreshold;
+		qint64									numberOfDeltas = 0;
+		
+		qint32									numberOfRows = 0;
+		qint32									numberOfColumns = 0;
+		
+		inline qint32								getBaseIndex(qint32, bool) const;
+		inline HexSparseMatrix							getMergedMatrix(void) const;
+		inline void								mergeRow(qint32, const std::map<qint32, qreal>&, std::vector<HexColumnValuePair>&) const;
+		
+	public:
+	
+		inline									HexBufferedSparseMatrix(void);
+		inline									HexBufferedSparseMatrix(const HexSparseMatrix&);
+		
+		inline void								compact(void);
+		inline HexDecomposition							getDecomposition(void) const;
+		inline std::vector<qreal>						getDenseMatrix(void) const;
+		inline const HexSparseMatrix&						getMatrix(void);
+		inline qint32								getNumberOfColumns(void) const;
+		inline qint64								getNumberOfPendingValues(void) const;
+		inline qint32								getNumberOfRows(void) const;
+		inline qreal								getValue(qint32, qint32) const;
+		inline void								multiply(const std::vector<qreal>&, std::vector<qreal>&) const;
+		inline void								multiply(qreal, const std::vector<qreal>&, qreal, std::vector<qreal>&) const;
+		inline void								setCompactionThreshold(qint64);
+		inline void								setValue(qint32, qint32, qreal);
+		inline HexSparseMatrix							transposed(void) const;
+};
+
+HexBufferedSparseMatrix::HexBufferedSparseMatrix(void)
+{
+}
+
+HexBufferedSparseMatrix::HexBufferedSparseMatrix(const HexSparseMatrix& mtrx) : matrix(mtrx)
+{
+	HexBufferedSparseMatrix::numberOfRows = mtrx.getNumberOfRows();
+	HexBufferedSparseMatrix::numberOfColumns = mtrx.getNumberOfColumns();
+}
+
+/* This is a single O(nnz + k) pass, in which every row that has
+ * deltas is merged, and every other row is copied as it is.
+ */
+void HexBufferedSparseMatrix::compact(void)
+{
+	if (HexBufferedSparseMatrix::deltas.empty())
+		return;
+	
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	
+	auto pairs = std::vector<HexColumnValuePair>();
+	auto rowOffsets = std::vector<qint32>(HexBufferedSparseMatrix::numberOfRows + 1, 0);
+	auto mergedRow = std::vector<HexColumnValuePair>();
+	
+	pairs.reserve(basePairs.size() + HexBufferedSparseMatrix::numberOfDeltas);
+	auto deltaIt = HexBufferedSparseMatrix::deltas.cbegin();
+	
+	for (auto row = 0; row < HexBufferedSparseMatrix::numberOfRows; ++row)
+	{
+		if (deltaIt != HexBufferedSparseMatrix::deltas.cend() and deltaIt->first == row)
+		{
+			HexBufferedSparseMatrix::mergeRow(row, deltaIt->second, mergedRow);
+			pairs.insert(pairs.end(), mergedRow.cbegin(), mergedRow.cend());
+			++deltaIt;
+		}
+		else
+		{
+			const auto startIndex = HexBufferedSparseMatrix::getBaseIndex(row, false);
+			const auto stopIndex = HexBufferedSparseMatrix::getBaseIndex(row, true);
+			
+			pairs.insert(pairs.end(), basePairs.cbegin() + startIndex, basePairs.cbegin() + stopIndex);
+		}
+		
+		rowOffsets[row + 1] = static_cast<qint32>(pairs.size());
+	}
+	
+	HexBufferedSparseMatrix::matrix = HexSparseMatrix(std::move(pairs), std::move(rowOffsets), HexBufferedSparseMatrix::numberOfColumns);
+	HexBufferedSparseMatrix::deltas.clear();
+	HexBufferedSparseMatrix::numberOfDeltas = 0;
+}
+
+/* Rows that don't exist in the base matrix are
+ * simply empty ranges at the end of its pairs.
+ */
+qint32 HexBufferedSparseMatrix::getBaseIndex(qint32 row, bool stop) const
+{
+	const auto& rowOffsets = HexBufferedSparseMatrix::matrix.getRowOffsets();
+	const auto index = row + (stop ? 1 : 0);
+	
+	if (HexBufferedSparseMatrix::matrix.getPairs().empty() or index >= static_cast<qint32>(rowOffsets.size()))
+		return static_cast<qint32>(HexBufferedSparseMatrix::matrix.getPairs().size());
+	
+	return rowOffsets[index];
+}
+
+/* The decomposition is far more expensive than a copy
+ * of the matrix, so we don't bother merging on the fly here.
+ */
+HexDecomposition HexBufferedSparseMatrix::getDecomposition(void) const
+{
+	if (HexBufferedSparseMatrix::deltas.empty())
+		return HexBufferedSparseMatrix::matrix.getDecomposition();
+	
+	return HexBufferedSparseMatrix::getMergedMatrix().getDecomposition();
+}
+
+std::vector<qreal> HexBufferedSparseMatrix::getDenseMatrix(void) const
+{
+	if (HexBufferedSparseMatrix::deltas.empty())
+		return HexBufferedSparseMatrix::matrix.getDenseMatrix();
+	
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	const auto stride = static_cast<qint64>(HexBufferedSparseMatrix::numberOfColumns);
+	
+	auto dense = std::vector<qreal>(static_cast<quint64>(HexBufferedSparseMatrix::numberOfRows)*static_cast<quint64>(stride), 0.);
+	
+	for (auto row = 0; row < HexBufferedSparseMatrix::matrix.getNumberOfRows(); ++row)
+	{
+		const auto stopIndex = HexBufferedSparseMatrix::getBaseIndex(row, true);
+		
+		for (auto index = HexBufferedSparseMatrix::getBaseIndex(row, false); index < stopIndex; ++index)
+			dense[row*stride + basePairs[index].column] = basePairs[index].value;
+	}
+	
+	for (const auto& [row, rowDeltas] : HexBufferedSparseMatrix::deltas) // Tombstones simply write their zero over the old value.
+	{
+		for (const auto& [column, value] : rowDeltas)
+			dense[row*stride + column] = value;
+	}
+	
+	return dense;
+}
+
+const HexSparseMatrix& HexBufferedSparseMatrix::getMatrix(void)
+{
+	HexBufferedSparseMatrix::compact();
+	return HexBufferedSparseMatrix::matrix;
+}
+
+HexSparseMatrix HexBufferedSparseMatrix::getMergedMatrix(void) const
+{
+	auto copy = *this;
+	copy.compact();
+	
+	return copy.matrix;
+}
+
+qint32 HexBufferedSparseMatrix::getNumberOfColumns(void) const
+{
+	return HexBufferedSparseMatrix::numberOfColumns;
+}
+
+qint64 HexBufferedSparseMatrix::getNumberOfPendingValues(void) const
+{
+	return HexBufferedSparseMatrix::numberOfDeltas;
+}
+
+qint32 HexBufferedSparseMatrix::getNumberOfRows(void) const
+{
+	return HexBufferedSparseMatrix::numberOfRows;
+}
+
+qreal HexBufferedSparseMatrix::getValue(qint32 row, qint32 column) const
+{
+	if (row < 0 or column < 0 or row >= HexBufferedSparseMatrix::numberOfRows or column >= HexBufferedSparseMatrix::numberOfColumns)
+		return 0.;
+	
+	const auto deltaIt = HexBufferedSparseMatrix::deltas.find(row);
+	
+	if (deltaIt != HexBufferedSparseMatrix::deltas.cend())
+	{
+		const auto it = deltaIt->second.find(column);
+		
+		if (it != deltaIt->second.cend())
+			return it->second;
+	}
+	
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	const auto beg = basePairs.cbegin() + HexBufferedSparseMatrix::getBaseIndex(row, false);
+	const auto end = basePairs.cbegin() + HexBufferedSparseMatrix::getBaseIndex(row, true);
+	const auto it = std::lower_bound(beg, end, column, [](const HexColumnValuePair& pr, qint32 col) { return pr.column < col; });
+	
+	return (it != end and it->column == column ? it->value : 0.);
+}
+
+void HexBufferedSparseMatrix::mergeRow(qint32 row, const std::map<qint32, qreal>& rowDeltas, std::vector<HexColumnValuePair>& mergedRow) const
+{
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	const auto stopIndex = HexBufferedSparseMatrix::getBaseIndex(row, true);
+	
+	auto it = rowDeltas.cbegin();
+	mergedRow.clear();
+	
+	for (auto index = HexBufferedSparseMatrix::getBaseIndex(row, false); index < stopIndex; ++index)
+	{
+		const auto& pr = basePairs[index];
+		
+		while (it != rowDeltas.cend() and it->first < pr.column)
+		{
+			if (it->second != 0.)
+				mergedRow.emplace_back(it->second, it->first);
+			
+			++it;
+		}
+		
+		if (it == rowDeltas.cend() or it->first != pr.column)
+			mergedRow.push_back(pr);
+		else
+		{
+			if (it->second != 0.) // Otherwise this is a tombstone and the old value is gone.
+				mergedRow.emplace_back(it->second, it->first);
+			
+			++it;
+		}
+	}
+	
+	for (; it != rowDeltas.cend(); ++it)
+	{
+		if (it->second != 0.)
+			mergedRow.emplace_back(it->second, it->first);
+	}
+}
+
+void HexBufferedSparseMatrix::multiply(const std::vector<qreal>& x, std::vector<qreal>& y) const
+{
+	HexBufferedSparseMatrix::multiply(1., x, 0., y);
+}
+
+/* Rows without deltas run the exact same loop as HexSparseMatrix::multiply.
+ * Each thread walks the deltas alongside its rows, so finding out whether
+ * a row has been modified costs a single comparison.
+ */
+void HexBufferedSparseMatrix::multiply(qreal alpha, const std::vector<qreal>& x, qreal beta, std::vector<qreal>& y) const
+{
+	if (HexBufferedSparseMatrix::deltas.empty())
+		return HexBufferedSparseMatrix::matrix.multiply(alpha, x, beta, y);
+	
+	if (x.size() < static_cast<quint32>(HexBufferedSparseMatrix::numberOfColumns))
+		return;
+	
+	y.resize(HexBufferedSparseMatrix::numberOfRows, 0.);
+	
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(basePairs.size()));
+	
+	auto boundaries = HexParallel::PartitionOffsets(HexBufferedSparseMatrix::matrix.getRowOffsets(), numberOfThreads);
+	boundaries.back() = HexBufferedSparseMatrix::numberOfRows; // The rows that only exist in the deltas go to the last thread.
+	
+	if (basePairs.empty())
+		std::fill(boundaries.begin() + 1, boundaries.end(), HexBufferedSparseMatrix::numberOfRows);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		auto deltaIt = HexBufferedSparseMatrix::deltas.lower_bound(boundaries[thread]);
+		auto mergedRow = std::vector<HexColumnValuePair>();
+		
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			auto sum = 0.;
+			
+			if (deltaIt != HexBufferedSparseMatrix::deltas.cend() and deltaIt->first == row)
+			{
+				HexBufferedSparseMatrix::mergeRow(row, deltaIt->second, mergedRow);
+				
+				for (const auto& pr : mergedRow)
+					sum += pr.value*x[pr.column];
+				
+				++deltaIt;
+			}
+			else
+			{
+				const auto stopIndex = HexBufferedSparseMatrix::getBaseIndex(row, true);
+				
+				for (auto index = HexBufferedSparseMatrix::getBaseIndex(row, false); index < stopIndex; ++index)
+					sum += basePairs[index].value*x[basePairs[index].column];
+			}
+			
+			y[row] = HexScalarTraits<qreal>::UpdateOutput(alpha*sum, beta, y[row]);
+		}
+	});
+}
+
+void HexBufferedSparseMatrix::setCompactionThreshold(qint64 threshold)
+{
+	HexBufferedSparseMatrix::compactionThreshold = threshold;
+	
+	if (HexBufferedSparseMatrix::numberOfDeltas >= threshold)
+		HexBufferedSparseMatrix::compact();
+}
+
+/* Like HexSparseMatrix::setValue, a zero value erases the cell and
+ * never grows the matrix, while any other value might.
+ */
+void HexBufferedSparseMatrix::setValue(qint32 row, qint32 column, qreal value)
+{
+	if (row < 0 or column < 0)
+		return;
+	
+	if (value == 0. and (row >= HexBufferedSparseMatrix::numberOfRows or column >= HexBufferedSparseMatrix::numberOfColumns))
+		return;
+	
+	const auto inserted = HexBufferedSparseMatrix::deltas[row].insert_or_assign(column, value).second;
+	
+	if (inserted)
+		++HexBufferedSparseMatrix::numberOfDeltas;
+	
+	if (row >= HexBufferedSparseMatrix::numberOfRows)
+		HexBufferedSparseMatrix::numberOfRows = row + 1;
+	
+	if (column >= HexBufferedSparseMatrix::numberOfColumns)
+		HexBufferedSparseMatrix::numberOfColumns = column + 1;
+	
+	if (HexBufferedSparseMatrix::numberOfDeltas >= HexBufferedSparseMatrix::compactionThreshold)
+		HexBufferedSparseMatrix::compact();
+}
+
+/* This is the same counting sort as HexSparseMatrix::transposed,
+ * except that the rows with deltas are merged beforehand.
+ */
+HexSparseMatrix HexBufferedSparseMatrix::transposed(void) const
+{
+	if (HexBufferedSparseMatrix::deltas.empty())
+		return HexBufferedSparseMatrix::matrix.transposed();
+	
+	auto mergedRows = std::vector<std::vector<HexColumnValuePair>>(HexBufferedSparseMatrix::deltas.size());
+	auto mergedRow = mergedRows.begin();
+	
+	for (const auto& [row, rowDeltas] : HexBufferedSparseMatrix::deltas)
+	{
+		HexBufferedSparseMatrix::mergeRow(row, rowDeltas, *mergedRow);
+		++mergedRow;
+	}
+	
+	const auto& basePairs = HexBufferedSparseMatrix::matrix.getPairs();
+	auto rowOffsets = std::vector<qint32>(HexBufferedSparseMatrix::numberOfColumns + 1, 0);
+	
+	const auto visit = [&](const auto& function) // Calls function(row, pair) for every non-zero value of the merged matrix, row after row.
+	{
+		auto deltaIt = HexBufferedSparseMatrix::deltas.cbegin();
+		auto mergedIt = mergedRows.cbegin();
+		
+		for (auto row = 0; row < HexBufferedSparseMatrix::numberOfRows; ++row)
+		{
+			if (deltaIt != HexBufferedSparseMatrix::deltas.cend() and deltaIt->first == row)
+			{
+				for (const auto& pr : *mergedIt)
+					function(row, pr);
+				
+				++deltaIt;
+				++mergedIt;
+			}
+			else
+			{
+				const auto stopIndex = HexBufferedSparseMatrix::getBaseIndex(row, true);
+				
+				for (auto index = HexBufferedSparseMatrix::getBaseIndex(row, false); index < stopIndex; ++index)
+					function(row, basePairs[index]);
+			}
+		}
+	};
+	
+	visit([&rowOffsets](qint32, const HexColumnValuePair& pr) { ++rowOffsets[pr.column + 1]; });
+	
+	for (auto column = 0; column < HexBufferedSparseMatrix::numberOfColumns; ++column)
+		rowOffsets[column + 1] += rowOffsets[column];
+	
+	auto pairs = std::vector<HexColumnValuePair>(rowOffsets.back());
+	auto rowIndexes = rowOffsets;
+	
+	visit([&](qint32 row, const HexColumnValuePair& pr)
+	{
+		pairs[rowIndexes[pr.column]] = HexColumnValuePair(pr.value, row);
+		++rowIndexes[pr.column];
+	});
+	
+	return HexSparseMatrix(std::move(pairs), std::move(rowOffsets), HexBufferedSparseMatrix::numberOfRows);
+}
+
+#endif
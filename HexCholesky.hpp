@@ -0,0 +1,903 @@
+#ifndef __HEX_CHOLESKY_HPP__
+#define __HEX_CHOLESKY_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+#include <QtMath>
+
+// Custom Libraries
+#include "HexOrdering.hpp"
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+
+/* Supernodal multifrontal Cholesky factorization PAP' = LL' of a Hermitian
+ * positive definite matrix, of which only the lower triangle is read.
+ *
+ * analyse only looks at the pattern: it orders the matrix, builds and
+ * postorders its elimination tree, counts the columns of L, groups columns
+ * with the same structure into supernodes, and works out where every value
+ * of the matrix, and every row of every update matrix, will go. factorize
+ * then only moves numbers around, and can be called again and again on
+ * matrices with the same pattern, e.g. at every step of a time-stepping loop,
+ * without paying for any of the above again.
+ *
+ * Each supernode is stored as a dense column-major block, its rows being its
+ * own columns then the rows below, so that factorizing it, and computing the
+ * update it sends to its parent, are dense products over contiguous memory,
+ * which SubtractProducts computes by tiles kept in registers and blocks kept
+ * in cache. Supernodes in different subtrees don't depend on each other: the
+ * tree is cut into subtrees of about the same work, which are factorized in
+ * parallel, and only the supernodes above them are left to do one after the
+ * other.
+ *
+ * There is no LU counterpart for unsymmetric matrices. Everything analyse
+ * works out holds for any values only because Cholesky never pivots. LU needs
+ * threshold pivoting to stay stable, and its pivots depend on the values, so
+ * rows would move between supernodes and the structures, update matrices and
+ * value map could not be worked out once and reused. Unsymmetric systems go
+ * through getDecomposition or HexKrylovSolver instead.
+ */
+template<typename Matrix>
+class HexCholesky
+{
+	public:
+	
+		using Index = typename Matrix::IndexType;
+		using Value = typename Matrix::ValueType;
+		
+	private:
+	
+		using Accumulator = typename Matrix::Accumulator;
+		
+		static constexpr std::array<std::pair<qint64, qreal>, 4>			AmalgamationThresholds = {{{4, 1.}, {16, .8}, {48, .1}, {std::numeric_limits<qint64>::max(), .05}}}; // Widths up to first may be up to second zeros
+		static constexpr qint64							DepthBlockSize = 128;	// Columns of the panel SubtractProducts goes through before writing its sums
+		static constexpr qint64							MinimumSubtreesPerThread = 4;
+		static constexpr qint64							PanelWidth = 32;	// Columns of a supernode factorized one at a time, once the previous ones are applied
+		static constexpr qint64							RowBlockSize = 128;	// Rows of the panel SubtractProducts keeps in cache while going through the columns
+		static constexpr qint64							TileColumns = 4;	// Size of the tiles SubtractProducts keeps in registers
+		static constexpr qint64							TileRows = 4;
+		
+		Index									numberOfRows = 0;
+		qint64									numberOfMatrixValues = 0;
+		bool									factorized = false;
+		
+		std::vector<Index>							permutation;		// Row and column k of L are row and column permutation[k] of the matrix
+		std::vector<Index>							supernodeOffsets;	// Supernode s is columns supernodeOffsets[s] to supernodeOffsets[s + 1] - 1 of L
+		std::vector<Index>							supernodeParents;
+		std::vector<Index>							firstDescendants;	// The subtree of supernode s is supernodes firstDescendants[s] to s
+		std::vector<qint64>							structureOffsets;
+		std::vector<Index>							structure;		// Rows of each supernode, its own columns first, all sorted
+		std::vector<Index>							relativeIndices;	// Position of each row of a supernode in the structure of its parent
+		std::vector<qint64>							valueOffsets;
+		std::vector<qint64>							valueMap;		// Position of each value of the matrix in values, -1 for the upper triangle
+		std::vector<bool>							conjugatedValues;	// Values that land in the lower triangle of L from its upper one
+		std::vector<std::vector<Index>>						subtreesOfThreads;
+		std::vector<Index>							topSupernodes;
+		std::vector<Value>							values;
+		
+		inline static void							LowerPattern(const Matrix&, const std::vector<Index>&, std::vector<qint64>&, std::vector<Index>&);
+		inline static void							SubtractProducts(const Value*, qint64, qint64, qint64, qint64, qint64, Value*, qint64);
+		
+		inline bool								factorizeSupernode(Index, std::vector<std::vector<Value>>&);
+		inline void								scheduleSubtrees(void);
+		
+	public:
+	
+		inline									HexCholesky(void);
+		inline explicit								HexCholesky(const Matrix&);
+		
+		inline bool								analyse(const Matrix&);
+		inline bool								analyse(const Matrix&, const std::vector<Index>&);
+		inline bool								factorize(const Matrix&);
+		inline qint64								getNumberOfNonZeros(void) const;
+		inline Index								getNumberOfSupernodes(void) const;
+		inline bool								isFactorized(void) const;
+		inline void								solve(const std::vector<Value>&, std::vector<Value>&) const;
+};
+
+template<typename Matrix>
+HexCholesky<Matrix>::HexCholesky(void)
+{
+}
+
+template<typename Matrix>
+HexCholesky<Matrix>::HexCholesky(const Matrix& matrix)
+{
+	if (HexCholesky::analyse(matrix))
+		HexCholesky::factorize(matrix);
+}
+
+/* This writes the strict lower triangle of PAP', with P given by the inverse
+ * permutation, as rows of column indices, taking every value of the lower
+ * triangle of A as a value of the lower triangle of PAP' or of its mirror.
+ */
+template<typename Matrix>
+void HexCholesky<Matrix>::LowerPattern(const Matrix& matrix, const std::vector<Index>& inverse, std::vector<qint64>& offsets, std::vector<Index>& columns)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	const auto n = matrix.getNumberOfRows();
+	
+	offsets.assign(n + 1, 0);
+	
+	for (auto row = Index(0); row < n; ++row)
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1] and pairs[index].column < row; ++index)
+			++offsets[std::max(inverse[row], inverse[pairs[index].column]) + 1];
+	
+	for (auto row = Index(0); row < n; ++row)
+		offsets[row + 1] += offsets[row];
+	
+	auto positions = std::vector<qint64>(offsets.cbegin(), offsets.cend() - 1);
+	
+	columns.resize(offsets[n]);
+	
+	for (auto row = Index(0); row < n; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1] and pairs[index].column < row; ++index)
+		{
+			const auto [low, high] = std::minmax(inverse[row], inverse[pairs[index].column]);
+			columns[positions[high]++] = low;
+		}
+	}
+}
+
+/* This is the kernel of both the factorization and the update matrices:
+ * for every column j from first to lastColumn, and every row r from j to
+ * lastRow, target(r, j) -= sum over k of panel(r, k)*conj(panel(j, k)),
+ * depth being the number of columns of the panel, and target(first, first)
+ * being the first value of target. target is cut into tiles of TileRows
+ * by TileColumns, whose sums are kept in registers, so that every value of
+ * the panel that is read feeds several products. The panel is gone
+ * through by DepthBlockSize columns, so that target is only read and
+ * written once for each of them, and by RowBlockSize rows, which stay in
+ * cache for all the tiles of these rows.
+ */
+template<typename Matrix>
+void HexCholesky<Matrix>::SubtractProducts(const Value* panel, qint64 stride, qint64 depth, qint64 first, qint64 lastColumn, qint64 lastRow, Value* target, qint64 targetStride)
+{
+	constexpr auto R = HexCholesky::TileRows;
+	constexpr auto C = HexCholesky::TileColumns;
+	
+	auto sums = std::array<Accumulator, R*C>();
+	
+	for (auto firstK = qint64(0); firstK < depth; firstK += HexCholesky::DepthBlockSize)
+	{
+		const auto lastK = qMin(firstK + HexCholesky::DepthBlockSize, depth);
+		
+		for (auto firstRow = first; firstRow < lastRow; firstRow += HexCholesky::RowBlockSize)
+		{
+			const auto lastRowOfBlock = qMin(firstRow + HexCholesky::RowBlockSize, lastRow);
+			
+			for (auto j = first; j < qMin(lastColumn, lastRowOfBlock); j += C)
+			{
+				const auto tileWidth = qMin(C, lastColumn - j);
+				
+				for (auto r = firstRow + qMax(qint64(0), j - firstRow)/R*R; r < lastRowOfBlock; r += R) // From the tile that holds row j
+				{
+					const auto tileHeight = qMin(R, lastRowOfBlock - r);
+					
+					sums.fill(Accumulator());
+					
+					if (tileWidth == C and tileHeight == R)
+					{
+						for (auto k = firstK; k < lastK; ++k) // Unrolled, or -O2 keeps the sums in memory rather than in registers.
+						{
+							const auto* const column = panel + k*stride;
+							auto rows = std::array<Accumulator, R>();
+							
+							#pragma GCC unroll 8
+							for (auto rr = qint64(0); rr < R; ++rr)
+								rows[rr] = static_cast<Accumulator>(column[r + rr]);
+							
+							#pragma GCC unroll 8
+							for (auto jj = qint64(0); jj < C; ++jj)
+							{
+								const auto coefficient = HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(column[j + jj]));
+								
+								#pragma GCC unroll 8
+								for (auto rr = qint64(0); rr < R; ++rr)
+									sums[jj*R + rr] += rows[rr]*coefficient;
+							}
+						}
+					}
+					else // Tiles on the edges
+					{
+						for (auto k = firstK; k < lastK; ++k)
+						{
+							const auto* const column = panel + k*stride;
+							
+							for (auto jj = qint64(0); jj < tileWidth; ++jj)
+							{
+								const auto coefficient = HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(column[j + jj]));
+								
+								for (auto rr = qint64(0); rr < tileHeight; ++rr)
+									sums[jj*R + rr] += static_cast<Accumulator>(column[r + rr])*coefficient;
+							}
+						}
+					}
+					
+					for (auto jj = qint64(0); jj < tileWidth; ++jj)
+					{
+						auto* const targetColumn = target + (j + jj - first)*targetStride - first;
+						
+						for (auto rr = qMax(qint64(0), j + jj - r); rr < tileHeight; ++rr) // Tiles on the diagonal leave the upper triangle alone.
+							targetColumn[r + rr] = static_cast<Value>(static_cast<Accumulator>(targetColumn[r + rr]) - sums[jj*R + rr]);
+					}
+				}
+			}
+		}
+	}
+}
+
+template<typename Matrix>
+bool HexCholesky<Matrix>::analyse(const Matrix& matrix)
+{
+	if (matrix.getNumberOfRows() != matrix.getNumberOfColumns())
+		return false;
+	
+	return HexCholesky::analyse(matrix, HexOrdering::MinimumDegree(matrix));
+}
+
+/* ordering[k] is the row and column of the matrix that becomes row and
+ * column k before postordering, which keeps the fill but makes supernodes
+ * contiguous. The etree comes from Liu's algorithm with path compression,
+ * the column counts from walking up the row subtrees, and supernodes are
+ * fundamental ones, i.e. chains of columns with nested structures, each merged
+ * into its parent as long as the explicit zeros this adds are few enough for
+ * its width, since dense kernels on wider blocks more than make up for them.
+ */
+template<typename Matrix>
+bool HexCholesky<Matrix>::analyse(const Matrix& matrix, const std::vector<Index>& ordering)
+{
+	const auto n = matrix.getNumberOfRows();
+	
+	HexCholesky::factorized = false;
+	HexCholesky::numberOfRows = 0;
+	
+	if (matrix.getNumberOfColumns() != n or static_cast<Index>(ordering.size()) != n)
+		return false;
+	
+	auto inverse = std::vector<Index>(n, -1);
+	
+	for (auto k = Index(0); k < n; ++k)
+	{
+		if (ordering[k] < 0 or ordering[k] >= n or inverse[ordering[k]] != -1)
+			return false;
+		
+		inverse[ordering[k]] = k;
+	}
+	
+	auto lowerOffsets = std::vector<qint64>();
+	auto lowerColumns = std::vector<Index>();
+	auto parents = std::vector<Index>(n, -1);
+	
+	HexCholesky::LowerPattern(matrix, inverse, lowerOffsets, lowerColumns);
+	
+	{
+		auto ancestors = std::vector<Index>(n, -1);
+		
+		for (auto row = Index(0); row < n; ++row)
+		{
+			for (auto index = lowerOffsets[row]; index < lowerOffsets[row + 1]; ++index)
+			{
+				for (auto k = lowerColumns[index]; k != -1 and k < row;)
+				{
+					const auto next = ancestors[k];
+					
+					ancestors[k] = row;
+					
+					if (next == -1)
+						parents[k] = row;
+					
+					k = next;
+				}
+			}
+		}
+	}
+	
+	auto postorder = std::vector<Index>();
+	
+	{
+		auto heads = std::vector<Index>(n, -1);
+		auto nexts = std::vector<Index>(n, -1);
+		auto stack = std::vector<Index>();
+		
+		for (auto k = n - 1; k >= 0; --k)
+		{
+			if (parents[k] != -1)
+			{
+				nexts[k] = heads[parents[k]];
+				heads[parents[k]] = k;
+			}
+		}
+		
+		postorder.reserve(n);
+		
+		for (auto root = Index(0); root < n; ++root)
+		{
+			if (parents[root] != -1)
+				continue;
+			
+			stack.push_back(root);
+			
+			while (not stack.empty())
+			{
+				const auto node = stack.back();
+				const auto child = heads[node];
+				
+				if (child == -1)
+				{
+					stack.pop_back();
+					postorder.push_back(node);
+				}
+				else
+				{
+					heads[node] = nexts[child];
+					stack.push_back(child);
+				}
+			}
+		}
+	}
+	
+	HexCholesky::permutation.resize(n);
+	
+	for (auto k = Index(0); k < n; ++k)
+		inverse[postorder[k]] = k;
+	
+	{
+		auto postorderedParents = std::vector<Index>(n, -1);
+		
+		for (auto k = Index(0); k < n; ++k)
+		{
+			HexCholesky::permutation[k] = ordering[postorder[k]];
+			
+			if (parents[postorder[k]] != -1)
+				postorderedParents[k] = inverse[parents[postorder[k]]];
+		}
+		
+		parents.swap(postorderedParents);
+	}
+	
+	for (auto k = Index(0); k < n; ++k)
+		inverse[HexCholesky::permutation[k]] = k;
+	
+	HexCholesky::LowerPattern(matrix, inverse, lowerOffsets, lowerColumns);
+	
+	auto counts = std::vector<Index>(n, 1);
+	auto numberOfChildren = std::vector<Index>(n, 0);
+	
+	{
+		auto markers = std::vector<Index>(n, -1);
+		
+		for (auto row = Index(0); row < n; ++row)
+		{
+			markers[row] = row;
+			
+			for (auto index = lowerOffsets[row]; index < lowerOffsets[row + 1]; ++index)
+			{
+				for (auto k = lowerColumns[index]; markers[k] != row; k = parents[k])
+				{
+					++counts[k];
+					markers[k] = row;
+				}
+			}
+			
+			if (parents[row] != -1)
+				++numberOfChildren[parents[row]];
+		}
+	}
+	
+	auto& offsets = HexCholesky::supernodeOffsets;
+	
+	offsets.assign(1, 0);
+	
+	{
+		auto groupWidth = static_cast<qint64>(0);
+		auto groupNonZeros = static_cast<qint64>(0);
+		
+		for (auto first = Index(0); first < n;)
+		{
+			auto last = static_cast<Index>(first + 1);
+			
+			while (last < n and parents[last - 1] == last and counts[last - 1] == counts[last] + 1 and numberOfChildren[last] == 1)
+				++last;
+			
+			auto nonZeros = static_cast<qint64>(0);
+			
+			for (auto column = first; column < last; ++column)
+				nonZeros += counts[column];
+			
+			if (first > 0 and parents[first - 1] != -1 and parents[first - 1] < last) // The supernode before is a child, merging it only adds zeros.
+			{
+				const auto width = groupWidth + (last - first);
+				const auto height = groupWidth + counts[first];
+				const auto storedValues = width*height - width*(width - 1)/2;
+				const auto threshold = *std::find_if(HexCholesky::AmalgamationThresholds.cbegin(), HexCholesky::AmalgamationThresholds.cend(), [width](const auto& pair) { return width <= pair.first; });
+				
+				if (static_cast<qreal>(storedValues - groupNonZeros - nonZeros) <= threshold.second*static_cast<qreal>(storedValues))
+				{
+					offsets.back() = last;
+					groupWidth = width;
+					groupNonZeros += nonZeros;
+					first = last;
+					continue;
+				}
+			}
+			
+			offsets.push_back(last);
+			groupWidth = last - first;
+			groupNonZeros = nonZeros;
+			first = last;
+		}
+	}
+	
+	const auto numberOfSupernodes = static_cast<Index>(offsets.size()) - 1;
+	
+	auto supernodesOfColumns = std::vector<Index>(n);
+	auto childHeads = std::vector<Index>(numberOfSupernodes, -1);
+	auto childNexts = std::vector<Index>(numberOfSupernodes, -1);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+		for (auto column = offsets[s]; column < offsets[s + 1]; ++column)
+			supernodesOfColumns[column] = s;
+	
+	HexCholesky::supernodeParents.assign(numberOfSupernodes, -1);
+	HexCholesky::firstDescendants.resize(numberOfSupernodes);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+		HexCholesky::firstDescendants[s] = s;
+	
+	for (auto s = numberOfSupernodes - 1; s >= 0; --s)
+	{
+		const auto parent = parents[offsets[s + 1] - 1];
+		
+		if (parent == -1)
+			continue;
+		
+		const auto supernodeParent = supernodesOfColumns[parent];
+		
+		HexCholesky::supernodeParents[s] = supernodeParent;
+		childNexts[s] = childHeads[supernodeParent];
+		childHeads[supernodeParent] = s;
+	}
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+		if (HexCholesky::supernodeParents[s] != -1)
+			HexCholesky::firstDescendants[HexCholesky::supernodeParents[s]] = std::min(HexCholesky::firstDescendants[HexCholesky::supernodeParents[s]], HexCholesky::firstDescendants[s]);
+	
+	auto upperOffsets = std::vector<qint64>(n + 1, 0); // The lower pattern by columns, i.e. the rows below each column
+	auto upperRows = std::vector<Index>(lowerColumns.size());
+	
+	for (const auto column : lowerColumns)
+		++upperOffsets[column + 1];
+	
+	for (auto column = Index(0); column < n; ++column)
+		upperOffsets[column + 1] += upperOffsets[column];
+	
+	{
+		auto positions = std::vector<qint64>(upperOffsets.cbegin(), upperOffsets.cend() - 1);
+		
+		for (auto row = Index(0); row < n; ++row)
+			for (auto index = lowerOffsets[row]; index < lowerOffsets[row + 1]; ++index)
+				upperRows[positions[lowerColumns[index]]++] = row;
+	}
+	
+	auto& structure = HexCholesky::structure;
+	auto& structureOffsets = HexCholesky::structureOffsets;
+	auto markers = std::vector<Index>(n, -1);
+	
+	structure.clear();
+	structureOffsets.assign(1, 0);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+	{
+		const auto start = static_cast<qint64>(structure.size());
+		const auto width = offsets[s + 1] - offsets[s];
+		
+		for (auto column = offsets[s]; column < offsets[s + 1]; ++column)
+		{
+			structure.push_back(column);
+			markers[column] = s;
+		}
+		
+		for (auto column = offsets[s]; column < offsets[s + 1]; ++column)
+		{
+			for (auto index = upperOffsets[column]; index < upperOffsets[column + 1]; ++index)
+			{
+				if (markers[upperRows[index]] != s)
+				{
+					markers[upperRows[index]] = s;
+					structure.push_back(upperRows[index]);
+				}
+			}
+		}
+		
+		for (auto child = childHeads[s]; child != -1; child = childNexts[child])
+		{
+			const auto childWidth = offsets[child + 1] - offsets[child];
+			
+			for (auto index = structureOffsets[child] + childWidth; index < structureOffsets[child + 1]; ++index)
+			{
+				const auto row = structure[index];
+				
+				if (markers[row] != s)
+				{
+					markers[row] = s;
+					structure.push_back(row);
+				}
+			}
+		}
+		
+		std::sort(structure.begin() + start + width, structure.end());
+		structureOffsets.push_back(static_cast<qint64>(structure.size()));
+	}
+	
+	auto& relativeIndices = HexCholesky::relativeIndices;
+	
+	relativeIndices.assign(structure.size(), 0);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+	{
+		for (auto index = structureOffsets[s]; index < structureOffsets[s + 1]; ++index)
+			markers[structure[index]] = static_cast<Index>(index - structureOffsets[s]);
+		
+		for (auto child = childHeads[s]; child != -1; child = childNexts[child])
+			for (auto index = structureOffsets[child] + offsets[child + 1] - offsets[child]; index < structureOffsets[child + 1]; ++index)
+				relativeIndices[index] = markers[structure[index]];
+	}
+	
+	HexCholesky::valueOffsets.assign(1, 0);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+	{
+		const auto width = static_cast<qint64>(offsets[s + 1] - offsets[s]);
+		HexCholesky::valueOffsets.push_back(HexCholesky::valueOffsets.back() + width*(structureOffsets[s + 1] - structureOffsets[s]));
+	}
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	HexCholesky::numberOfMatrixValues = static_cast<qint64>(pairs.size());
+	HexCholesky::valueMap.assign(pairs.size(), -1);
+	HexCholesky::conjugatedValues.assign(pairs.size(), false);
+	
+	for (auto row = Index(0); row < n; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1] and pairs[index].column <= row; ++index)
+		{
+			const auto [column, lRow] = std::minmax(inverse[row], inverse[pairs[index].column]);
+			const auto s = supernodesOfColumns[column];
+			const auto first = structure.cbegin() + structureOffsets[s];
+			const auto last = structure.cbegin() + structureOffsets[s + 1];
+			const auto height = static_cast<qint64>(last - first);
+			const auto position = static_cast<qint64>(lRow < offsets[s + 1] ? lRow - offsets[s] : std::lower_bound(first + (offsets[s + 1] - offsets[s]), last, lRow) - first);
+			
+			HexCholesky::valueMap[index] = HexCholesky::valueOffsets[s] + (column - offsets[s])*height + position;
+			HexCholesky::conjugatedValues[index] = (inverse[row] < inverse[pairs[index].column]);
+		}
+	}
+	
+	HexCholesky::numberOfRows = n;
+	HexCholesky::scheduleSubtrees();
+	
+	return true;
+}
+
+/* This returns false, and leaves the factorization unusable, when the
+ * matrix doesn't have the pattern that was analysed, as far as its size and
+ * number of values tell, or when it turns out not to be positive definite.
+ */
+template<typename Matrix>
+bool HexCholesky<Matrix>::factorize(const Matrix& matrix)
+{
+	HexCholesky::factorized = false;
+	
+	const auto& pairs = matrix.getPairs();
+	
+	if (matrix.getNumberOfRows() != HexCholesky::numberOfRows or matrix.getNumberOfColumns() != HexCholesky::numberOfRows or static_cast<qint64>(pairs.size()) != HexCholesky::numberOfMatrixValues)
+		return false;
+	
+	HexCholesky::values.assign(HexCholesky::valueOffsets.back(), Value());
+	
+	for (auto index = qint64(0); index < HexCholesky::numberOfMatrixValues; ++index)
+	{
+		if (HexCholesky::valueMap[index] < 0)
+			continue;
+		
+		const auto value = pairs[index].value;
+		HexCholesky::values[HexCholesky::valueMap[index]] += (HexCholesky::conjugatedValues[index] ? HexScalarTraits<Value>::Conjugate(value) : value);
+	}
+	
+	const auto numberOfSupernodes = HexCholesky::getNumberOfSupernodes();
+	const auto numberOfThreads = static_cast<qint32>(HexCholesky::subtreesOfThreads.size());
+	
+	auto updates = std::vector<std::vector<Value>>(numberOfSupernodes);
+	auto failed = std::atomic<bool>(false);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (const auto root : HexCholesky::subtreesOfThreads[thread])
+		{
+			for (auto s = HexCholesky::firstDescendants[root]; s <= root and not failed.load(std::memory_order_relaxed); ++s)
+				if (not HexCholesky::factorizeSupernode(s, updates))
+					failed.store(true, std::memory_order_relaxed);
+		}
+	});
+	
+	for (auto it = HexCholesky::topSupernodes.cbegin(); it != HexCholesky::topSupernodes.cend() and not failed; ++it)
+		if (not HexCholesky::factorizeSupernode(*it, updates))
+			failed = true;
+	
+	HexCholesky::factorized = not failed;
+	return HexCholesky::factorized;
+}
+
+/* The children's updates are added first, to the block of the supernode for
+ * rows and columns that are its own, and to its update otherwise. Then comes
+ * a dense Cholesky factorization of the diagonal block, which also divides the
+ * rows below by the transposed factor, and last L21*L21' is taken from the
+ * update, for the parent to add in turn. Only lower triangles are touched.
+ */
+template<typename Matrix>
+bool HexCholesky<Matrix>::factorizeSupernode(Index s, std::vector<std::vector<Value>>& updates)
+{
+	const auto width = static_cast<qint64>(HexCholesky::supernodeOffsets[s + 1] - HexCholesky::supernodeOffsets[s]);
+	const auto height = HexCholesky::structureOffsets[s + 1] - HexCholesky::structureOffsets[s];
+	const auto remainder = height - width;
+	
+	auto* const block = HexCholesky::values.data() + HexCholesky::valueOffsets[s];
+	auto& update = updates[s];
+	
+	update.assign(remainder*remainder, Value());
+	
+	for (auto child = (s > 0 ? s - 1 : -1); child >= HexCholesky::firstDescendants[s]; child = HexCholesky::firstDescendants[child] - 1) // Children of s, from the last one
+	{
+		const auto childWidth = static_cast<qint64>(HexCholesky::supernodeOffsets[child + 1] - HexCholesky::supernodeOffsets[child]);
+		const auto childRemainder = HexCholesky::structureOffsets[child + 1] - HexCholesky::structureOffsets[child] - childWidth;
+		const auto* const relative = HexCholesky::relativeIndices.data() + HexCholesky::structureOffsets[child] + childWidth;
+		const auto& childUpdate = updates[child];
+		
+		for (auto b = qint64(0); b < childRemainder; ++b)
+		{
+			const auto column = static_cast<qint64>(relative[b]);
+			const auto* const source = childUpdate.data() + b*childRemainder;
+			
+			if (column < width)
+			{
+				auto* const target = block + column*height;
+				
+				for (auto a = b; a < childRemainder; ++a)
+					target[relative[a]] += source[a];
+			}
+			else
+			{
+				auto* const target = update.data() + (column - width)*remainder - width;
+				
+				for (auto a = b; a < childRemainder; ++a)
+					target[relative[a]] += source[a];
+			}
+		}
+		
+		std::vector<Value>().swap(updates[child]);
+	}
+	
+	for (auto firstK = qint64(0); firstK < width; firstK += HexCholesky::PanelWidth) // Left-looking, by panels of columns
+	{
+		const auto lastK = qMin(firstK + HexCholesky::PanelWidth, width);
+		
+		if (firstK > 0) // The columns left of the panel are applied to it all at once...
+			HexCholesky::SubtractProducts(block, height, firstK, firstK, lastK, height, block + firstK*height + firstK, height);
+		
+		for (auto k = firstK; k < lastK; ++k) // ... and those of the panel one at a time.
+		{
+			auto* const columnK = block + k*height;
+			const auto diagonal = static_cast<qreal>(std::real(columnK[k]));
+			
+			if (not (diagonal > 0.))
+				return false;
+			
+			const auto root = qSqrt(diagonal);
+			const auto inverseRoot = static_cast<Value>(1./root);
+			
+			columnK[k] = static_cast<Value>(root);
+			
+			for (auto r = k + 1; r < height; ++r)
+				columnK[r] *= inverseRoot;
+			
+			for (auto j = k + 1; j < lastK; ++j)
+			{
+				const auto coefficient = HexScalarTraits<Value>::Conjugate(columnK[j]);
+				auto* const columnJ = block + j*height;
+				
+				for (auto r = j; r < height; ++r)
+					columnJ[r] -= columnK[r]*coefficient;
+			}
+		}
+	}
+	
+	if (remainder > 0) // The rows below the supernode make the update sent to its parent.
+		HexCholesky::SubtractProducts(block, height, width, width, height, height, update.data(), remainder);
+	
+	return true;
+}
+
+template<typename Matrix>
+qint64 HexCholesky<Matrix>::getNumberOfNonZeros(void) const
+{
+	auto numberOfNonZeros = qint64(0);
+	
+	for (auto s = Index(0); s < HexCholesky::getNumberOfSupernodes(); ++s)
+	{
+		const auto width = static_cast<qint64>(HexCholesky::supernodeOffsets[s + 1] - HexCholesky::supernodeOffsets[s]);
+		numberOfNonZeros += width*(HexCholesky::structureOffsets[s + 1] - HexCholesky::structureOffsets[s]) - width*(width - 1)/2;
+	}
+	
+	return numberOfNonZeros;
+}
+
+template<typename Matrix>
+typename HexCholesky<Matrix>::Index HexCholesky<Matrix>::getNumberOfSupernodes(void) const
+{
+	return static_cast<Index>(HexCholesky::supernodeOffsets.size()) - 1;
+}
+
+template<typename Matrix>
+bool HexCholesky<Matrix>::isFactorized(void) const
+{
+	return HexCholesky::factorized;
+}
+
+/* The work of a supernode is about width*height^2. Subtrees are split,
+ * heaviest first, until there are a few per thread, and then handed out,
+ * heaviest first, to the thread with the least work so far. Supernodes that
+ * were split off are factorized afterwards, in postorder, on a single thread.
+ */
+template<typename Matrix>
+void HexCholesky<Matrix>::scheduleSubtrees(void)
+{
+	using Entry = std::pair<qint64, Index>; // Work, root
+	
+	const auto numberOfSupernodes = HexCholesky::getNumberOfSupernodes();
+	
+	auto works = std::vector<qint64>(numberOfSupernodes, 0);
+	auto childHeads = std::vector<Index>(numberOfSupernodes, -1);
+	auto childNexts = std::vector<Index>(numberOfSupernodes, -1);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+	{
+		const auto width = static_cast<qint64>(HexCholesky::supernodeOffsets[s + 1] - HexCholesky::supernodeOffsets[s]);
+		const auto height = HexCholesky::structureOffsets[s + 1] - HexCholesky::structureOffsets[s];
+		
+		works[s] += width*height*height;
+		
+		if (HexCholesky::supernodeParents[s] != -1)
+			works[HexCholesky::supernodeParents[s]] += works[s];
+	}
+	
+	for (auto s = numberOfSupernodes - 1; s >= 0; --s)
+	{
+		if (HexCholesky::supernodeParents[s] != -1)
+		{
+			childNexts[s] = childHeads[HexCholesky::supernodeParents[s]];
+			childHeads[HexCholesky::supernodeParents[s]] = s;
+		}
+	}
+	
+	auto subtrees = std::priority_queue<Entry>();
+	auto totalWork = qint64(0);
+	
+	for (auto s = Index(0); s < numberOfSupernodes; ++s)
+	{
+		if (HexCholesky::supernodeParents[s] == -1)
+		{
+			subtrees.emplace(works[s], s);
+			totalWork += works[s];
+		}
+	}
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(totalWork);
+	
+	HexCholesky::topSupernodes.clear();
+	HexCholesky::subtreesOfThreads.assign(numberOfThreads, std::vector<Index>());
+	
+	while (numberOfThreads > 1 and not subtrees.empty() and static_cast<qint64>(subtrees.size()) < HexCholesky::MinimumSubtreesPerThread*numberOfThreads)
+	{
+		const auto [work, root] = subtrees.top();
+		
+		if (childHeads[root] == -1)
+			break;
+		
+		subtrees.pop();
+		HexCholesky::topSupernodes.push_back(root);
+		
+		for (auto child = childHeads[root]; child != -1; child = childNexts[child])
+			subtrees.emplace(works[child], child);
+	}
+	
+	auto loads = std::vector<qint64>(numberOfThreads, 0);
+	
+	for (; not subtrees.empty(); subtrees.pop())
+	{
+		const auto thread = static_cast<qint32>(std::min_element(loads.cbegin(), loads.cend()) - loads.cbegin());
+		
+		loads[thread] += subtrees.top().first;
+		HexCholesky::subtreesOfThreads[thread].push_back(subtrees.top().second);
+	}
+	
+	std::sort(HexCholesky::topSupernodes.begin(), HexCholesky::topSupernodes.end());
+}
+
+/* Forward substitution with L, then backward substitution with L', one
+ * supernode at a time, in Accumulator precision.
+ */
+template<typename Matrix>
+void HexCholesky<Matrix>::solve(const std::vector<Value>& b, std::vector<Value>& x) const
+{
+	const auto n = HexCholesky::numberOfRows;
+	
+	if (not HexCholesky::factorized or static_cast<Index>(b.size()) != n)
+		return;
+	
+	auto y = std::vector<Accumulator>(n);
+	
+	for (auto k = Index(0); k < n; ++k)
+		y[k] = static_cast<Accumulator>(b[HexCholesky::permutation[k]]);
+	
+	for (auto s = Index(0); s < HexCholesky::getNumberOfSupernodes(); ++s)
+	{
+		const auto first = HexCholesky::supernodeOffsets[s];
+		const auto width = static_cast<qint64>(HexCholesky::supernodeOffsets[s + 1] - first);
+		const auto height = HexCholesky::structureOffsets[s + 1] - HexCholesky::structureOffsets[s];
+		const auto* const rows = HexCholesky::structure.data() + HexCholesky::structureOffsets[s];
+		const auto* const block = HexCholesky::values.data() + HexCholesky::valueOffsets[s];
+		
+		for (auto k = qint64(0); k < width; ++k)
+		{
+			const auto* const columnK = block + k*height;
+			const auto yk = y[first + k]/static_cast<Accumulator>(columnK[k]);
+			
+			y[first + k] = yk;
+			
+			for (auto r = k + 1; r < height; ++r)
+				y[rows[r]] -= static_cast<Accumulator>(columnK[r])*yk;
+		}
+	}
+	
+	for (auto s = HexCholesky::getNumberOfSupernodes() - 1; s >= 0; --s)
+	{
+		const auto first = HexCholesky::supernodeOffsets[s];
+		const auto width = static_cast<qint64>(HexCholesky::supernodeOffsets[s + 1] - first);
+		const auto height = HexCholesky::structureOffsets[s + 1] - HexCholesky::structureOffsets[s];
+		const auto* const rows = HexCholesky::structure.data() + HexCholesky::structureOffsets[s];
+		const auto* const block = HexCholesky::values.data() + HexCholesky::valueOffsets[s];
+		
+		for (auto k = width - 1; k >= 0; --k)
+		{
+			const auto* const columnK = block + k*height;
+			auto sum = y[first + k];
+			
+			for (auto r = k + 1; r < height; ++r)
+				sum -= HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(columnK[r]))*y[rows[r]];
+			
+			y[first + k] = sum/static_cast<Accumulator>(columnK[k]);
+		}
+	}
+	
+	x.resize(n);
+	
+	for (auto k = Index(0); k < n; ++k)
+		x[HexCholesky::permutation[k]] = static_cast<Value>(y[k]);
+}
+
+#endif
@@ -0,0 +1,739 @@
+#ifndef __HEX_KRYLOV_SOLVER_HPP__
+#define __HEX_KRYLOV_SOLVER_HPP__
+
+// Standard Libraries
+#include <complex>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+#include <QtMath>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+
+struct HexKrylovResult
+{
+	qint32 numberOfIterations = 0;
+	qreal residual = 0.;			// ||b - Ax||/||b||, estimated by GMRES between restarts
+	bool converged = false;
+};
+
+/* A preconditioner is anything with an apply(r, z) const that writes
+ * z = M^-1 r, without changing the size of z once it is right. This
+ * one does nothing, and the solvers skip it altogether.
+ */
+struct HexIdentityPreconditioner
+{
+	template<typename Value> inline void						apply(const std::vector<Value>&, std::vector<Value>&) const;
+};
+
+/* Iterative solvers for square systems Ax = b, where x, on input, is the
+ * initial guess, or zero if its size is wrong. Every vector an iteration
+ * needs is a member, sized by the first solve and only reused by the next
+ * ones. Vector operations that follow one another are fused into a single
+ * pass over the data, e.g. x += alpha*p and r -= alpha*Ap together with
+ * ||r||, since these are bandwidth-bound, and run on a HexParallelTeam kept
+ * for the whole solve, so that they neither allocate nor spawn threads.
+ * Products by the matrix and preconditioners still spawn their own, through
+ * HexParallel::Run. Sums are taken in Accumulator precision. Preconditioning
+ * is on the right for BiCGSTAB and GMRES, so that the residual they check is
+ * always the true one, ||b - Ax||/||b||. The monitor, when there is one, is
+ * called after every iteration with its number and residual, and stops the
+ * solver by returning false.
+ */
+template<typename Matrix>
+class HexKrylovSolver
+{
+	public:
+	
+		using Monitor = std::function<bool(qint32, qreal)>;
+		using Value = typename Matrix::ValueType;
+		
+	private:
+	
+		using Accumulator = typename Matrix::Accumulator;
+		using AccumulatorPair = std::pair<Accumulator, Accumulator>;
+		using AccumulatorReal = typename HexScalarTraits<Accumulator>::Real;
+		
+		qreal									tolerance;
+		qint32									maximumNumberOfIterations;
+		qint32									restart;
+		Monitor									monitor;
+		
+		AccumulatorReal								normOfRightHandSide = 0.;
+		std::vector<AccumulatorPair>						partialSums;
+		
+		std::vector<Value>							direction;
+		std::vector<Value>							preconditionedDirection;
+		std::vector<Value>							preconditionedResidual;
+		std::vector<Value>							product;
+		std::vector<Value>							residual;
+		std::vector<Value>							residualProduct;
+		std::vector<Value>							shadowResidual;
+		
+		std::vector<std::vector<Value>>						basis;
+		std::vector<Accumulator>						hessenberg;
+		std::vector<AccumulatorReal>						rotationCosines;
+		std::vector<Accumulator>						rotationSines;
+		std::vector<Accumulator>						rotatedResidual;
+		
+		inline static Accumulator						Product(Value, Value);
+		inline static AccumulatorReal						SquaredMagnitude(Value);
+		
+		inline bool								initialise(HexParallelTeam&, const Matrix&, const std::vector<Value>&, std::vector<Value>&, HexKrylovResult&);
+		inline bool								report(HexKrylovResult&, qint32, AccumulatorReal) const;
+		template<typename Function> inline AccumulatorPair			sweep(HexParallelTeam&, qint64, Function);
+		
+	public:
+	
+		inline explicit								HexKrylovSolver(qreal = 1e-10, qint32 = 1000, qint32 = 30);
+		
+		template<typename Preconditioner = HexIdentityPreconditioner> inline HexKrylovResult	biConjugateGradientStabilised(const Matrix&, const std::vector<Value>&, std::vector<Value>&, const Preconditioner& = Preconditioner());
+		template<typename Preconditioner = HexIdentityPreconditioner> inline HexKrylovResult	conjugateGradient(const Matrix&, const std::vector<Value>&, std::vector<Value>&, const Preconditioner& = Preconditioner());
+		template<typename Preconditioner = HexIdentityPreconditioner> inline HexKrylovResult	generalisedMinimalResidual(const Matrix&, const std::vector<Value>&, std::vector<Value>&, const Preconditioner& = Preconditioner());
+		inline void								setMonitor(Monitor);
+};
+
+template<typename Value>
+void HexIdentityPreconditioner::apply(const std::vector<Value>& r, std::vector<Value>& z) const
+{
+	z = r;
+}
+
+/* The restart length only matters to GMRES, which keeps that many
+ * basis vectors.
+ */
+template<typename Matrix>
+HexKrylovSolver<Matrix>::HexKrylovSolver(qreal newTolerance, qint32 newMaximumNumberOfIterations, qint32 newRestart) :
+	tolerance(newTolerance),
+	maximumNumberOfIterations(newMaximumNumberOfIterations),
+	restart(qMax(newRestart, 1))
+{
+}
+
+/* This returns conj(a)*b, so that sums of it are inner products.
+ */
+template<typename Matrix>
+typename HexKrylovSolver<Matrix>::Accumulator HexKrylovSolver<Matrix>::Product(Value a, Value b)
+{
+	return HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(a))*static_cast<Accumulator>(b);
+}
+
+template<typename Matrix>
+typename HexKrylovSolver<Matrix>::AccumulatorReal HexKrylovSolver<Matrix>::SquaredMagnitude(Value value)
+{
+	return HexScalarTraits<Accumulator>::SquaredMagnitude(static_cast<Accumulator>(value));
+}
+
+/* BiCGSTAB, for general matrices. It needs two products by the matrix and
+ * two preconditioner applications per iteration, but only a fixed amount of
+ * memory. Breakdowns, i.e. a zero rho or omega, stop it unconverged.
+ */
+template<typename Matrix>
+template<typename Preconditioner>
+HexKrylovResult HexKrylovSolver<Matrix>::biConjugateGradientStabilised(const Matrix& matrix, const std::vector<Value>& b, std::vector<Value>& x, const Preconditioner& preconditioner)
+{
+	constexpr auto identity = std::is_same_v<Preconditioner, HexIdentityPreconditioner>;
+	
+	auto team = HexParallelTeam(HexParallel::GetNumberOfThreads(static_cast<qint64>(b.size())));
+	auto result = HexKrylovResult();
+	
+	if (not HexKrylovSolver::initialise(team, matrix, b, x, result))
+		return result;
+	
+	const auto n = static_cast<qint64>(x.size());
+	
+	auto& r = HexKrylovSolver::residual;
+	auto& rHat = HexKrylovSolver::shadowResidual;
+	auto& p = HexKrylovSolver::direction;
+	auto& v = HexKrylovSolver::product;
+	auto& t = HexKrylovSolver::residualProduct;
+	
+	rHat = r;
+	p.assign(n, Value());
+	v.assign(n, Value());
+	t.resize(n);
+	
+	if constexpr (not identity)
+	{
+		HexKrylovSolver::preconditionedDirection.resize(n);
+		HexKrylovSolver::preconditionedResidual.resize(n);
+	}
+	
+	const auto& pHat = (identity ? p : HexKrylovSolver::preconditionedDirection);
+	const auto& sHat = (identity ? r : HexKrylovSolver::preconditionedResidual);
+	
+	auto rho = Accumulator(1);
+	auto alpha = Accumulator(1);
+	auto omega = Accumulator(1);
+	auto nextRho = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+	{
+		auto sum = Accumulator();
+		
+		for (auto i = first; i < last; ++i)
+			sum += HexKrylovSolver::Product(rHat[i], r[i]);
+		
+		return AccumulatorPair(sum, Accumulator());
+	}).first;
+	
+	for (auto iteration = 1; iteration <= HexKrylovSolver::maximumNumberOfIterations; ++iteration)
+	{
+		if (nextRho == Accumulator() or omega == Accumulator())
+			break;
+		
+		const auto beta = static_cast<Value>((nextRho/rho)*(alpha/omega));
+		const auto valueOmega = static_cast<Value>(omega);
+		
+		rho = nextRho;
+		
+		HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			for (auto i = first; i < last; ++i)
+				p[i] = r[i] + beta*(p[i] - valueOmega*v[i]);
+			
+			return AccumulatorPair();
+		});
+		
+		if constexpr (not identity)
+			preconditioner.apply(p, HexKrylovSolver::preconditionedDirection);
+		
+		matrix.multiply(pHat, v);
+		
+		const auto rHatV = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sum = Accumulator();
+			
+			for (auto i = first; i < last; ++i)
+				sum += HexKrylovSolver::Product(rHat[i], v[i]);
+			
+			return AccumulatorPair(sum, Accumulator());
+		}).first;
+		
+		if (rHatV == Accumulator())
+			break;
+		
+		alpha = rho/rHatV;
+		
+		const auto valueAlpha = static_cast<Value>(alpha);
+		const auto ss = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last) // r becomes s = r - alpha*v
+		{
+			auto sum = Accumulator();
+			
+			for (auto i = first; i < last; ++i)
+			{
+				r[i] -= valueAlpha*v[i];
+				sum += HexKrylovSolver::SquaredMagnitude(r[i]);
+			}
+			
+			return AccumulatorPair(Accumulator(), sum);
+		}).second;
+		
+		if (qSqrt(std::real(ss)) <= HexKrylovSolver::tolerance*HexKrylovSolver::normOfRightHandSide)
+		{
+			HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+			{
+				for (auto i = first; i < last; ++i)
+					x[i] += valueAlpha*pHat[i];
+				
+				return AccumulatorPair();
+			});
+			
+			HexKrylovSolver::report(result, iteration, std::real(ss));
+			break;
+		}
+		
+		if constexpr (not identity)
+			preconditioner.apply(r, HexKrylovSolver::preconditionedResidual);
+		
+		matrix.multiply(sHat, t);
+		
+		const auto [ts, tt] = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sums = AccumulatorPair();
+			
+			for (auto i = first; i < last; ++i)
+			{
+				sums.first += HexKrylovSolver::Product(t[i], r[i]);
+				sums.second += HexKrylovSolver::SquaredMagnitude(t[i]);
+			}
+			
+			return sums;
+		});
+		
+		if (tt == Accumulator())
+			break;
+		
+		omega = ts/tt;
+		
+		const auto stabilisingOmega = static_cast<Value>(omega);
+		const auto [rHatR, rr] = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sums = AccumulatorPair();
+			
+			for (auto i = first; i < last; ++i)
+			{
+				x[i] += valueAlpha*pHat[i] + stabilisingOmega*sHat[i]; // Before r, which sHat may be
+				r[i] -= stabilisingOmega*t[i];
+				sums.first += HexKrylovSolver::Product(rHat[i], r[i]);
+				sums.second += HexKrylovSolver::SquaredMagnitude(r[i]);
+			}
+			
+			return sums;
+		});
+		
+		nextRho = rHatR;
+		
+		if (not HexKrylovSolver::report(result, iteration, std::real(rr)))
+			break;
+	}
+	
+	return result;
+}
+
+/* Preconditioned conjugate gradients, for Hermitian positive definite
+ * matrices and preconditioners only. One product by the matrix, one
+ * preconditioner application and three passes over the vectors per
+ * iteration, or two without a preconditioner, since rho then is ||r||^2.
+ */
+template<typename Matrix>
+template<typename Preconditioner>
+HexKrylovResult HexKrylovSolver<Matrix>::conjugateGradient(const Matrix& matrix, const std::vector<Value>& b, std::vector<Value>& x, const Preconditioner& preconditioner)
+{
+	constexpr auto identity = std::is_same_v<Preconditioner, HexIdentityPreconditioner>;
+	
+	auto team = HexParallelTeam(HexParallel::GetNumberOfThreads(static_cast<qint64>(b.size())));
+	auto result = HexKrylovResult();
+	
+	if (not HexKrylovSolver::initialise(team, matrix, b, x, result))
+		return result;
+	
+	const auto n = static_cast<qint64>(x.size());
+	
+	auto& r = HexKrylovSolver::residual;
+	auto& p = HexKrylovSolver::direction;
+	auto& q = HexKrylovSolver::product;
+	
+	q.resize(n);
+	
+	if constexpr (not identity)
+	{
+		HexKrylovSolver::preconditionedResidual.resize(n);
+		preconditioner.apply(r, HexKrylovSolver::preconditionedResidual);
+	}
+	
+	const auto& z = (identity ? r : HexKrylovSolver::preconditionedResidual);
+	
+	p = z;
+	
+	auto rho = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+	{
+		auto sum = Accumulator();
+		
+		for (auto i = first; i < last; ++i)
+			sum += HexKrylovSolver::Product(r[i], z[i]);
+		
+		return AccumulatorPair(sum, Accumulator());
+	}).first;
+	
+	for (auto iteration = 1; iteration <= HexKrylovSolver::maximumNumberOfIterations; ++iteration)
+	{
+		matrix.multiply(p, q);
+		
+		const auto pq = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sum = Accumulator();
+			
+			for (auto i = first; i < last; ++i)
+				sum += HexKrylovSolver::Product(p[i], q[i]);
+			
+			return AccumulatorPair(sum, Accumulator());
+		}).first;
+		
+		if (pq == Accumulator())
+			break;
+		
+		const auto alpha = static_cast<Value>(rho/pq);
+		const auto rr = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sum = Accumulator();
+			
+			for (auto i = first; i < last; ++i)
+			{
+				x[i] += alpha*p[i];
+				r[i] -= alpha*q[i];
+				sum += HexKrylovSolver::SquaredMagnitude(r[i]);
+			}
+			
+			return AccumulatorPair(Accumulator(), sum);
+		}).second;
+		
+		if (not HexKrylovSolver::report(result, iteration, std::real(rr)))
+			break;
+		
+		auto nextRho = rr;
+		
+		if constexpr (not identity)
+		{
+			preconditioner.apply(r, HexKrylovSolver::preconditionedResidual);
+			
+			nextRho = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+			{
+				auto sum = Accumulator();
+				
+				for (auto i = first; i < last; ++i)
+					sum += HexKrylovSolver::Product(r[i], z[i]);
+				
+				return AccumulatorPair(sum, Accumulator());
+			}).first;
+		}
+		
+		const auto beta = static_cast<Value>(nextRho/rho);
+		
+		rho = nextRho;
+		
+		HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			for (auto i = first; i < last; ++i)
+				p[i] = z[i] + beta*p[i];
+			
+			return AccumulatorPair();
+		});
+	}
+	
+	return result;
+}
+
+/* GMRES(m), where m is the restart length. The basis is orthogonalised with
+ * modified Gram-Schmidt, each subtraction being fused with the next inner
+ * product, and the least-squares problem is kept triangular by Givens
+ * rotations, whose last component is the residual at no cost. x is only
+ * updated at the end of a cycle, or when the solver stops, after which the
+ * true residual is computed again from scratch.
+ */
+template<typename Matrix>
+template<typename Preconditioner>
+HexKrylovResult HexKrylovSolver<Matrix>::generalisedMinimalResidual(const Matrix& matrix, const std::vector<Value>& b, std::vector<Value>& x, const Preconditioner& preconditioner)
+{
+	constexpr auto identity = std::is_same_v<Preconditioner, HexIdentityPreconditioner>;
+	
+	auto team = HexParallelTeam(HexParallel::GetNumberOfThreads(static_cast<qint64>(b.size())));
+	auto result = HexKrylovResult();
+	
+	if (not HexKrylovSolver::initialise(team, matrix, b, x, result))
+		return result;
+	
+	const auto n = static_cast<qint64>(x.size());
+	const auto m = static_cast<qint64>(HexKrylovSolver::restart);
+	
+	auto& r = HexKrylovSolver::residual;
+	auto& u = HexKrylovSolver::product;
+	auto& z = HexKrylovSolver::preconditionedDirection;
+	auto& g = HexKrylovSolver::rotatedResidual;
+	auto& cosines = HexKrylovSolver::rotationCosines;
+	auto& sines = HexKrylovSolver::rotationSines;
+	
+	HexKrylovSolver::basis.resize(m + 1);
+	HexKrylovSolver::hessenberg.resize((m + 1)*m);
+	cosines.resize(m);
+	sines.resize(m);
+	g.resize(m + 1);
+	u.resize(n);
+	
+	for (auto& vector : HexKrylovSolver::basis)
+		vector.resize(n);
+	
+	if constexpr (not identity)
+		z.resize(n);
+	
+	const auto H = [&](qint64 i, qint64 j) -> Accumulator& { return HexKrylovSolver::hessenberg[j*(m + 1) + i]; };
+	const auto magnitude = [](Accumulator value) { return qSqrt(static_cast<qreal>(HexScalarTraits<Accumulator>::SquaredMagnitude(value))); };
+	
+	auto iteration = 0;
+	auto stopped = false;
+	
+	while (not result.converged and not stopped and iteration < HexKrylovSolver::maximumNumberOfIterations)
+	{
+		const auto normOfResidual = result.residual*HexKrylovSolver::normOfRightHandSide;
+		const auto inverseNorm = static_cast<Value>(1./normOfResidual);
+		auto& v0 = HexKrylovSolver::basis[0];
+		
+		HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			for (auto i = first; i < last; ++i)
+				v0[i] = inverseNorm*r[i];
+			
+			return AccumulatorPair();
+		});
+		
+		std::fill(g.begin(), g.end(), Accumulator());
+		g[0] = static_cast<Accumulator>(normOfResidual);
+		
+		auto j = qint64(0);
+		
+		while (j < m and iteration < HexKrylovSolver::maximumNumberOfIterations)
+		{
+			auto& w = HexKrylovSolver::basis[j + 1];
+			
+			if constexpr (identity)
+				matrix.multiply(HexKrylovSolver::basis[j], w);
+			else
+			{
+				preconditioner.apply(HexKrylovSolver::basis[j], z);
+				matrix.multiply(z, w);
+			}
+			
+			auto h = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+			{
+				auto sum = Accumulator();
+				
+				for (auto k = first; k < last; ++k)
+					sum += HexKrylovSolver::Product(v0[k], w[k]);
+				
+				return AccumulatorPair(sum, Accumulator());
+			}).first;
+			
+			auto ww = Accumulator();
+			
+			for (auto i = qint64(0); i <= j; ++i)
+			{
+				const auto& vi = HexKrylovSolver::basis[i];
+				const auto& next = (i < j ? HexKrylovSolver::basis[i + 1] : w);
+				const auto valueH = static_cast<Value>(h);
+				
+				H(i, j) = h;
+				
+				std::tie(h, ww) = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+				{
+					auto sums = AccumulatorPair();
+					
+					for (auto k = first; k < last; ++k)
+					{
+						w[k] -= valueH*vi[k];
+						sums.first += HexKrylovSolver::Product(next[k], w[k]);
+						sums.second += HexKrylovSolver::SquaredMagnitude(w[k]);
+					}
+					
+					return sums;
+				});
+			}
+			
+			const auto normOfW = qSqrt(static_cast<qreal>(std::real(ww)));
+			
+			if (normOfW > 0.)
+			{
+				const auto inverseNormOfW = static_cast<Value>(1./normOfW);
+				
+				HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+				{
+					for (auto k = first; k < last; ++k)
+						w[k] *= inverseNormOfW;
+					
+					return AccumulatorPair();
+				});
+			}
+			
+			for (auto i = qint64(0); i < j; ++i)
+			{
+				const auto upper = H(i, j);
+				
+				H(i, j) = static_cast<Accumulator>(cosines[i])*upper + sines[i]*H(i + 1, j);
+				H(i + 1, j) = static_cast<Accumulator>(cosines[i])*H(i + 1, j) - HexScalarTraits<Accumulator>::Conjugate(sines[i])*upper;
+			}
+			
+			const auto diagonal = H(j, j);
+			const auto normOfDiagonal = magnitude(diagonal);
+			const auto radius = qSqrt(normOfDiagonal*normOfDiagonal + normOfW*normOfW);
+			
+			if (normOfDiagonal == 0.)
+			{
+				cosines[j] = AccumulatorReal();
+				sines[j] = Accumulator(1);
+			}
+			else
+			{
+				cosines[j] = static_cast<AccumulatorReal>(normOfDiagonal/radius);
+				sines[j] = (diagonal/static_cast<Accumulator>(normOfDiagonal))*static_cast<Accumulator>(normOfW/radius);
+			}
+			
+			H(j, j) = static_cast<Accumulator>(cosines[j])*diagonal + sines[j]*static_cast<Accumulator>(normOfW);
+			g[j + 1] = -HexScalarTraits<Accumulator>::Conjugate(sines[j])*g[j];
+			g[j] *= static_cast<Accumulator>(cosines[j]);
+			
+			++iteration;
+			++j;
+			
+			const auto rr = HexScalarTraits<Accumulator>::SquaredMagnitude(g[j]);
+			
+			stopped = not HexKrylovSolver::report(result, iteration, static_cast<AccumulatorReal>(rr));
+			
+			if (result.converged or stopped or normOfW == 0.)
+				break;
+		}
+		
+		for (auto i = j - 1; i >= 0; --i) // g becomes y, the coordinates of the update in the basis
+		{
+			for (auto k = i + 1; k < j; ++k)
+				g[i] -= H(i, k)*g[k];
+			
+			g[i] = (H(i, i) == Accumulator() ? Accumulator() : g[i]/H(i, i));
+		}
+		
+		HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			for (auto k = first; k < last; ++k)
+			{
+				auto sum = Accumulator();
+				
+				for (auto i = qint64(0); i < j; ++i)
+					sum += g[i]*static_cast<Accumulator>(HexKrylovSolver::basis[i][k]);
+				
+				u[k] = static_cast<Value>(sum);
+			}
+			
+			return AccumulatorPair();
+		});
+		
+		if constexpr (not identity)
+			preconditioner.apply(u, z);
+		
+		const auto& update = (identity ? u : z);
+		
+		HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			for (auto k = first; k < last; ++k)
+				x[k] += update[k];
+			
+			return AccumulatorPair();
+		});
+		
+		matrix.multiply(x, r);
+		
+		const auto rr = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+		{
+			auto sum = Accumulator();
+			
+			for (auto k = first; k < last; ++k)
+			{
+				r[k] = b[k] - r[k];
+				sum += HexKrylovSolver::SquaredMagnitude(r[k]);
+			}
+			
+			return AccumulatorPair(Accumulator(), sum);
+		}).second;
+		
+		result.residual = static_cast<qreal>(qSqrt(static_cast<qreal>(std::real(rr)))/HexKrylovSolver::normOfRightHandSide);
+		result.converged = (result.residual <= HexKrylovSolver::tolerance);
+	}
+	
+	return result;
+}
+
+/* This checks that the system is square, sets x to zero if it isn't the
+ * initial guess, and computes r = b - Ax. It returns false when there is
+ * nothing to iterate, because the system is wrong or already solved.
+ */
+template<typename Matrix>
+bool HexKrylovSolver<Matrix>::initialise(HexParallelTeam& team, const Matrix& matrix, const std::vector<Value>& b, std::vector<Value>& x, HexKrylovResult& result)
+{
+	const auto n = static_cast<qint64>(matrix.getNumberOfColumns());
+	
+	if (static_cast<qint64>(matrix.getNumberOfRows()) != n or static_cast<qint64>(b.size()) != n)
+		return false;
+	
+	if (static_cast<qint64>(x.size()) != n)
+		x.assign(n, Value());
+	
+	auto& r = HexKrylovSolver::residual;
+	
+	r.resize(n);
+	matrix.multiply(x, r);
+	
+	const auto [bb, rr] = HexKrylovSolver::sweep(team, n, [&](qint64 first, qint64 last)
+	{
+		auto sums = AccumulatorPair();
+		
+		for (auto i = first; i < last; ++i)
+		{
+			r[i] = b[i] - r[i];
+			sums.first += HexKrylovSolver::SquaredMagnitude(b[i]);
+			sums.second += HexKrylovSolver::SquaredMagnitude(r[i]);
+		}
+		
+		return sums;
+	});
+	
+	HexKrylovSolver::normOfRightHandSide = static_cast<AccumulatorReal>(qSqrt(static_cast<qreal>(std::real(bb))));
+	
+	if (HexKrylovSolver::normOfRightHandSide == AccumulatorReal())
+	{
+		std::fill(x.begin(), x.end(), Value());
+		result.converged = true;
+		return false;
+	}
+	
+	result.residual = static_cast<qreal>(qSqrt(static_cast<qreal>(std::real(rr)))/HexKrylovSolver::normOfRightHandSide);
+	result.converged = (result.residual <= HexKrylovSolver::tolerance);
+	
+	return not result.converged;
+}
+
+/* rr is the squared norm of the residual.
+ */
+template<typename Matrix>
+bool HexKrylovSolver<Matrix>::report(HexKrylovResult& result, qint32 iteration, AccumulatorReal rr) const
+{
+	result.numberOfIterations = iteration;
+	result.residual = static_cast<qreal>(qSqrt(static_cast<qreal>(rr))/HexKrylovSolver::normOfRightHandSide);
+	result.converged = (result.residual <= HexKrylovSolver::tolerance);
+	
+	if (HexKrylovSolver::monitor and not HexKrylovSolver::monitor(iteration, result.residual))
+		return false;
+	
+	return not result.converged;
+}
+
+template<typename Matrix>
+void HexKrylovSolver<Matrix>::setMonitor(Monitor newMonitor)
+{
+	HexKrylovSolver::monitor = std::move(newMonitor);
+}
+
+/* This runs function(first, last) over equal slices of [0, length), one per
+ * thread of the team, and adds up the pairs of sums it returns, always in
+ * the same order, so that results don't depend on which thread finishes
+ * first.
+ */
+template<typename Matrix>
+template<typename Function>
+typename HexKrylovSolver<Matrix>::AccumulatorPair HexKrylovSolver<Matrix>::sweep(HexParallelTeam& team, qint64 length, Function function)
+{
+	const auto numberOfThreads = team.getNumberOfThreads();
+	
+	if (HexKrylovSolver::partialSums.size() < static_cast<std::size_t>(numberOfThreads))
+		HexKrylovSolver::partialSums.resize(numberOfThreads);
+	
+	team.run([&](qint32 thread)
+	{
+		const auto first = length*thread/numberOfThreads;
+		const auto last = length*(thread + 1)/numberOfThreads;
+		
+		HexKrylovSolver::partialSums[thread] = function(first, last);
+	});
+	
+	auto sums = AccumulatorPair();
+	
+	for (auto thread = 0; thread < numberOfThreads; ++thread)
+	{
+		sums.first += HexKrylovSolver::partialSums[thread].first;
+		sums.second += HexKrylovSolver::partialSums[thread].second;
+	}
+	
+	return sums;
+}
+
+#endif
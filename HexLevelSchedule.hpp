@@ -0,0 +1,167 @@
+#ifndef __HEX_LEVEL_SCHEDULE_HPP__
+#define __HEX_LEVEL_SCHEDULE_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <barrier>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+
+enum class HexTriangle
+{
+	Lower,	// Row i depends on the rows j < i it has a value in
+	Upper	// Row i depends on the rows j > i it has a value in
+};
+
+/* Rows of a sparse triangular solve, or of an incomplete factorization, can
+ * only be computed after the rows they depend on. Putting every row on the
+ * level after the deepest of these, all the rows of a level are independent,
+ * and can be shared between threads, with a barrier before the next level.
+ * Levels are computed once from the pattern, and reused by every solve.
+ * Patterns where levels are too narrow to keep several threads busy, like
+ * that of a tridiagonal matrix, are simply run in order on a single thread.
+ */
+template<typename Index>
+class HexLevelSchedule
+{
+	private:
+	
+		static constexpr qint64							MinimumRowsPerThread = 64;
+		
+		HexTriangle								triangle = HexTriangle::Lower;
+		qint32									numberOfThreads = 1;
+		std::vector<Index>							rows;			// Sorted by level, then by row
+		std::vector<Index>							levelOffsets;		// Level l is rows[levelOffsets[l]] to rows[levelOffsets[l + 1] - 1]
+		
+	public:
+	
+		inline									HexLevelSchedule(void);
+		template<typename Matrix> inline					HexLevelSchedule(const Matrix&, HexTriangle);
+		
+		inline Index								getNumberOfLevels(void) const;
+		inline qint32								getNumberOfThreads(void) const;
+		template<typename Function> inline void					run(Function) const;
+};
+
+template<typename Index>
+HexLevelSchedule<Index>::HexLevelSchedule(void) : levelOffsets(1, 0)
+{
+}
+
+/* Only the values on the triangle side of the diagonal are looked at, and
+ * columns beyond the last row are ignored, so that the matrix doesn't have
+ * to be triangular itself, e.g. ILU(0) schedules both of its solves from A.
+ */
+template<typename Index>
+template<typename Matrix>
+HexLevelSchedule<Index>::HexLevelSchedule(const Matrix& matrix, HexTriangle newTriangle) : triangle(newTriangle)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = matrix.getNumberOfRows();
+	const auto lower = (newTriangle == HexTriangle::Lower);
+	
+	auto levels = std::vector<Index>(numberOfRows, 0);
+	auto numberOfLevels = Index(numberOfRows > 0 ? 1 : 0);
+	
+	for (auto step = Index(0); step < numberOfRows; ++step)
+	{
+		const auto row = (lower ? step : numberOfRows - 1 - step);
+		auto level = Index(0);
+		
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto column = pairs[index].column;
+			
+			if ((lower and column < row) or (not lower and column > row and column < numberOfRows))
+				level = std::max(level, static_cast<Index>(levels[column] + 1));
+		}
+		
+		levels[row] = level;
+		numberOfLevels = std::max(numberOfLevels, static_cast<Index>(level + 1));
+	}
+	
+	HexLevelSchedule::levelOffsets.assign(numberOfLevels + 1, 0);
+	
+	for (const auto level : levels)
+		++HexLevelSchedule::levelOffsets[level + 1];
+	
+	for (auto level = Index(0); level < numberOfLevels; ++level)
+		HexLevelSchedule::levelOffsets[level + 1] += HexLevelSchedule::levelOffsets[level];
+	
+	auto positions = std::vector<Index>(HexLevelSchedule::levelOffsets.cbegin(), HexLevelSchedule::levelOffsets.cend() - 1);
+	
+	HexLevelSchedule::rows.resize(numberOfRows);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+		HexLevelSchedule::rows[positions[levels[row]]++] = row;
+	
+	const auto averageWidth = (numberOfLevels > 0 ? static_cast<qint64>(numberOfRows)/static_cast<qint64>(numberOfLevels) : 0);
+	const auto widthThreads = std::max(averageWidth/HexLevelSchedule::MinimumRowsPerThread, static_cast<qint64>(1));
+	
+	HexLevelSchedule::numberOfThreads = static_cast<qint32>(std::min(static_cast<qint64>(HexParallel::GetNumberOfThreads(static_cast<qint64>(pairs.size()))), widthThreads));
+}
+
+template<typename Index>
+Index HexLevelSchedule<Index>::getNumberOfLevels(void) const
+{
+	return static_cast<Index>(HexLevelSchedule::levelOffsets.size() - 1);
+}
+
+template<typename Index>
+qint32 HexLevelSchedule<Index>::getNumberOfThreads(void) const
+{
+	return HexLevelSchedule::numberOfThreads;
+}
+
+/* This calls function(row) for every row, never before the rows it depends
+ * on. On a single thread, plain row order does that too, and is friendlier
+ * to the cache than level order. Threads are spawned once per run, not once
+ * per level, and wait for each other at the end of every level.
+ */
+template<typename Index>
+template<typename Function>
+void HexLevelSchedule<Index>::run(Function function) const
+{
+	const auto numberOfRows = static_cast<Index>(HexLevelSchedule::rows.size());
+	
+	if (HexLevelSchedule::numberOfThreads < 2)
+	{
+		if (HexLevelSchedule::triangle == HexTriangle::Lower)
+			for (auto row = Index(0); row < numberOfRows; ++row)
+				function(row);
+		else
+			for (auto row = numberOfRows - 1; row >= 0; --row)
+				function(row);
+		
+		return;
+	}
+	
+	const auto numberOfLevels = HexLevelSchedule::getNumberOfLevels();
+	const auto numberOfThreads = HexLevelSchedule::numberOfThreads;
+	
+	auto barrier = std::barrier(numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto level = Index(0); level < numberOfLevels; ++level)
+		{
+			const auto firstIndex = static_cast<qint64>(HexLevelSchedule::levelOffsets[level]);
+			const auto width = static_cast<qint64>(HexLevelSchedule::levelOffsets[level + 1]) - firstIndex;
+			const auto stopIndex = firstIndex + width*(thread + 1)/numberOfThreads;
+			
+			for (auto index = firstIndex + width*thread/numberOfThreads; index < stopIndex; ++index)
+				function(HexLevelSchedule::rows[index]);
+			
+			barrier.arrive_and_wait();
+		}
+	});
+}
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef __HEX_MATRIX_MARKET_HPP__
+#define __HEX_MATRIX_MARKET_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Qt Libraries
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrix.hpp"
+#include "HexSparseMatrixBuilder.hpp"
+
+enum class HexMatrixMarketSymmetry
+{
+	General,	// Every value is in the file
+	Symmetric,	// Only the lower triangle is, and A(j, i) = A(i, j)
+	SkewSymmetric,	// Only the strictly lower triangle is, and A(j, i) = -A(i, j)
+	Hermitian	// Only the lower triangle is, and A(j, i) = conj(A(i, j)), which is Symmetric for real values
+};
+
+/* Reading and writing of Matrix Market files, in the coordinate format,
+ * which is the one sparse matrix collections come in. Reading maps the
+ * file and cuts it into chunks at line breaks, which threads parse on
+ * their own into triplets, then hands these to HexBasicSparseMatrixBuilder.
+ * Writing streams the matrix row by row through a buffer of fixed size,
+ * so that it needs no more memory whatever the size of the matrix.
+ */
+class HexMatrixMarket
+{
+	private:
+	
+		static constexpr qint64							BufferSize = 1 << 20;
+		static constexpr qint64							MaximumLineLength = 128;
+		
+		inline static const char*						EndOfLine(const char*, const char*);
+		inline static const char*						NextLine(const char*, const char*);
+		template<typename Value, typename Index> inline static bool		ParseChunk(const char*, const char*, Index, Index, bool, bool, HexMatrixMarketSymmetry, std::vector<HexBasicRowColumnValueTriplet<Value, Index>>&, qint64&);
+		template<typename Type> inline static bool				ParseNumber(const char*&, const char*, Type&);
+		
+	public:
+	
+		template<typename Matrix> inline static bool				Read(const QString&, Matrix&);
+		template<typename Matrix> inline static bool				Write(const Matrix&, const QString&, HexMatrixMarketSymmetry = HexMatrixMarketSymmetry::General);
+};
+
+const char* HexMatrixMarket::EndOfLine(const char* beg, const char* end)
+{
+	if (beg >= end)
+		return end;
+	
+	const auto it = static_cast<const char*>(std::memchr(beg, '\n', static_cast<std::size_t>(end - beg)));
+	return (it != nullptr ? it : end);
+}
+
+/* This is the start of the line after the one it is in, or the end of the
+ * file if it is in the last one.
+ */
+const char* HexMatrixMarket::NextLine(const char* it, const char* end)
+{
+	const auto lineEnd = HexMatrixMarket::EndOfLine(it, end);
+	return (lineEnd < end ? lineEnd + 1 : end);
+}
+
+/* Every line of the chunk is either blank, a comment, or a value, which
+ * also gets mirrored across the diagonal for symmetric files, and can't be
+ * on it for skew-symmetric ones, nor be complex on it for Hermitian ones.
+ * Values of pattern files are all 1, and those of complex files are a real
+ * part followed by an imaginary one. Anything else, including anything but
+ * spaces after the value, makes the whole file invalid.
+ */
+template<typename Value, typename Index>
+bool HexMatrixMarket::ParseChunk(const char* beg, const char* end, Index numberOfRows, Index numberOfColumns, bool pattern, bool complex, HexMatrixMarketSymmetry symmetry, std::vector<HexBasicRowColumnValueTriplet<Value, Index>>& triplets, qint64& numberOfEntries)
+{
+	using Real = typename HexScalarTraits<Value>::Real;
+	
+	
+	for (auto it = beg; it < end; )
+	{
+		const auto lineEnd = HexMatrixMarket::EndOfLine(it, end);
+		
+		while (it < lineEnd and (*it == ' ' or *it == '\t' or *it == '\r'))
+			++it;
+		
+		if (it == lineEnd or *it == '%')
+		{
+			it = (lineEnd < end ? lineEnd + 1 : end);
+			continue;
+		}
+		
+		auto row = qint64(0);
+		auto column = qint64(0);
+		auto realPart = Real(1);
+		auto imaginaryPart = Real();
+		
+		if (not HexMatrixMarket::ParseNumber(it, lineEnd, row) or not HexMatrixMarket::ParseNumber(it, lineEnd, column) or (not pattern and not HexMatrixMarket::ParseNumber(it, lineEnd, realPart)) or (complex and not HexMatrixMarket::ParseNumber(it, lineEnd, imaginaryPart)))
+			return false;
+		
+		while (it < lineEnd and (*it == ' ' or *it == '\t' or *it == '\r'))
+			++it;
+		
+		if (it != lineEnd or row < 1 or row > numberOfRows or column < 1 or column > numberOfColumns)
+			return false;
+		
+		if ((symmetry == HexMatrixMarketSymmetry::SkewSymmetric or (symmetry == HexMatrixMarketSymmetry::Hermitian and imaginaryPart != Real())) and row == column)
+			return false;
+		
+		auto value = Value(realPart);
+		
+		if constexpr (not std::is_same_v<Value, Real>)
+			value.imag(imaginaryPart);
+		
+		triplets.emplace_back(value, static_cast<Index>(row - 1), static_cast<Index>(column - 1));
+		++numberOfEntries;
+		
+		if (symmetry == HexMatrixMarketSymmetry::General or row == column)
+		{
+			it = (lineEnd < end ? lineEnd + 1 : end);
+			continue;
+		}
+		
+		if (symmetry == HexMatrixMarketSymmetry::Symmetric)
+			triplets.emplace_back(value, static_cast<Index>(column - 1), static_cast<Index>(row - 1));
+		else if (symmetry == HexMatrixMarketSymmetry::SkewSymmetric)
+			triplets.emplace_back(-value, static_cast<Index>(column - 1), static_cast<Index>(row - 1));
+		else
+			triplets.emplace_back(HexScalarTraits<Value>::Conjugate(value), static_cast<Index>(column - 1), static_cast<Index>(row - 1));
+		
+		it = (lineEnd < end ? lineEnd + 1 : end);
+	}
+	
+	return true;
+}
+
+/* std::from_chars doesn't skip spaces, nor accept a leading plus sign.
+ */
+template<typename Type>
+bool HexMatrixMarket::ParseNumber(const char*& it, const char* end, Type& number)
+{
+	while (it < end and (*it == ' ' or *it == '\t'))
+		++it;
+	
+	if (it < end and *it == '+')
+		++it;
+	
+	const auto [ptr, ec] = std::from_chars(it, end, number);
+	
+	if (ec != std::errc() or (ptr < end and *ptr != ' ' and *ptr != '\t' and *ptr != '\r'))
+		return false;
+	
+	it = ptr;
+	return true;
+}
+
+/* Any coordinate file can be read into a matrix of complex values, but
+ * complex files can't be read into one of real values. Sizes must fit in
+ * the Index of the matrix. Duplicates are summed, and explicit zeroes
+ * dropped, as the builder does. The matrix is left untouched if the file
+ * can't be read.
+ */
+template<typename Matrix>
+bool HexMatrixMarket::Read(const QString& fileName, Matrix& matrix)
+{
+	using Index = typename Matrix::IndexType;
+	using Value = typename Matrix::ValueType;
+	
+	constexpr auto IsComplex = (not std::is_same_v<Value, typename HexScalarTraits<Value>::Real>);
+	
+	
+	auto file = QFile(fileName);
+	
+	if (not file.open(QIODevice::ReadOnly))
+		return false;
+	
+	const auto fileSize = file.size();
+	const auto memory = (fileSize > 0 ? file.map(0, fileSize) : nullptr);
+	
+	if (memory == nullptr)
+		return false;
+	
+	const auto beg = reinterpret_cast<const char*>(memory);
+	const auto end = beg + fileSize;
+	
+	auto banner = std::string(beg, HexMatrixMarket::EndOfLine(beg, end));
+	std::transform(banner.cbegin(), banner.cend(), banner.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	
+	auto words = std::vector<std::string>();
+	
+	for (auto position = std::size_t(0); (position = banner.find_first_not_of(" \t\r", position)) != std::string::npos; )
+	{
+		const auto wordEnd = banner.find_first_of(" \t\r", position);
+		
+		words.emplace_back(banner.substr(position, wordEnd - position));
+		position = wordEnd;
+	}
+	
+	if (words.size() != 5 or words[0] != "%%matrixmarket" or words[1] != "matrix" or words[2] != "coordinate")
+		return false;
+	
+	if (words[3] != "real" and words[3] != "double" and words[3] != "integer" and words[3] != "pattern" and (words[3] != "complex" or not IsComplex))
+		return false;
+	
+	auto symmetry = HexMatrixMarketSymmetry::General;
+	
+	if (words[4] == "symmetric")
+		symmetry = HexMatrixMarketSymmetry::Symmetric;
+	else if (words[4] == "hermitian")
+		symmetry = HexMatrixMarketSymmetry::Hermitian;
+	else if (words[4] == "skew-symmetric")
+		symmetry = HexMatrixMarketSymmetry::SkewSymmetric;
+	else if (words[4] != "general")
+		return false;
+	
+	auto it = HexMatrixMarket::NextLine(beg, end);
+	
+	while (it < end and (*it == '%' or *it == '\n' or *it == '\r')) // Comments, which may only come before the size line.
+		it = HexMatrixMarket::NextLine(it, end);
+	
+	const auto sizeLineEnd = HexMatrixMarket::EndOfLine(it, end);
+	
+	auto numberOfRows = qint64(0);
+	auto numberOfColumns = qint64(0);
+	auto numberOfEntries = qint64(0);
+	
+	if (it >= end or not HexMatrixMarket::ParseNumber(it, sizeLineEnd, numberOfRows) or not HexMatrixMarket::ParseNumber(it, sizeLineEnd, numberOfColumns) or not HexMatrixMarket::ParseNumber(it, sizeLineEnd, numberOfEntries))
+		return false;
+	
+	while (it < sizeLineEnd and (*it == ' ' or *it == '\t' or *it == '\r'))
+		++it;
+	
+	if (it != sizeLineEnd) // Anything after the three sizes.
+		return false;
+	
+	if (numberOfRows < 0 or numberOfRows > std::numeric_limits<Index>::max() or numberOfColumns < 0 or numberOfColumns > std::numeric_limits<Index>::max() or numberOfEntries < 0)
+		return false;
+	
+	const auto dataBeg = HexMatrixMarket::NextLine(sizeLineEnd, end);
+	const auto dataSize = static_cast<qint64>(end - dataBeg);
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(dataSize);
+	
+	auto chunkBoundaries = std::vector<const char*>(numberOfThreads + 1, end);
+	chunkBoundaries[0] = dataBeg;
+	
+	for (auto thread = 1; thread < numberOfThreads; ++thread) // Chunks start right after a line break, so that no line is cut in two.
+		chunkBoundaries[thread] = HexMatrixMarket::NextLine(qMax(dataBeg + dataSize*thread/numberOfThreads, chunkBoundaries[thread - 1]), end);
+	
+	auto triplets = std::vector<std::vector<HexBasicRowColumnValueTriplet<Value, Index>>>(numberOfThreads);
+	auto entryCounts = std::vector<qint64>(numberOfThreads, 0);
+	auto valid = std::vector<char>(numberOfThreads, 0);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto chunkSize = static_cast<qint64>(chunkBoundaries[thread + 1] - chunkBoundaries[thread]);
+		triplets[thread].reserve(static_cast<std::size_t>(qMin(chunkSize/8 + 1, numberOfEntries*(symmetry == HexMatrixMarketSymmetry::General ? 1 : 2)))); // Only a guess, few lines are shorter than 8 bytes.
+		
+		valid[thread] = HexMatrixMarket::ParseChunk(chunkBoundaries[thread], chunkBoundaries[thread + 1], static_cast<Index>(numberOfRows), static_cast<Index>(numberOfColumns), words[3] == "pattern", words[3] == "complex", symmetry, triplets[thread], entryCounts[thread]);
+	});
+	
+	file.unmap(memory);
+	
+	auto numberOfTriplets = qint64(0);
+	
+	for (auto thread = 0; thread < numberOfThreads; ++thread)
+	{
+		if (not valid[thread])
+			return false;
+		
+		numberOfEntries -= entryCounts[thread];
+		numberOfTriplets += static_cast<qint64>(triplets[thread].size());
+	}
+	
+	if (numberOfEntries != 0) // The file was cut short, or has more values than it says.
+		return false;
+	
+	auto builder = HexBasicSparseMatrixBuilder<Value, Index>(static_cast<Index>(numberOfRows), static_cast<Index>(numberOfColumns));
+	builder.reserve(numberOfTriplets);
+	
+	for (auto& chunkTriplets : triplets)
+	{
+		for (const auto& triplet : chunkTriplets)
+			builder.addValue(triplet.row, triplet.column, triplet.value);
+		
+		chunkTriplets = std::vector<HexBasicRowColumnValueTriplet<Value, Index>>();
+	}
+	
+	matrix = Matrix(builder.build()); // The builder only builds the default layout.
+	return true;
+}
+
+/* Symmetric and Hermitian matrices are written as their lower triangle, and
+ * skew-symmetric ones as their strictly lower triangle, without checking that
+ * the upper one matches. Values are written with the fewest digits that read back exactly.
+ */
+template<typename Matrix>
+bool HexMatrixMarket::Write(const Matrix& matrix, const QString& fileName, HexMatrixMarketSymmetry symmetry)
+{
+	using Value = typename Matrix::ValueType;
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = static_cast<qint64>(matrix.getNumberOfRows());
+	const auto kept = [symmetry](qint64 row, qint64 column) { return (symmetry == HexMatrixMarketSymmetry::General or column < row or (column == row and symmetry != HexMatrixMarketSymmetry::SkewSymmetric)); };
+	
+	auto numberOfEntries = qint64(0);
+	
+	for (auto row = qint64(0); row < numberOfRows; ++row)
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+			numberOfEntries += (kept(row, pairs[index].column) ? 1 : 0);
+	
+	auto file = QFile(fileName);
+	
+	if (not file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	
+	auto buffer = std::string();
+	auto written = true;
+	
+	const auto field = (std::is_integral_v<Value> ? "integer" : (std::is_floating_point_v<Value> ? "real" : "complex"));
+	const auto symmetryName = (symmetry == HexMatrixMarketSymmetry::General ? "general" : (symmetry == HexMatrixMarketSymmetry::Symmetric ? "symmetric" : (symmetry == HexMatrixMarketSymmetry::Hermitian ? "hermitian" : "skew-symmetric")));
+	
+	buffer.reserve(HexMatrixMarket::BufferSize);
+	buffer.append("%%MatrixMarket matrix coordinate ").append(field).append(" ").append(symmetryName).append("\n");
+	
+	const auto append = [&buffer](auto number, char separator)
+	{
+		char digits[HexMatrixMarket::MaximumLineLength/4];
+		
+		const auto [ptr, ec] = std::to_chars(digits, digits + sizeof(digits), number);
+		
+		buffer.append(digits, ptr);
+		buffer.push_back(separator);
+	};
+	
+	append(numberOfRows, ' ');
+	append(static_cast<qint64>(matrix.getNumberOfColumns()), ' ');
+	append(numberOfEntries, '\n');
+	
+	for (auto row = qint64(0); row < numberOfRows; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto column = static_cast<qint64>(pairs[index].column);
+			const auto value = static_cast<Value>(pairs[index].value);
+			
+			if (not kept(row, column))
+				continue;
+			
+			append(row + 1, ' ');
+			append(column + 1, ' ');
+			
+			if constexpr (std::is_arithmetic_v<Value>)
+				append(value, '\n');
+			else
+			{
+				append(value.real(), ' ');
+				append(value.imag(), '\n');
+			}
+			
+			if (static_cast<qint64>(buffer.size()) > HexMatrixMarket::BufferSize - HexMatrixMarket::MaximumLineLength)
+			{
+				written = written and file.write(buffer.data(), static_cast<qint64>(buffer.size())) == static_cast<qint64>(buffer.size());
+				buffer.clear();
+			}
+		}
+	}
+	
+	written = written and file.write(buffer.data(), static_cast<qint64>(buffer.size())) == static_cast<qint64>(buffer.size());
+	file.close();
+	
+	return written;
+}
+
+#endif
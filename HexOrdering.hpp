@@ -0,0 +1,888 @@
+#ifndef __HEX_ORDERING_HPP__
+#define __HEX_ORDERING_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+#include <QtMath>
+
+struct HexBandwidthProfile
+{
+	qint64	bandwidth = 0;	// Largest |i - j| over the values
+	qint64	profile = 0;	// Sum over rows i of i - j, j being the first column of row i in the lower triangle
+};
+
+/* Orderings only look at the pattern of a matrix, through its
+ * getPairs and getRowOffsets, and return permutations where
+ * element k is the index of the row or column that goes to k.
+ * Symmetric orderings are meant for A -> PAP', i.e. for permute
+ * with the same permutation for rows and columns, and look at the
+ * pattern of A + A', so that A doesn't need a symmetric one.
+ */
+class HexOrdering
+{
+	private:
+	
+		static constexpr qint64							NestedDissectionLeafSize = 128;
+		
+		template<typename Index> inline static std::vector<Index>			ApproximateMinimumDegree(const std::vector<qint64>&, const std::vector<Index>&);
+		template<typename Index> inline static void					Dissect(const std::vector<qint64>&, const std::vector<Index>&, const std::vector<Index>&, std::vector<qint64>&, qint64&, std::vector<Index>&, std::vector<Index>&);
+		template<typename Index> inline static void					LevelStructure(const std::vector<qint64>&, const std::vector<Index>&, const std::vector<qint64>&, Index, std::vector<Index>&, std::vector<Index>&, std::vector<Index>&);
+		template<typename Index> inline static Index					PseudoPeripheralNode(const std::vector<qint64>&, const std::vector<Index>&, const std::vector<qint64>&, Index, std::vector<Index>&, std::vector<Index>&, std::vector<Index>&);
+		template<typename Matrix> inline static void					SymmetricPattern(const Matrix&, std::vector<qint64>&, std::vector<typename Matrix::IndexType>&);
+		
+	public:
+	
+		static constexpr qreal							DenseRowRatio = 10.;
+		
+		template<typename Matrix> inline static std::vector<typename Matrix::IndexType>	ColumnMinimumDegree(const Matrix&);
+		template<typename Matrix> inline static HexBandwidthProfile			GetBandwidthProfile(const Matrix&, const std::vector<typename Matrix::IndexType>& = {});
+		template<typename Matrix> inline static std::vector<typename Matrix::IndexType>	MinimumDegree(const Matrix&);
+		template<typename Matrix> inline static std::vector<typename Matrix::IndexType>	NestedDissection(const Matrix&);
+		template<typename Matrix> inline static std::vector<typename Matrix::IndexType>	ReverseCuthillMcKee(const Matrix&);
+};
+
+/* This is MinimumDegree on a graph given as adjacency lists, without
+ * loops, which NestedDissection uses for the parts it doesn't cut any
+ * further. It is approximate minimum degree, as in AMD: the graph is kept
+ * as a quotient graph of variables, each with the variables it is still
+ * adjacent to and the elements it is in, an element being the clique left by
+ * an eliminated variable. The degree of a variable i next to the pivot p is
+ * bounded by |A(i)| + |L(p)| plus the sum over its other elements e of
+ * |L(e) \ L(p)|, which are all counted in a single pass over L(p). Elements
+ * found to be inside L(p) on the way are absorbed, and so are the variables
+ * of A(i) which L(p) now covers. Variables of L(p) left with the same
+ * variables and elements are merged into one, weighing as many, and are
+ * eliminated together. Rows longer than DenseRowRatio*sqrt(n) are ordered
+ * last, as in AMD.
+ */
+template<typename Index>
+std::vector<Index> HexOrdering::ApproximateMinimumDegree(const std::vector<qint64>& offsets, const std::vector<Index>& adjacency)
+{
+	using Entry = std::pair<qint64, Index>; // Degree, variable
+	
+	const auto n = static_cast<Index>(offsets.size() - 1);
+	const auto denseRowLength = qMax(static_cast<qint64>(16), static_cast<qint64>(HexOrdering::DenseRowRatio*qSqrt(static_cast<qreal>(n))));
+	
+	auto variables = std::vector<std::vector<Index>>(n);
+	auto eliminated = std::vector<bool>(n, false); // Eliminated, or merged into another variable
+	auto denseVariables = std::vector<Index>();
+	
+	for (auto variable = Index(0); variable < n; ++variable)
+	{
+		auto& adjacent = variables[variable];
+		
+		adjacent.assign(adjacency.cbegin() + offsets[variable], adjacency.cbegin() + offsets[variable + 1]);
+		
+		if (static_cast<qint64>(adjacent.size()) > denseRowLength)
+		{
+			eliminated[variable] = true;
+			denseVariables.push_back(variable);
+		}
+	}
+	
+	auto elements = std::vector<std::vector<Index>>(n); // Element e is what is left of variable e once eliminated
+	auto elementsOfVariables = std::vector<std::vector<Index>>(n);
+	auto alive = std::vector<bool>(n, false);
+	auto sizes = std::vector<qint64>(n, 1); // Number of variables a variable stands for, or an element has
+	auto degrees = std::vector<qint64>(n, 0);
+	auto weights = std::vector<qint64>(n, -1);
+	auto markers = std::vector<Index>(n, -1);
+	auto nextMembers = std::vector<Index>(n, -1);
+	auto lastMembers = std::vector<Index>(n);
+	auto stamps = std::vector<qint64>(n, 0);
+	auto stamp = static_cast<qint64>(0);
+	auto hashes = std::vector<std::pair<quint64, Index>>();
+	
+	auto queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>();
+	
+	for (auto variable = Index(0); variable < n; ++variable)
+	{
+		lastMembers[variable] = variable;
+		
+		if (eliminated[variable])
+			continue;
+		
+		std::erase_if(variables[variable], [&eliminated](Index adjacent) { return eliminated[adjacent]; });
+		degrees[variable] = static_cast<qint64>(variables[variable].size());
+		queue.emplace(degrees[variable], variable);
+	}
+	
+	auto ordering = std::vector<Index>();
+	auto remainingVariables = static_cast<qint64>(n) - static_cast<qint64>(denseVariables.size());
+	
+	ordering.reserve(n);
+	
+	while (not queue.empty())
+	{
+		const auto [degree, pivot] = queue.top();
+		queue.pop();
+		
+		if (eliminated[pivot] or degree != degrees[pivot]) // Stale entry, the variable was eliminated or its degree changed since.
+			continue;
+		
+		eliminated[pivot] = true;
+		remainingVariables -= sizes[pivot];
+		markers[pivot] = pivot;
+		
+		for (auto member = pivot; member != -1; member = nextMembers[member])
+			ordering.push_back(member);
+		
+		auto& pivotElement = elements[pivot];
+		auto size = static_cast<qint64>(0);
+		
+		for (const auto element : elementsOfVariables[pivot])
+		{
+			if (not alive[element])
+				continue;
+			
+			for (const auto variable : elements[element])
+			{
+				if (not eliminated[variable] and markers[variable] != pivot)
+				{
+					markers[variable] = pivot;
+					pivotElement.push_back(variable);
+					size += sizes[variable];
+				}
+			}
+			
+			alive[element] = false; // The new element absorbs it.
+			std::vector<Index>().swap(elements[element]);
+		}
+		
+		for (const auto variable : variables[pivot])
+		{
+			if (not eliminated[variable] and markers[variable] != pivot)
+			{
+				markers[variable] = pivot;
+				pivotElement.push_back(variable);
+				size += sizes[variable];
+			}
+		}
+		
+		std::vector<Index>().swap(variables[pivot]);
+		std::vector<Index>().swap(elementsOfVariables[pivot]);
+		alive[pivot] = true;
+		sizes[pivot] = size;
+		
+		for (const auto variable : pivotElement)
+		{
+			for (const auto element : elementsOfVariables[variable])
+			{
+				if (alive[element])
+				{
+					if (weights[element] < 0)
+						weights[element] = sizes[element];
+					
+					weights[element] -= sizes[variable];
+				}
+			}
+		}
+		
+		hashes.clear();
+		
+		for (const auto variable : pivotElement)
+		{
+			auto& variableElements = elementsOfVariables[variable];
+			auto& adjacent = variables[variable];
+			auto externalDegree = static_cast<qint64>(0);
+			auto adjacentDegree = static_cast<qint64>(0);
+			auto hash = static_cast<quint64>(pivot);
+			
+			std::erase_if(variableElements, [&alive, &weights](Index element)
+			{
+				if (alive[element] and weights[element] == 0) // Aggressive absorption, the element is inside the new one.
+					alive[element] = false;
+				
+				return not alive[element];
+			});
+			
+			for (const auto element : variableElements)
+			{
+				externalDegree += weights[element];
+				hash += static_cast<quint64>(element);
+			}
+			
+			variableElements.push_back(pivot);
+			std::erase_if(adjacent, [&eliminated, &markers, pivot](Index other) { return eliminated[other] or markers[other] == pivot; });
+			
+			for (const auto other : adjacent)
+			{
+				adjacentDegree += sizes[other];
+				hash += static_cast<quint64>(other);
+			}
+			
+			const auto approximateDegree = adjacentDegree + size - sizes[variable] + externalDegree;
+			
+			degrees[variable] = qMin(qMin(approximateDegree, degrees[variable] + size - sizes[variable]), remainingVariables - sizes[variable]);
+			hashes.emplace_back(hash, variable);
+		}
+		
+		for (const auto variable : pivotElement)
+			for (const auto element : elementsOfVariables[variable])
+				weights[element] = -1;
+		
+		std::sort(hashes.begin(), hashes.end());
+		
+		for (auto first = std::size_t(0); first < hashes.size(); ++first)
+		{
+			const auto variable = hashes[first].second;
+			
+			if (eliminated[variable])
+				continue;
+			
+			++stamp;
+			
+			for (const auto element : elementsOfVariables[variable])
+				stamps[element] = stamp;
+			
+			for (const auto other : variables[variable])
+				stamps[other] = stamp;
+			
+			for (auto second = first + 1; second < hashes.size() and hashes[second].first == hashes[first].first; ++second)
+			{
+				const auto candidate = hashes[second].second;
+				
+				if (eliminated[candidate] or elementsOfVariables[candidate].size() != elementsOfVariables[variable].size() or variables[candidate].size() != variables[variable].size())
+					continue;
+				
+				if (std::ranges::all_of(elementsOfVariables[candidate], [&stamps, stamp](Index element) { return stamps[element] == stamp; }) and std::ranges::all_of(variables[candidate], [&stamps, stamp](Index other) { return stamps[other] == stamp; }))
+				{
+					sizes[variable] += sizes[candidate];
+					degrees[variable] -= sizes[candidate];
+					eliminated[candidate] = true;
+					nextMembers[lastMembers[variable]] = candidate;
+					lastMembers[variable] = lastMembers[candidate];
+					std::vector<Index>().swap(variables[candidate]);
+					std::vector<Index>().swap(elementsOfVariables[candidate]);
+				}
+			}
+			
+			queue.emplace(degrees[variable], variable);
+		}
+	}
+	
+	ordering.insert(ordering.end(), denseVariables.cbegin(), denseVariables.cend());
+	return ordering;
+}
+
+/* This orders the columns of A so that the Cholesky factor of A'A, which
+ * is also the R of A = QR, fills in as little as possible. Like COLAMD, it
+ * never forms A'A: each row of A is a clique of A'A, and is kept as such,
+ * an element. Eliminating column p merges all the elements that hold p into
+ * one new element, which is all the fill that p creates, so that storage
+ * never grows beyond the pattern of A. Degrees are the sum of the sizes of
+ * the elements of a column, an upper bound which is much cheaper than the
+ * true degree and almost as good at picking pivots. Rows longer than
+ * DenseRowRatio*sqrt(n) would make every degree meaningless, so they are
+ * left out, as COLAMD does.
+ */
+template<typename Matrix>
+std::vector<typename Matrix::IndexType> HexOrdering::ColumnMinimumDegree(const Matrix& matrix)
+{
+	using Index = typename Matrix::IndexType;
+	using Entry = std::pair<qint64, Index>; // Degree, column
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = matrix.getNumberOfRows();
+	const auto numberOfColumns = matrix.getNumberOfColumns();
+	const auto denseRowLength = qMax(static_cast<qint64>(16), static_cast<qint64>(HexOrdering::DenseRowRatio*qSqrt(static_cast<qreal>(numberOfColumns))));
+	
+	auto elements = std::vector<std::vector<Index>>();
+	auto elementsOfColumns = std::vector<std::vector<Index>>(numberOfColumns);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+	{
+		const auto length = static_cast<qint64>(rowOffsets[row + 1] - rowOffsets[row]);
+		
+		if (length < 1 or length > denseRowLength)
+			continue;
+		
+		const auto element = static_cast<Index>(elements.size());
+		auto& columns = elements.emplace_back();
+		
+		columns.reserve(length);
+		
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			columns.push_back(pairs[index].column);
+			elementsOfColumns[pairs[index].column].push_back(element);
+		}
+	}
+	
+	auto alive = std::vector<bool>(elements.size(), true);
+	auto eliminated = std::vector<bool>(numberOfColumns, false);
+	auto degrees = std::vector<qint64>(numberOfColumns, 0);
+	auto markers = std::vector<Index>(numberOfColumns, -1);
+	
+	auto queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>();
+	
+	const auto updateDegree = [&](Index column, qint64 remainingColumns)
+	{
+		auto& columnElements = elementsOfColumns[column];
+		auto degree = static_cast<qint64>(0);
+		
+		std::erase_if(columnElements, [&alive](Index element) { return not alive[element]; });
+		
+		for (const auto& element : columnElements)
+			degree += static_cast<qint64>(elements[element].size()) - 1;
+		
+		degrees[column] = qMin(degree, remainingColumns - 1);
+		queue.emplace(degrees[column], column);
+	};
+	
+	for (auto column = Index(0); column < numberOfColumns; ++column)
+		updateDegree(column, numberOfColumns);
+	
+	auto ordering = std::vector<Index>();
+	ordering.reserve(numberOfColumns);
+	
+	while (not queue.empty())
+	{
+		const auto [degree, pivot] = queue.top();
+		queue.pop();
+		
+		if (eliminated[pivot] or degree != degrees[pivot]) // Stale entry, the column was eliminated or its degree changed since.
+			continue;
+		
+		eliminated[pivot] = true;
+		ordering.push_back(pivot);
+		
+		auto newElement = std::vector<Index>();
+		markers[pivot] = pivot;
+		
+		for (const auto& element : elementsOfColumns[pivot])
+		{
+			if (not alive[element])
+				continue;
+			
+			for (const auto& column : elements[element])
+			{
+				if (markers[column] != pivot)
+				{
+					markers[column] = pivot;
+					newElement.push_back(column);
+				}
+			}
+			
+			alive[element] = false; // The new element absorbs it.
+			std::vector<Index>().swap(elements[element]);
+		}
+		
+		elementsOfColumns[pivot].clear();
+		
+		if (newElement.empty())
+			continue;
+		
+		const auto element = static_cast<Index>(elements.size());
+		
+		elements.push_back(newElement);
+		alive.push_back(true);
+		
+		const auto remainingColumns = numberOfColumns - static_cast<qint64>(ordering.size());
+		
+		for (const auto& column : newElement)
+		{
+			elementsOfColumns[column].push_back(element);
+			updateDegree(column, remainingColumns);
+		}
+	}
+	
+	return ordering;
+}
+
+/* Parts are split in two by the middle level of a level structure rooted
+ * at a pseudo-peripheral node, which is a separator, and the two halves are
+ * ordered first, one after the other, and the separator last, so that
+ * eliminating either half never fills in the other. Separator nodes with no
+ * neighbour in the second half are moved to the first one, since they don't
+ * separate anything. Disconnected parts are split into all their components
+ * in a single sweep, small components being gathered until they fill a leaf,
+ * and parts small enough, or too narrow to have a middle level, are ordered
+ * by minimum degree. Parts wait on a stack rather than in recursive calls,
+ * so that a pattern with many components, or a deep dissection, can't run
+ * out of stack or copy the rest of the graph once per level. Separators are
+ * pushed as parts too, and their nodes, labelled -1, are ordered as they are.
+ */
+template<typename Index>
+void HexOrdering::Dissect(const std::vector<qint64>& offsets, const std::vector<Index>& adjacency, const std::vector<Index>& part, std::vector<qint64>& labels, qint64& numberOfLabels, std::vector<Index>& positions, std::vector<Index>& ordering)
+{
+	auto parts = std::vector<std::vector<Index>>();
+	auto nodes = std::vector<Index>();
+	auto levelOffsets = std::vector<Index>();
+	
+	if (not part.empty())
+		parts.push_back(part);
+	
+	while (not parts.empty())
+	{
+		const auto current = std::move(parts.back());
+		parts.pop_back();
+		
+		auto label = labels[current.front()];
+		
+		if (label == -1) // A separator, ordered after both halves it separates.
+		{
+			ordering.insert(ordering.end(), current.cbegin(), current.cend());
+			continue;
+		}
+		
+		nodes.clear();
+		levelOffsets.clear();
+		
+		if (static_cast<qint64>(current.size()) > HexOrdering::NestedDissectionLeafSize)
+		{
+			auto componentOffsets = std::vector<std::size_t>(1, 0);
+			
+			for (const auto root : current) // Every component gets a label of its own, breadth first.
+			{
+				if (labels[root] != label)
+					continue;
+				
+				labels[root] = numberOfLabels;
+				nodes.push_back(root);
+				
+				for (auto index = componentOffsets.back(); index < nodes.size(); ++index)
+				{
+					for (auto neighbour = offsets[nodes[index]]; neighbour < offsets[nodes[index] + 1]; ++neighbour)
+					{
+						const auto other = adjacency[neighbour];
+						
+						if (labels[other] == label)
+						{
+							labels[other] = numberOfLabels;
+							nodes.push_back(other);
+						}
+					}
+				}
+				
+				componentOffsets.push_back(nodes.size());
+				++numberOfLabels;
+			}
+			
+			if (componentOffsets.size() > 2)
+			{
+				const auto numberOfParts = parts.size();
+				
+				for (auto component = std::size_t(0); component + 1 < componentOffsets.size();)
+				{
+					auto last = component + 1;
+					
+					while (last + 1 < componentOffsets.size() and static_cast<qint64>(componentOffsets[last + 1] - componentOffsets[component]) <= HexOrdering::NestedDissectionLeafSize)
+						++last;
+					
+					const auto groupLabel = labels[nodes[componentOffsets[component]]];
+					
+					for (auto index = componentOffsets[component]; index < componentOffsets[last]; ++index) // Small components share a leaf, and thus a label.
+						labels[nodes[index]] = groupLabel;
+					
+					parts.emplace_back(nodes.cbegin() + static_cast<qint64>(componentOffsets[component]), nodes.cbegin() + static_cast<qint64>(componentOffsets[last]));
+					component = last;
+				}
+				
+				std::reverse(parts.begin() + static_cast<qint64>(numberOfParts), parts.end()); // The first component is ordered first.
+				continue;
+			}
+			
+			label = labels[current.front()];
+			
+			const auto root = HexOrdering::PseudoPeripheralNode(offsets, adjacency, labels, current.front(), positions, nodes, levelOffsets);
+			HexOrdering::LevelStructure(offsets, adjacency, labels, root, positions, nodes, levelOffsets);
+		}
+		
+		const auto numberOfLevels = static_cast<Index>(levelOffsets.size()) - 1;
+		
+		if (nodes.empty() or numberOfLevels < 3) // Small enough, or no middle level to cut along.
+		{
+			auto localOffsets = std::vector<qint64>(1, 0);
+			auto localAdjacency = std::vector<Index>();
+			
+			for (auto local = Index(0); local < static_cast<Index>(current.size()); ++local)
+				positions[current[local]] = local;
+			
+			for (const auto node : current)
+			{
+				for (auto index = offsets[node]; index < offsets[node + 1]; ++index)
+					if (labels[adjacency[index]] == label)
+						localAdjacency.push_back(positions[adjacency[index]]);
+				
+				localOffsets.push_back(static_cast<qint64>(localAdjacency.size()));
+			}
+			
+			for (const auto node : current)
+				positions[node] = -1;
+			
+			for (const auto local : HexOrdering::ApproximateMinimumDegree(localOffsets, localAdjacency))
+				ordering.push_back(current[local]);
+			
+			continue;
+		}
+		
+		const auto firstLabel = numberOfLabels++;
+		const auto secondLabel = numberOfLabels++;
+		
+		auto first = std::vector<Index>();
+		auto second = std::vector<Index>();
+		auto separator = std::vector<Index>();
+		auto middle = Index(1);
+		
+		while (middle < numberOfLevels - 2 and 2*static_cast<qint64>(levelOffsets[middle + 1]) < static_cast<qint64>(nodes.size()))
+			++middle;
+		
+		for (auto index = Index(0); index < static_cast<Index>(nodes.size()); ++index)
+		{
+			const auto node = nodes[index];
+			
+			if (index < levelOffsets[middle])
+				labels[node] = firstLabel;
+			else if (index >= levelOffsets[middle + 1])
+				labels[node] = secondLabel;
+		}
+		
+		for (auto index = levelOffsets[middle]; index < levelOffsets[middle + 1]; ++index)
+		{
+			const auto node = nodes[index];
+			auto touchesSecond = false;
+			
+			for (auto neighbour = offsets[node]; neighbour < offsets[node + 1] and not touchesSecond; ++neighbour)
+				touchesSecond = (labels[adjacency[neighbour]] == secondLabel);
+			
+			if (touchesSecond)
+				separator.push_back(node);
+			else
+				labels[node] = firstLabel;
+		}
+		
+		for (const auto node : nodes)
+		{
+			if (labels[node] == firstLabel)
+				first.push_back(node);
+			else if (labels[node] == secondLabel)
+				second.push_back(node);
+		}
+		
+		for (const auto node : separator)
+			labels[node] = -1;
+		
+		for (auto* half : {&separator, &second, &first}) // Popped in the opposite order.
+			if (not half->empty())
+				parts.push_back(std::move(*half));
+	}
+}
+
+/* Without an ordering, this gives the bandwidth and profile of the matrix
+ * itself, and with one, those of PAP', so that both can be compared before
+ * permuting anything. Lower and upper values count the same, as if the
+ * pattern were symmetric. An ordering that isn't a permutation of 0 to
+ * n - 1, n being the larger dimension, gives -1 for both.
+ */
+template<typename Matrix>
+HexBandwidthProfile HexOrdering::GetBandwidthProfile(const Matrix& matrix, const std::vector<typename Matrix::IndexType>& ordering)
+{
+	using Index = typename Matrix::IndexType;
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = matrix.getNumberOfRows();
+	const auto n = qMax(numberOfRows, matrix.getNumberOfColumns());
+	
+	auto inverse = std::vector<Index>(n, -1);
+	auto firstColumns = std::vector<Index>(n);
+	auto statistics = HexBandwidthProfile();
+	auto valid = (ordering.empty() or static_cast<Index>(ordering.size()) == n);
+	
+	for (auto k = Index(0); k < n and valid; ++k)
+	{
+		const auto old = (ordering.empty() ? k : ordering[k]);
+		
+		valid = (old >= 0 and old < n and inverse[old] == -1);
+		
+		if (valid)
+		{
+			inverse[old] = k;
+			firstColumns[k] = k;
+		}
+	}
+	
+	if (not valid)
+	{
+		statistics.bandwidth = -1;
+		statistics.profile = -1;
+		return statistics;
+	}
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto [low, high] = std::minmax(inverse[row], inverse[pairs[index].column]);
+			
+			statistics.bandwidth = qMax(statistics.bandwidth, static_cast<qint64>(high - low));
+			firstColumns[high] = qMin(firstColumns[high], low);
+		}
+	}
+	
+	for (auto k = Index(0); k < n; ++k)
+		statistics.profile += k - firstColumns[k];
+	
+	return statistics;
+}
+
+/* Nodes are listed level by level, level l being the nodes at distance l
+ * from the root, among the nodes with the same label as the root only.
+ * distances holds -1 for every node before and after, and is only written
+ * in between, to tell visited nodes apart.
+ */
+template<typename Index>
+void HexOrdering::LevelStructure(const std::vector<qint64>& offsets, const std::vector<Index>& adjacency, const std::vector<qint64>& labels, Index root, std::vector<Index>& distances, std::vector<Index>& nodes, std::vector<Index>& levelOffsets)
+{
+	const auto label = labels[root];
+	
+	nodes.assign(1, root);
+	levelOffsets.assign(1, 0);
+	distances[root] = 0;
+	
+	for (auto first = std::size_t(0); first < nodes.size();)
+	{
+		const auto last = nodes.size();
+		const auto level = static_cast<Index>(levelOffsets.size());
+		
+		for (auto index = first; index < last; ++index)
+		{
+			const auto node = nodes[index];
+			
+			for (auto neighbour = offsets[node]; neighbour < offsets[node + 1]; ++neighbour)
+			{
+				const auto other = adjacency[neighbour];
+				
+				if (labels[other] == label and distances[other] == -1)
+				{
+					distances[other] = level;
+					nodes.push_back(other);
+				}
+			}
+		}
+		
+		levelOffsets.push_back(static_cast<Index>(last));
+		first = last;
+	}
+	
+	for (const auto node : nodes)
+		distances[node] = -1;
+}
+
+/* See ApproximateMinimumDegree, this only builds the adjacency lists of
+ * the pattern of A + A' for it.
+ */
+template<typename Matrix>
+std::vector<typename Matrix::IndexType> HexOrdering::MinimumDegree(const Matrix& matrix)
+{
+	using Index = typename Matrix::IndexType;
+	
+	auto offsets = std::vector<qint64>();
+	auto adjacency = std::vector<Index>();
+	
+	HexOrdering::SymmetricPattern(matrix, offsets, adjacency);
+	return HexOrdering::ApproximateMinimumDegree(offsets, adjacency);
+}
+
+/* Nested dissection for fill, which on meshes gives Cholesky factors with
+ * less fill than minimum degree alone, and elimination trees with wide,
+ * independent subtrees, which is what HexCholesky runs in parallel. Parts
+ * are cut by the Dissect above down to NestedDissectionLeafSize nodes, and
+ * finished off with minimum degree.
+ */
+template<typename Matrix>
+std::vector<typename Matrix::IndexType> HexOrdering::NestedDissection(const Matrix& matrix)
+{
+	using Index = typename Matrix::IndexType;
+	
+	auto offsets = std::vector<qint64>();
+	auto adjacency = std::vector<Index>();
+	
+	HexOrdering::SymmetricPattern(matrix, offsets, adjacency);
+	
+	const auto n = static_cast<Index>(offsets.size() - 1);
+	
+	auto part = std::vector<Index>(n);
+	auto labels = std::vector<qint64>(n, 0);
+	auto numberOfLabels = static_cast<qint64>(1);
+	auto positions = std::vector<Index>(n, -1);
+	auto ordering = std::vector<Index>();
+	
+	std::iota(part.begin(), part.end(), Index(0));
+	ordering.reserve(n);
+	
+	HexOrdering::Dissect(offsets, adjacency, part, labels, numberOfLabels, positions, ordering);
+	return ordering;
+}
+
+/* Starting from a node, this keeps jumping to the node of least degree of
+ * the last level of the level structure of the current one, as long as
+ * that adds levels, as George and Liu do. The result is about as far as
+ * can be from anything else in its component, which keeps levels narrow.
+ */
+template<typename Index>
+Index HexOrdering::PseudoPeripheralNode(const std::vector<qint64>& offsets, const std::vector<Index>& adjacency, const std::vector<qint64>& labels, Index root, std::vector<Index>& distances, std::vector<Index>& nodes, std::vector<Index>& levelOffsets)
+{
+	HexOrdering::LevelStructure(offsets, adjacency, labels, root, distances, nodes, levelOffsets);
+	
+	for (auto numberOfLevels = levelOffsets.size();;)
+	{
+		auto candidate = nodes[levelOffsets[levelOffsets.size() - 2]];
+		
+		for (auto index = levelOffsets[levelOffsets.size() - 2]; index < levelOffsets.back(); ++index)
+			if (offsets[nodes[index] + 1] - offsets[nodes[index]] < offsets[candidate + 1] - offsets[candidate])
+				candidate = nodes[index];
+		
+		HexOrdering::LevelStructure(offsets, adjacency, labels, candidate, distances, nodes, levelOffsets);
+		
+		if (levelOffsets.size() <= numberOfLevels)
+			return root;
+		
+		root = candidate;
+		numberOfLevels = levelOffsets.size();
+	}
+}
+
+/* Reverse Cuthill-McKee for bandwidth and profile, which mostly helps
+ * SpMV and banded solvers, by keeping the values of every row close to the
+ * diagonal, and thus the entries of x each row reads close together. Each
+ * component is ordered breadth first from a pseudo-peripheral node, with
+ * the new neighbours of every node taken by increasing degree, and the whole
+ * ordering is reversed at the end, which never widens the profile.
+ */
+template<typename Matrix>
+std::vector<typename Matrix::IndexType> HexOrdering::ReverseCuthillMcKee(const Matrix& matrix)
+{
+	using Index = typename Matrix::IndexType;
+	
+	auto offsets = std::vector<qint64>();
+	auto adjacency = std::vector<Index>();
+	
+	HexOrdering::SymmetricPattern(matrix, offsets, adjacency);
+	
+	const auto n = static_cast<Index>(offsets.size() - 1);
+	const auto degree = [&offsets](Index node) { return offsets[node + 1] - offsets[node]; };
+	
+	auto labels = std::vector<qint64>(n, 0); // 0 until ordered, then 1
+	auto distances = std::vector<Index>(n, -1);
+	auto nodes = std::vector<Index>();
+	auto levelOffsets = std::vector<Index>();
+	auto ordering = std::vector<Index>();
+	
+	ordering.reserve(n);
+	
+	for (auto start = Index(0); start < n; ++start)
+	{
+		if (labels[start] != 0)
+			continue;
+		
+		const auto root = HexOrdering::PseudoPeripheralNode(offsets, adjacency, labels, start, distances, nodes, levelOffsets);
+		
+		labels[root] = 1;
+		ordering.push_back(root);
+		
+		for (auto index = ordering.size() - 1; index < ordering.size(); ++index)
+		{
+			const auto node = ordering[index];
+			const auto firstNeighbour = ordering.size();
+			
+			for (auto neighbour = offsets[node]; neighbour < offsets[node + 1]; ++neighbour)
+			{
+				const auto other = adjacency[neighbour];
+				
+				if (labels[other] == 0)
+				{
+					labels[other] = 1;
+					ordering.push_back(other);
+				}
+			}
+			
+			std::stable_sort(ordering.begin() + firstNeighbour, ordering.end(), [&degree](Index node1, Index node2) { return degree(node1) < degree(node2); });
+		}
+	}
+	
+	std::reverse(ordering.begin(), ordering.end());
+	return ordering;
+}
+
+/* This writes the pattern of A + A', without the diagonal, as sorted
+ * adjacency lists, over max(rows, columns) nodes.
+ */
+template<typename Matrix>
+void HexOrdering::SymmetricPattern(const Matrix& matrix, std::vector<qint64>& offsets, std::vector<typename Matrix::IndexType>& adjacency)
+{
+	using Index = typename Matrix::IndexType;
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfRows = matrix.getNumberOfRows();
+	const auto n = qMax(numberOfRows, matrix.getNumberOfColumns());
+	
+	offsets.assign(n + 1, 0);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			if (pairs[index].column != row)
+			{
+				++offsets[row + 1];
+				++offsets[pairs[index].column + 1];
+			}
+		}
+	}
+	
+	for (auto node = Index(0); node < n; ++node)
+		offsets[node + 1] += offsets[node];
+	
+	auto positions = std::vector<qint64>(offsets.cbegin(), offsets.cend() - 1);
+	
+	adjacency.resize(offsets[n]);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+	{
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto column = pairs[index].column;
+			
+			if (column != row)
+			{
+				adjacency[positions[row]++] = column;
+				adjacency[positions[column]++] = row;
+			}
+		}
+	}
+	
+	auto size = static_cast<qint64>(0);
+	
+	for (auto node = Index(0); node < n; ++node) // Both triangles may hold the same pair, which is kept once.
+	{
+		const auto beg = adjacency.begin() + offsets[node];
+		const auto end = adjacency.begin() + offsets[node + 1];
+		
+		std::sort(beg, end);
+		offsets[node] = size;
+		
+		for (auto it = beg; it != end; ++it)
+			if (it == beg or *it != *(it - 1))
+				adjacency[size++] = *it;
+	}
+	
+	offsets[n] = size;
+	adjacency.resize(size);
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef __HEX_PARALLEL_HPP__
+#define __HEX_PARALLEL_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <barrier>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+class HexParallel
+{
+	public:
+	
+		static constexpr qint64						MinimumWorkPerThread = 32768;
+		
+		inline static qint32						GetNumberOfThreads(qint64);
+		template<typename Type> inline static std::vector<Type>		PartitionOffsets(std::span<const Type>, qint32);
+		template<typename Type, typename Allocator> inline static std::vector<Type>	PartitionOffsets(const std::vector<Type, Allocator>&, qint32);
+		template<typename Function> inline static void			Run(qint32, Function);
+};
+
+/* Run spawns its threads on every call, which is nothing next to a product
+ * by a large matrix, but adds up over the many short loops of an iterative
+ * solver. A team keeps its threads for as long as it lives, waiting on a
+ * barrier between two runs, so that each run only costs two barriers.
+ */
+class HexParallelTeam
+{
+	private:
+	
+		using Task = void (*)(void*, qint32);
+		
+		qint32								numberOfThreads;
+		std::barrier<>							barrier;
+		std::vector<std::jthread>					threads;
+		
+		Task								task = nullptr;	// The function of the current run, null once the team stops
+		void*								taskContext = nullptr;
+		
+	public:
+	
+		inline explicit							HexParallelTeam(qint32);
+		inline								~HexParallelTeam(void);
+		
+		inline qint32							getNumberOfThreads(void) const;
+		template<typename Function> inline void				run(Function);
+};
+
+/* Spawning a thread costs a few microseconds, so there is no point
+ * in splitting a job that is only a few thousand operations long.
+ */
+qint32 HexParallel::GetNumberOfThreads(qint64 work)
+{
+	const auto hardwareThreads = static_cast<qint64>(std::max(std::thread::hardware_concurrency(), 1u));
+	const auto usefulThreads = work/HexParallel::MinimumWorkPerThread;
+	
+	return static_cast<qint32>(std::clamp(usefulThreads, static_cast<qint64>(1), hardwareThreads));
+}
+
+/* Given a prefix sum such as rowOffsets, this returns the numberOfParts + 1
+ * boundaries that split it into parts holding about the same amount of work,
+ * rather than the same number of rows. Boundaries are rows, and are of the
+ * same type as the offsets, so that 64-bit matrices get 64-bit boundaries.
+ */
+template<typename Type>
+std::vector<Type> HexParallel::PartitionOffsets(std::span<const Type> offsets, qint32 numberOfParts)
+{
+	const auto numberOfRows = static_cast<Type>(offsets.size()) - 1;
+	auto boundaries = std::vector<Type>(numberOfParts + 1, 0);
+	
+	if (numberOfRows < 1)
+		return boundaries;
+	
+	const auto totalWork = static_cast<qint64>(offsets.back() - offsets.front());
+	
+	for (auto part = 1; part < numberOfParts; ++part)
+	{
+		const auto target = offsets.front() + static_cast<Type>(totalWork*part/numberOfParts);
+		const auto it = std::lower_bound(offsets.begin() + boundaries[part - 1], offsets.end() - 1, target);
+		
+		boundaries[part] = static_cast<Type>(it - offsets.begin());
+	}
+	
+	boundaries[numberOfParts] = numberOfRows;
+	return boundaries;
+}
+
+template<typename Type, typename Allocator>
+std::vector<Type> HexParallel::PartitionOffsets(const std::vector<Type, Allocator>& offsets, qint32 numberOfParts)
+{
+	return HexParallel::PartitionOffsets(std::span<const Type>(offsets), numberOfParts);
+}
+
+/* The calling thread always takes part 0, so asking for a single
+ * thread simply runs the function inline without spawning anything.
+ */
+template<typename Function>
+void HexParallel::Run(qint32 numberOfThreads, Function function)
+{
+	if (numberOfThreads < 2)
+	{
+		function(0);
+		return;
+	}
+	
+	auto threads = std::vector<std::jthread>();
+	threads.reserve(numberOfThreads - 1);
+	
+	for (auto thread = 1; thread < numberOfThreads; ++thread)
+		threads.emplace_back(function, thread);
+	
+	function(0);
+}
+
+/* As with Run, the calling thread is part of the team, as thread 0, and a
+ * team of a single thread spawns nothing.
+ */
+HexParallelTeam::HexParallelTeam(qint32 newNumberOfThreads) :
+	numberOfThreads(qMax(newNumberOfThreads, 1)),
+	barrier(numberOfThreads)
+{
+	HexParallelTeam::threads.reserve(HexParallelTeam::numberOfThreads - 1);
+	
+	for (auto thread = 1; thread < HexParallelTeam::numberOfThreads; ++thread)
+	{
+		HexParallelTeam::threads.emplace_back([this, thread](void)
+		{
+			for (;;)
+			{
+				HexParallelTeam::barrier.arrive_and_wait();
+				
+				if (HexParallelTeam::task == nullptr)
+					return;
+				
+				HexParallelTeam::task(HexParallelTeam::taskContext, thread);
+				HexParallelTeam::barrier.arrive_and_wait();
+			}
+		});
+	}
+}
+
+HexParallelTeam::~HexParallelTeam(void)
+{
+	if (HexParallelTeam::threads.empty())
+		return;
+	
+	HexParallelTeam::task = nullptr;
+	HexParallelTeam::barrier.arrive_and_wait();
+	HexParallelTeam::threads.clear();
+}
+
+qint32 HexParallelTeam::getNumberOfThreads(void) const
+{
+	return HexParallelTeam::numberOfThreads;
+}
+
+/* The function is only called through a plain pointer, so that a run
+ * allocates nothing. It returns once every thread is done with it.
+ */
+template<typename Function>
+void HexParallelTeam::run(Function function)
+{
+	if (HexParallelTeam::threads.empty())
+	{
+		function(0);
+		return;
+	}
+	
+	HexParallelTeam::task = [](void* context, qint32 thread) { (*static_cast<Function*>(context))(thread); };
+	HexParallelTeam::taskContext = &function;
+	
+	HexParallelTeam::barrier.arrive_and_wait();
+	function(0);
+	HexParallelTeam::barrier.arrive_and_wait();
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef __HEX_PRECONDITIONER_HPP__
+#define __HEX_PRECONDITIONER_HPP__
+
+// Standard Libraries
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexLevelSchedule.hpp"
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+
+/* Preconditioners for HexKrylovSolver, all built once from a square matrix
+ * and then applied as z = M^-1 r at every iteration. Zero diagonal values,
+ * which none of them can divide by, are taken as ones.
+ */
+
+/* M = LU, where L is unit lower triangular, U is upper triangular, and both
+ * have exactly the pattern of the matrix, which ILU(0) never fills in. Rows
+ * are factorized in the order of the lower level schedule, since row i only
+ * reads the rows of U it has a value in, just like the forward solve does,
+ * so that factorization and solves run on as many threads as the levels
+ * allow. Rows are expected to be sorted by column, as in the matrix.
+ */
+template<typename Matrix>
+class HexIncompleteLuPreconditioner
+{
+	public:
+	
+		using Index = typename Matrix::IndexType;
+		using Value = typename Matrix::ValueType;
+		
+	private:
+	
+		using Accumulator = typename Matrix::Accumulator;
+		
+		std::vector<Index>							columns;
+		std::vector<Value>							values;
+		std::vector<Index>							rowOffsets;
+		std::vector<Index>							diagonalOffsets;	// First value of row i that isn't in L
+		std::vector<Index>							upperOffsets;		// First value of row i that is in U but not on its diagonal
+		std::vector<Value>							inverseDiagonal;
+		
+		HexLevelSchedule<Index>							lowerSchedule;
+		HexLevelSchedule<Index>							upperSchedule;
+		
+	public:
+	
+		inline explicit								HexIncompleteLuPreconditioner(const Matrix&);
+		
+		inline void								apply(const std::vector<Value>&, std::vector<Value>&) const;
+};
+
+/* M = D, the cheapest there is, and perfectly parallel.
+ */
+template<typename Matrix>
+class HexJacobiPreconditioner
+{
+	public:
+	
+		using Value = typename Matrix::ValueType;
+		
+	private:
+	
+		std::vector<Value>							inverseDiagonal;
+		
+	public:
+	
+		inline explicit								HexJacobiPreconditioner(const Matrix&);
+		
+		inline void								apply(const std::vector<Value>&, std::vector<Value>&) const;
+};
+
+/* M = (D + wL)D^-1(D + wU)/(w(2 - w)), where L and U are the strict lower
+ * and upper triangles of the matrix, which is read in place and so must
+ * outlive the preconditioner. For Hermitian matrices M is Hermitian too,
+ * and positive definite whenever the matrix is, so that it can be used with
+ * conjugate gradients, unlike Gauss-Seidel. The relaxation factor must be
+ * strictly between 0 and 2.
+ */
+template<typename Matrix>
+class HexSsorPreconditioner
+{
+	public:
+	
+		using Index = typename Matrix::IndexType;
+		using Value = typename Matrix::ValueType;
+		
+	private:
+	
+		using Accumulator = typename Matrix::Accumulator;
+		
+		const Matrix&								matrix;
+		qreal									relaxation;
+		std::vector<Value>							inverseDiagonal;
+		
+		HexLevelSchedule<Index>							lowerSchedule;
+		HexLevelSchedule<Index>							upperSchedule;
+		
+	public:
+	
+		inline explicit								HexSsorPreconditioner(const Matrix&, qreal = 1.);
+		
+		inline void								apply(const std::vector<Value>&, std::vector<Value>&) const;
+};
+
+template<typename Matrix>
+HexIncompleteLuPreconditioner<Matrix>::HexIncompleteLuPreconditioner(const Matrix& matrix) :
+	lowerSchedule(matrix, HexTriangle::Lower),
+	upperSchedule(matrix, HexTriangle::Upper)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& matrixRowOffsets = matrix.getRowOffsets();
+	const auto numberOfRows = matrix.getNumberOfRows();
+	
+	HexIncompleteLuPreconditioner::columns.reserve(pairs.size());
+	HexIncompleteLuPreconditioner::values.reserve(pairs.size());
+	HexIncompleteLuPreconditioner::rowOffsets.reserve(numberOfRows + 1);
+	HexIncompleteLuPreconditioner::rowOffsets.push_back(0);
+	HexIncompleteLuPreconditioner::diagonalOffsets.resize(numberOfRows);
+	HexIncompleteLuPreconditioner::upperOffsets.resize(numberOfRows);
+	HexIncompleteLuPreconditioner::inverseDiagonal.resize(numberOfRows);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row) // Only the square part is kept, columns beyond the last row have nothing to be solved for.
+	{
+		for (auto index = matrixRowOffsets[row]; index < matrixRowOffsets[row + 1] and pairs[index].column < numberOfRows; ++index)
+		{
+			HexIncompleteLuPreconditioner::columns.push_back(pairs[index].column);
+			HexIncompleteLuPreconditioner::values.push_back(pairs[index].value);
+		}
+		
+		HexIncompleteLuPreconditioner::rowOffsets.push_back(static_cast<Index>(HexIncompleteLuPreconditioner::columns.size()));
+	}
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+	{
+		auto index = HexIncompleteLuPreconditioner::rowOffsets[row];
+		const auto stopIndex = HexIncompleteLuPreconditioner::rowOffsets[row + 1];
+		
+		while (index < stopIndex and HexIncompleteLuPreconditioner::columns[index] < row)
+			++index;
+		
+		HexIncompleteLuPreconditioner::diagonalOffsets[row] = index;
+		HexIncompleteLuPreconditioner::upperOffsets[row] = (index < stopIndex and HexIncompleteLuPreconditioner::columns[index] == row ? index + 1 : index);
+	}
+	
+	HexIncompleteLuPreconditioner::lowerSchedule.run([this](Index row)
+	{
+		const auto diagonalIndex = HexIncompleteLuPreconditioner::diagonalOffsets[row];
+		const auto stopIndex = HexIncompleteLuPreconditioner::rowOffsets[row + 1];
+		
+		for (auto index = HexIncompleteLuPreconditioner::rowOffsets[row]; index < diagonalIndex; ++index)
+		{
+			const auto k = HexIncompleteLuPreconditioner::columns[index];
+			const auto multiplier = HexIncompleteLuPreconditioner::values[index]*HexIncompleteLuPreconditioner::inverseDiagonal[k];
+			const auto stopIndexOfK = HexIncompleteLuPreconditioner::rowOffsets[k + 1];
+			
+			HexIncompleteLuPreconditioner::values[index] = multiplier;
+			
+			auto target = index + 1;
+			
+			for (auto source = HexIncompleteLuPreconditioner::upperOffsets[k]; source < stopIndexOfK and target < stopIndex; ++source) // Both rows are sorted, so they are merged.
+			{
+				const auto column = HexIncompleteLuPreconditioner::columns[source];
+				
+				while (target < stopIndex and HexIncompleteLuPreconditioner::columns[target] < column)
+					++target;
+				
+				if (target < stopIndex and HexIncompleteLuPreconditioner::columns[target] == column)
+					HexIncompleteLuPreconditioner::values[target] -= multiplier*HexIncompleteLuPreconditioner::values[source];
+			}
+		}
+		
+		const auto hasDiagonal = (HexIncompleteLuPreconditioner::upperOffsets[row] > diagonalIndex);
+		const auto pivot = (hasDiagonal ? HexIncompleteLuPreconditioner::values[diagonalIndex] : Value());
+		
+		HexIncompleteLuPreconditioner::inverseDiagonal[row] = (pivot == Value() ? Value(1) : Value(1)/pivot);
+	});
+}
+
+/* Forward substitution with the unit L, then backward substitution with U,
+ * both in place in z.
+ */
+template<typename Matrix>
+void HexIncompleteLuPreconditioner<Matrix>::apply(const std::vector<Value>& r, std::vector<Value>& z) const
+{
+	const auto numberOfRows = static_cast<Index>(HexIncompleteLuPreconditioner::diagonalOffsets.size());
+	
+	if (r.size() != static_cast<std::size_t>(numberOfRows))
+	{
+		z = r;
+		return;
+	}
+	
+	z.resize(numberOfRows);
+	
+	HexIncompleteLuPreconditioner::lowerSchedule.run([this, &r, &z](Index row)
+	{
+		auto sum = static_cast<Accumulator>(r[row]);
+		
+		for (auto index = HexIncompleteLuPreconditioner::rowOffsets[row]; index < HexIncompleteLuPreconditioner::diagonalOffsets[row]; ++index)
+			sum -= static_cast<Accumulator>(HexIncompleteLuPreconditioner::values[index])*static_cast<Accumulator>(z[HexIncompleteLuPreconditioner::columns[index]]);
+		
+		z[row] = static_cast<Value>(sum);
+	});
+	
+	HexIncompleteLuPreconditioner::upperSchedule.run([this, &z](Index row)
+	{
+		auto sum = static_cast<Accumulator>(z[row]);
+		
+		for (auto index = HexIncompleteLuPreconditioner::upperOffsets[row]; index < HexIncompleteLuPreconditioner::rowOffsets[row + 1]; ++index)
+			sum -= static_cast<Accumulator>(HexIncompleteLuPreconditioner::values[index])*static_cast<Accumulator>(z[HexIncompleteLuPreconditioner::columns[index]]);
+		
+		z[row] = static_cast<Value>(sum*static_cast<Accumulator>(HexIncompleteLuPreconditioner::inverseDiagonal[row]));
+	});
+}
+
+template<typename Matrix>
+HexJacobiPreconditioner<Matrix>::HexJacobiPreconditioner(const Matrix& matrix) : inverseDiagonal(matrix.getNumberOfRows(), Value(1))
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	for (auto row = typename Matrix::IndexType(0); row < matrix.getNumberOfRows(); ++row)
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+			if (pairs[index].column == row and pairs[index].value != Value())
+				HexJacobiPreconditioner::inverseDiagonal[row] = Value(1)/pairs[index].value;
+}
+
+template<typename Matrix>
+void HexJacobiPreconditioner<Matrix>::apply(const std::vector<Value>& r, std::vector<Value>& z) const
+{
+	const auto numberOfRows = static_cast<qint64>(HexJacobiPreconditioner::inverseDiagonal.size());
+	
+	if (static_cast<qint64>(r.size()) != numberOfRows)
+	{
+		z = r;
+		return;
+	}
+	
+	z.resize(numberOfRows);
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfRows);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto stopRow = numberOfRows*(thread + 1)/numberOfThreads;
+		
+		for (auto row = numberOfRows*thread/numberOfThreads; row < stopRow; ++row)
+			z[row] = HexJacobiPreconditioner::inverseDiagonal[row]*r[row];
+	});
+}
+
+template<typename Matrix>
+HexSsorPreconditioner<Matrix>::HexSsorPreconditioner(const Matrix& newMatrix, qreal newRelaxation) :
+	matrix(newMatrix),
+	relaxation(newRelaxation),
+	inverseDiagonal(newMatrix.getNumberOfRows(), Value(1)),
+	lowerSchedule(newMatrix, HexTriangle::Lower),
+	upperSchedule(newMatrix, HexTriangle::Upper)
+{
+	const auto& pairs = newMatrix.getPairs();
+	const auto& rowOffsets = newMatrix.getRowOffsets();
+	
+	for (auto row = Index(0); row < newMatrix.getNumberOfRows(); ++row)
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+			if (pairs[index].column == row and pairs[index].value != Value())
+				HexSsorPreconditioner::inverseDiagonal[row] = Value(1)/pairs[index].value;
+}
+
+/* (D + wL)y = w(2 - w)r forward, then (D + wU)z = Dy backward, in place.
+ * The second one is z = y - wD^-1Uz, so that D is never applied at all.
+ */
+template<typename Matrix>
+void HexSsorPreconditioner<Matrix>::apply(const std::vector<Value>& r, std::vector<Value>& z) const
+{
+	const auto numberOfRows = HexSsorPreconditioner::matrix.getNumberOfRows();
+	
+	if (r.size() != static_cast<std::size_t>(numberOfRows))
+	{
+		z = r;
+		return;
+	}
+	
+	z.resize(numberOfRows);
+	
+	const auto& pairs = HexSsorPreconditioner::matrix.getPairs();
+	const auto& rowOffsets = HexSsorPreconditioner::matrix.getRowOffsets();
+	
+	const auto omega = static_cast<Accumulator>(HexSsorPreconditioner::relaxation);
+	const auto scale = omega*(Accumulator(2) - omega);
+	
+	HexSsorPreconditioner::lowerSchedule.run([&](Index row)
+	{
+		auto sum = Accumulator();
+		
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1] and pairs[index].column < row; ++index)
+			sum += static_cast<Accumulator>(pairs[index].value)*static_cast<Accumulator>(z[pairs[index].column]);
+		
+		z[row] = static_cast<Value>((scale*static_cast<Accumulator>(r[row]) - omega*sum)*static_cast<Accumulator>(HexSsorPreconditioner::inverseDiagonal[row]));
+	});
+	
+	HexSsorPreconditioner::upperSchedule.run([&](Index row)
+	{
+		auto sum = Accumulator();
+		
+		for (auto index = rowOffsets[row + 1] - 1; index >= rowOffsets[row] and pairs[index].column > row; --index)
+			if (pairs[index].column < numberOfRows)
+				sum += static_cast<Accumulator>(pairs[index].value)*static_cast<Accumulator>(z[pairs[index].column]);
+		
+		z[row] = static_cast<Value>(static_cast<Accumulator>(z[row]) - omega*sum*static_cast<Accumulator>(HexSsorPreconditioner::inverseDiagonal[row]));
+	});
+}
+
+#endif
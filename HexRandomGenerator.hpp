@@ -12,14 +12,15 @@ class HexRandomGenerator
 {
 	private:
 	
-		std::random_device				rGen;
+		std::random_device					rGen;
 		
 	public:
 	
-		inline qint32					getNumberWithinRange(qint32);
-		inline quint32					getNumberWithinRange(quint32);
-		inline std::vector<qint32>			getNumbersWithinRange(qint32, qint32);
-		template<typename Type> inline void		shuffle(std::vector<Type>&);
+		inline qint32						getNumberWithinRange(qint32);
+		inline quint32						getNumberWithinRange(quint32);
+		inline qint64						getNumberWithinRange(qint64);
+		template<typename Type> inline std::vector<Type>	getNumbersWithinRange(Type, Type);
+		template<typename Type> inline void			shuffle(Type&);
 };
 
 qint32 HexRandomGenerator::getNumberWithinRange(qint32 max)
@@ -39,26 +40,39 @@ quint32 HexRandomGenerator::getNumberWithinRange(quint32 max)
 	return (HexRandomGenerator::rGen() % max);
 }
 
-std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, qint32 max)
+/* std::random_device only gives 32 bits at a time, which isn't
+ * enough to pick a cell in a matrix with more than 2³¹ of them.
+ */
+qint64 HexRandomGenerator::getNumberWithinRange(qint64 max)
+{
+	if (max < 2)
+		return 0;
+	
+	const auto foo = (static_cast<quint64>(HexRandomGenerator::rGen()) << 32) | static_cast<quint64>(HexRandomGenerator::rGen());
+	return static_cast<qint64>(foo % static_cast<quint64>(max));
+}
+
+template<typename Type>
+std::vector<Type> HexRandomGenerator::getNumbersWithinRange(Type quantity, Type max)
 {	
 	if (quantity < 1 or max < 2 or quantity >= max + 1)
 		return { };
 	
 	if (quantity == max)
 	{
-		auto numbers = std::vector<qint32>(quantity, 0);
-		std::iota(numbers.begin(), numbers.end(), 0);
+		auto numbers = std::vector<Type>(quantity, 0);
+		std::iota(numbers.begin(), numbers.end(), Type(0));
 		
 		return numbers;
 	}
 	
-	auto numbers = std::vector<qint32>();
+	auto numbers = std::vector<Type>();
 	numbers.reserve(quantity*6/5);
 	
 	if (quantity > max/2) // In this case, you might as well generate the numbers that you WON'T get.
 	{
-		const auto antiNumbers = HexRandomGenerator::getNumbersWithinRange(max - quantity, max);
-		auto index = 0;
+		const auto antiNumbers = HexRandomGenerator::getNumbersWithinRange(static_cast<Type>(max - quantity), max);
+		auto index = Type(0);
 		
 		for (const auto& val : antiNumbers)
 		{
@@ -81,11 +95,11 @@ std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, q
 	}
 	
 	auto numbersToProduce = quantity*11/10; // It's unlikely that the n generated numbers will be unique, so we produce a bit more.
-	auto uniqueNumbers = 0;
+	auto uniqueNumbers = Type(0);
 	
 	while (numbersToProduce != 0)
 	{
-		for (auto i = 0; i < numbersToProduce; ++i)
+		for (auto i = Type(0); i < numbersToProduce; ++i)
 		{
 			const auto foo = HexRandomGenerator::getNumberWithinRange(max);
 			numbers.emplace_back(foo);
@@ -94,7 +108,7 @@ std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, q
 		std::sort(numbers.begin(), numbers.end());
 		
 		auto duplicates = 0;
-		auto last = -1;
+		auto last = Type(-1);
 		
 		for (auto& val : numbers)
 		{
@@ -107,7 +121,7 @@ std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, q
 				last = val;
 		}
 		
-		uniqueNumbers = static_cast<qint32>(numbers.size()) - duplicates;
+		uniqueNumbers = static_cast<Type>(numbers.size()) - duplicates;
 		numbersToProduce = quantity - uniqueNumbers;
 		
 		while (numbersToProduce < 0)
@@ -125,7 +139,7 @@ std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, q
 			numbersToProduce = numbersToProduce*11/10;
 	}
 	
-	auto numbersPurged = std::vector<qint32>();
+	auto numbersPurged = std::vector<Type>();
 	numbersPurged.reserve(quantity);
 	
 	for (const auto& val : numbers)
@@ -140,7 +154,7 @@ std::vector<qint32> HexRandomGenerator::getNumbersWithinRange(qint32 quantity, q
 }
 
 template<typename Type>
-void HexRandomGenerator::shuffle(std::vector<Type>& vect)
+void HexRandomGenerator::shuffle(Type& vect)
 {
 	if (vect.size() > 1u)
 		std::shuffle(vect.begin(), vect.end(), HexRandomGenerator::rGen);
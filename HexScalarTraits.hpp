@@ -0,0 +1,120 @@
+#ifndef __HEX_SCALAR_TRAITS_HPP__
+#define __HEX_SCALAR_TRAITS_HPP__
+
+// Standard Libraries
+#include <atomic>
+#include <complex>
+#include <type_traits>
+
+// Qt Libraries
+#include <QtGlobal>
+
+/* HexBasicSparseMatrix only needs +, - and * from its values, except
+ * for the few operations below that real and complex numbers don't do
+ * the same way. Real is the type of a norm, which is never complex, and
+ * Accumulator is the type sums are computed in: storing values as floats
+ * halves the memory traffic, but adding thousands of them in single
+ * precision loses too many digits, so they are added in double.
+ */
+template<typename Value>
+struct HexScalarTraits
+{
+	using Real = Value;
+	using Accumulator = std::common_type_t<Value, double>;
+	
+	inline static void			AtomicAdd(Value&, Value);
+	inline static Value			Conjugate(Value);
+	inline static Value			ScaleOutput(Value, Value);
+	inline static Real			SquaredMagnitude(Value);
+	inline static Value			UpdateOutput(Accumulator, Value, Value);
+};
+
+template<typename Type>
+struct HexScalarTraits<std::complex<Type>>
+{
+	using Real = Type;
+	using Accumulator = std::complex<std::common_type_t<Type, double>>;
+	
+	inline static void			AtomicAdd(std::complex<Type>&, std::complex<Type>);
+	inline static std::complex<Type>	Conjugate(std::complex<Type>);
+	inline static std::complex<Type>	ScaleOutput(std::complex<Type>, std::complex<Type>);
+	inline static Real			SquaredMagnitude(std::complex<Type>);
+	inline static std::complex<Type>	UpdateOutput(Accumulator, std::complex<Type>, std::complex<Type>);
+};
+
+template<typename Value>
+void HexScalarTraits<Value>::AtomicAdd(Value& target, Value value)
+{
+	std::atomic_ref<Value>(target).fetch_add(value, std::memory_order_relaxed);
+}
+
+template<typename Value>
+Value HexScalarTraits<Value>::Conjugate(Value value)
+{
+	return value;
+}
+
+/* Every product of the form y = alpha*A*x + beta*y goes through this and
+ * UpdateOutput. A zero beta overwrites y rather than scale it, as in BLAS,
+ * since 0*y is NaN when y holds a NaN or an infinity, which would then leak
+ * into a result that isn't meant to depend on y at all.
+ */
+template<typename Value>
+Value HexScalarTraits<Value>::ScaleOutput(Value beta, Value y)
+{
+	return (beta == Value() ? Value() : beta*y);
+}
+
+template<typename Value>
+typename HexScalarTraits<Value>::Real HexScalarTraits<Value>::SquaredMagnitude(Value value)
+{
+	return value*value;
+}
+
+/* This is y = product + beta*y, product being alpha*A*x, computed in
+ * Accumulator precision. See ScaleOutput for a zero beta.
+ */
+template<typename Value>
+Value HexScalarTraits<Value>::UpdateOutput(Accumulator product, Value beta, Value y)
+{
+	return static_cast<Value>(beta == Value() ? product : product + static_cast<Accumulator>(beta)*static_cast<Accumulator>(y));
+}
+
+/* The standard guarantees that a complex number is laid out like an array
+ * of two reals, so both halves can be added atomically one after the other.
+ * The sum as a whole isn't atomic, but nobody reads it before the end anyway.
+ */
+template<typename Type>
+void HexScalarTraits<std::complex<Type>>::AtomicAdd(std::complex<Type>& target, std::complex<Type> value)
+{
+	auto& parts = reinterpret_cast<Type(&)[2]>(target);
+	
+	std::atomic_ref<Type>(parts[0]).fetch_add(value.real(), std::memory_order_relaxed);
+	std::atomic_ref<Type>(parts[1]).fetch_add(value.imag(), std::memory_order_relaxed);
+}
+
+template<typename Type>
+std::complex<Type> HexScalarTraits<std::complex<Type>>::Conjugate(std::complex<Type> value)
+{
+	return std::conj(value);
+}
+
+template<typename Type>
+std::complex<Type> HexScalarTraits<std::complex<Type>>::ScaleOutput(std::complex<Type> beta, std::complex<Type> y)
+{
+	return (beta == std::complex<Type>() ? std::complex<Type>() : beta*y);
+}
+
+template<typename Type>
+Type HexScalarTraits<std::complex<Type>>::SquaredMagnitude(std::complex<Type> value)
+{
+	return std::norm(value);
+}
+
+template<typename Type>
+std::complex<Type> HexScalarTraits<std::complex<Type>>::UpdateOutput(Accumulator product, std::complex<Type> beta, std::complex<Type> y)
+{
+	return static_cast<std::complex<Type>>(beta == std::complex<Type>() ? product : product + static_cast<Accumulator>(beta)*static_cast<Accumulator>(y));
+}
+
+#endif
@@ -0,0 +1,427 @@
+#ifndef __HEX_SELL_MATRIX_HPP__
+#define __HEX_SELL_MATRIX_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) and (defined(__GNUC__) or defined(__clang__))
+#define HEX_SELL_MATRIX_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrix.hpp"
+
+enum class HexSellKernel
+{
+	Scalar,		// Plain C++, which the compiler vectorises as well as it can
+	Avx2,		// Two 4-wide gathers per chunk slice, needs AVX2 and FMA
+	Avx512		// One 8-wide gather per chunk slice, needs AVX-512F
+};
+
+/* This is the SELL-C-σ format: rows are cut into chunks of ChunkSize rows,
+ * and each chunk is stored column-major, padded to its longest row. The
+ * lanes of a SIMD register then each follow one row of the chunk, which
+ * is what CSR can't do well with short rows of uneven lengths. To keep
+ * the padding low, rows are first sorted by length, but only within
+ * windows of sigma rows so that x and y are still accessed with some
+ * locality. The matrix is read-only: it is meant to be built once from a
+ * HexBasicSparseMatrix and then multiplied many times.
+ *
+ * The x86 kernels only exist for double values with qint32 indexes, which
+ * is HexSparseMatrix, every other type uses the scalar kernel.
+ */
+
+template<typename Value = qreal, typename Index = qint32>
+class HexBasicSellMatrix
+{
+	public:
+	
+		using Accumulator = typename HexScalarTraits<Value>::Accumulator;
+		
+		static constexpr qint32							ChunkSize = 8;
+		static constexpr qint32							DefaultSigma = 256;
+		
+	private:
+	
+		static constexpr bool							HasX86Kernels = std::is_same_v<Value, double> and std::is_same_v<Index, qint32>;
+		
+		inline static HexSellKernel						GetBestKernel(void);
+		
+		std::vector<Value>							values;
+		std::vector<Index>							columns;
+		std::vector<Index>							chunkOffsets;
+		std::vector<Index>							rows;
+		std::vector<Index>							laneLengths;		// Same order as rows, 0 for the rows that fill the last chunk
+		
+		Index									numberOfRows = 0;
+		Index									numberOfColumns = 0;
+		Index									numberOfValues = 0;
+		
+		HexSellKernel								kernel = HexSellKernel::Scalar;
+		
+		inline void								multiplyChunks(Index, Index, Value, const Value*, Value, Value*) const;
+		inline void								multiplyChunksAvx2(Index, Index, Value, const Value*, Value, Value*) const;
+		inline void								multiplyChunksAvx512(Index, Index, Value, const Value*, Value, Value*) const;
+		inline void								storeChunk(Index, const Accumulator*, Value, Value, Value*) const;
+		
+	public:
+	
+		inline									HexBasicSellMatrix(void);
+		template<typename Layout> inline explicit				HexBasicSellMatrix(const HexBasicSparseMatrix<Value, Index, Layout>&, qint32 = DefaultSigma);
+		
+		inline HexSellKernel							getKernel(void) const;
+		inline Index								getNumberOfColumns(void) const;
+		inline Index								getNumberOfRows(void) const;
+		inline qreal								getPaddingRatio(void) const;
+		inline void								multiply(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiply(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline void								setKernel(HexSellKernel);
+};
+
+using HexSellMatrix = HexBasicSellMatrix<>;
+
+template<typename Value, typename Index>
+HexBasicSellMatrix<Value, Index>::HexBasicSellMatrix(void)
+{
+}
+
+/* Rows past the last one, which only exist to fill the last chunk, get -1
+ * in rows. Padding cells repeat the last column of their row with a zero
+ * value, but the kernels mask them out with laneLengths rather than count
+ * on that zero: 0*x is NaN, not 0, when x is infinite or NaN itself.
+ */
+template<typename Value, typename Index>
+template<typename Layout>
+HexBasicSellMatrix<Value, Index>::HexBasicSellMatrix(const HexBasicSparseMatrix<Value, Index, Layout>& matrix, qint32 sigma)
+{
+	HexBasicSellMatrix::numberOfRows = matrix.getNumberOfRows();
+	HexBasicSellMatrix::numberOfColumns = matrix.getNumberOfColumns();
+	HexBasicSellMatrix::numberOfValues = static_cast<Index>(matrix.getPairs().size());
+	HexBasicSellMatrix::kernel = HexBasicSellMatrix::GetBestKernel();
+	
+	const auto& pairs = matrix.getPairs();
+	const auto& rowOffsets = matrix.getRowOffsets();
+	
+	const auto numberOfChunks = (HexBasicSellMatrix::numberOfRows + ChunkSize - 1)/ChunkSize;
+	const auto windowSize = static_cast<Index>(qMax(sigma, 1));
+	
+	auto rowLengths = std::vector<Index>(HexBasicSellMatrix::numberOfRows, 0);
+	
+	for (auto row = Index(0); row < HexBasicSellMatrix::numberOfRows; ++row)
+		rowLengths[row] = rowOffsets[row + 1] - rowOffsets[row];
+	
+	HexBasicSellMatrix::rows.assign(numberOfChunks*ChunkSize, -1);
+	std::iota(HexBasicSellMatrix::rows.begin(), HexBasicSellMatrix::rows.begin() + HexBasicSellMatrix::numberOfRows, Index(0));
+	
+	for (auto first = Index(0); first < HexBasicSellMatrix::numberOfRows; first += windowSize) // Longest rows first, within each window.
+	{
+		const auto last = qMin(first + windowSize, HexBasicSellMatrix::numberOfRows);
+		std::stable_sort(HexBasicSellMatrix::rows.begin() + first, HexBasicSellMatrix::rows.begin() + last, [&rowLengths](Index row1, Index row2) { return rowLengths[row1] > rowLengths[row2]; });
+	}
+	
+	HexBasicSellMatrix::laneLengths.assign(numberOfChunks*ChunkSize, 0);
+	
+	for (auto slot = Index(0); slot < HexBasicSellMatrix::numberOfRows; ++slot)
+		HexBasicSellMatrix::laneLengths[slot] = rowLengths[HexBasicSellMatrix::rows[slot]];
+	
+	HexBasicSellMatrix::chunkOffsets.assign(numberOfChunks + 1, 0);
+	
+	for (auto chunk = Index(0); chunk < numberOfChunks; ++chunk)
+	{
+		auto width = Index(0);
+		
+		for (auto lane = 0; lane < ChunkSize; ++lane)
+		{
+			const auto row = HexBasicSellMatrix::rows[chunk*ChunkSize + lane];
+			
+			if (row >= 0)
+				width = qMax(width, rowLengths[row]);
+		}
+		
+		HexBasicSellMatrix::chunkOffsets[chunk + 1] = HexBasicSellMatrix::chunkOffsets[chunk] + width*ChunkSize;
+	}
+	
+	HexBasicSellMatrix::values.assign(HexBasicSellMatrix::chunkOffsets.back(), Value());
+	HexBasicSellMatrix::columns.assign(HexBasicSellMatrix::chunkOffsets.back(), 0);
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBasicSellMatrix::chunkOffsets.back()));
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSellMatrix::chunkOffsets, numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto chunk = boundaries[thread]; chunk < boundaries[thread + 1]; ++chunk)
+		{
+			const auto offset = HexBasicSellMatrix::chunkOffsets[chunk];
+			const auto width = (HexBasicSellMatrix::chunkOffsets[chunk + 1] - offset)/ChunkSize;
+			
+			for (auto lane = 0; lane < ChunkSize; ++lane)
+			{
+				const auto row = HexBasicSellMatrix::rows[chunk*ChunkSize + lane];
+				auto column = Index(0);
+				auto slot = Index(0);
+				
+				if (row >= 0)
+				{
+					for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+					{
+						const auto& pr = pairs[index];
+						column = pr.column;
+						
+						HexBasicSellMatrix::values[offset + slot*ChunkSize + lane] = pr.value;
+						HexBasicSellMatrix::columns[offset + slot*ChunkSize + lane] = column;
+						++slot;
+					}
+				}
+				
+				for (; slot < width; ++slot)
+					HexBasicSellMatrix::columns[offset + slot*ChunkSize + lane] = column;
+			}
+		}
+	});
+}
+
+/* Detection happens once, the first time a matrix gets built. AVX-512 is
+ * only worth it when the whole chunk fits in one register, which is the
+ * case for 8 doubles.
+ */
+template<typename Value, typename Index>
+HexSellKernel HexBasicSellMatrix<Value, Index>::GetBestKernel(void)
+{
+#ifdef HEX_SELL_MATRIX_X86_KERNELS
+	if constexpr (HexBasicSellMatrix::HasX86Kernels)
+	{
+		static const auto bestKernel = []()
+		{
+			__builtin_cpu_init();
+			
+			if (__builtin_cpu_supports("avx512f"))
+				return HexSellKernel::Avx512;
+			
+			if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma"))
+				return HexSellKernel::Avx2;
+			
+			return HexSellKernel::Scalar;
+		}();
+		
+		return bestKernel;
+	}
+#endif
+	
+	return HexSellKernel::Scalar;
+}
+
+template<typename Value, typename Index>
+HexSellKernel HexBasicSellMatrix<Value, Index>::getKernel(void) const
+{
+	return HexBasicSellMatrix::kernel;
+}
+
+template<typename Value, typename Index>
+Index HexBasicSellMatrix<Value, Index>::getNumberOfColumns(void) const
+{
+	return HexBasicSellMatrix::numberOfColumns;
+}
+
+template<typename Value, typename Index>
+Index HexBasicSellMatrix<Value, Index>::getNumberOfRows(void) const
+{
+	return HexBasicSellMatrix::numberOfRows;
+}
+
+/* This is the number of stored cells, padding included, per non-zero value.
+ * It should stay close to 1, otherwise sigma is too small for this matrix.
+ */
+template<typename Value, typename Index>
+qreal HexBasicSellMatrix<Value, Index>::getPaddingRatio(void) const
+{
+	if (HexBasicSellMatrix::numberOfValues == 0)
+		return 1.;
+	
+	return static_cast<qreal>(HexBasicSellMatrix::values.size())/static_cast<qreal>(HexBasicSellMatrix::numberOfValues);
+}
+
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::multiply(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBasicSellMatrix::multiply(Value(1), x, Value(), y);
+}
+
+/* Same contract as HexBasicSparseMatrix::multiply, y = alpha*A*x + beta*y.
+ * Chunks are split between threads according to the number of cells they
+ * hold, and no two chunks share a row so threads never write to the same
+ * place of y.
+ */
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::multiply(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBasicSellMatrix::numberOfColumns))
+		return;
+	
+	y.resize(HexBasicSellMatrix::numberOfRows, Value());
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBasicSellMatrix::values.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSellMatrix::chunkOffsets, numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto firstChunk = boundaries[thread];
+		const auto lastChunk = boundaries[thread + 1];
+		
+		if (HexBasicSellMatrix::kernel == HexSellKernel::Avx512)
+			HexBasicSellMatrix::multiplyChunksAvx512(firstChunk, lastChunk, alpha, x.data(), beta, y.data());
+		else if (HexBasicSellMatrix::kernel == HexSellKernel::Avx2)
+			HexBasicSellMatrix::multiplyChunksAvx2(firstChunk, lastChunk, alpha, x.data(), beta, y.data());
+		else
+			HexBasicSellMatrix::multiplyChunks(firstChunk, lastChunk, alpha, x.data(), beta, y.data());
+	});
+}
+
+/* The lanes are the innermost loop, so even this plain version is
+ * something the compiler can vectorise, gathers aside. Cells past the end
+ * of their row are padding, see the constructor.
+ */
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::multiplyChunks(Index firstChunk, Index lastChunk, Value alpha, const Value* x, Value beta, Value* y) const
+{
+	for (auto chunk = firstChunk; chunk < lastChunk; ++chunk)
+	{
+		const auto lengths = HexBasicSellMatrix::laneLengths.data() + chunk*ChunkSize;
+		const auto fullEnd = HexBasicSellMatrix::chunkOffsets[chunk] + *std::min_element(lengths, lengths + ChunkSize)*ChunkSize; // Up to there, no lane is padding yet.
+		
+		auto sums = std::array<Accumulator, ChunkSize>();
+		auto index = HexBasicSellMatrix::chunkOffsets[chunk];
+		
+		for (; index < fullEnd; index += ChunkSize)
+		{
+			for (auto lane = 0; lane < ChunkSize; ++lane)
+				sums[lane] += static_cast<Accumulator>(HexBasicSellMatrix::values[index + lane])*static_cast<Accumulator>(x[HexBasicSellMatrix::columns[index + lane]]);
+		}
+		
+		for (auto slot = (index - HexBasicSellMatrix::chunkOffsets[chunk])/ChunkSize; index < HexBasicSellMatrix::chunkOffsets[chunk + 1]; index += ChunkSize, ++slot)
+		{
+			for (auto lane = 0; lane < ChunkSize; ++lane)
+				sums[lane] += static_cast<Accumulator>(HexBasicSellMatrix::values[index + lane])*static_cast<Accumulator>(slot < lengths[lane] ? x[HexBasicSellMatrix::columns[index + lane]] : Value());
+		}
+		
+		HexBasicSellMatrix::storeChunk(chunk, sums.data(), alpha, beta, y);
+	}
+}
+
+#ifdef HEX_SELL_MATRIX_X86_KERNELS
+template<typename Value, typename Index>
+__attribute__((target("avx2,fma"))) void HexBasicSellMatrix<Value, Index>::multiplyChunksAvx2(Index firstChunk, Index lastChunk, Value alpha, const Value* x, Value beta, Value* y) const
+{
+	if constexpr (HexBasicSellMatrix::HasX86Kernels)
+	{
+		for (auto chunk = firstChunk; chunk < lastChunk; ++chunk)
+		{
+			const auto lengths1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexBasicSellMatrix::laneLengths.data() + chunk*ChunkSize));
+			const auto lengths2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexBasicSellMatrix::laneLengths.data() + chunk*ChunkSize + 4));
+			
+			auto sums1 = _mm256_setzero_pd();
+			auto sums2 = _mm256_setzero_pd();
+			auto slot = 0;
+			
+			for (auto index = HexBasicSellMatrix::chunkOffsets[chunk]; index < HexBasicSellMatrix::chunkOffsets[chunk + 1]; index += ChunkSize, ++slot)
+			{
+				const auto columns1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexBasicSellMatrix::columns.data() + index));
+				const auto columns2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexBasicSellMatrix::columns.data() + index + 4));
+				
+				const auto slots = _mm_set1_epi32(slot); // Padding lanes gather a zero instead of x, see multiplyChunks.
+				const auto mask1 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpgt_epi32(lengths1, slots)));
+				const auto mask2 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpgt_epi32(lengths2, slots)));
+				
+				sums1 = _mm256_fmadd_pd(_mm256_loadu_pd(HexBasicSellMatrix::values.data() + index), _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, columns1, mask1, 8), sums1);
+				sums2 = _mm256_fmadd_pd(_mm256_loadu_pd(HexBasicSellMatrix::values.data() + index + 4), _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, columns2, mask2, 8), sums2);
+			}
+			
+			auto sums = std::array<Accumulator, ChunkSize>();
+			
+			_mm256_storeu_pd(sums.data(), sums1);
+			_mm256_storeu_pd(sums.data() + 4, sums2);
+			
+			HexBasicSellMatrix::storeChunk(chunk, sums.data(), alpha, beta, y);
+		}
+	}
+	else
+		HexBasicSellMatrix::multiplyChunks(firstChunk, lastChunk, alpha, x, beta, y);
+}
+
+template<typename Value, typename Index>
+__attribute__((target("avx512f"))) void HexBasicSellMatrix<Value, Index>::multiplyChunksAvx512(Index firstChunk, Index lastChunk, Value alpha, const Value* x, Value beta, Value* y) const
+{
+	if constexpr (HexBasicSellMatrix::HasX86Kernels)
+	{
+		for (auto chunk = firstChunk; chunk < lastChunk; ++chunk)
+		{
+			const auto lengths = _mm512_castsi256_si512(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(HexBasicSellMatrix::laneLengths.data() + chunk*ChunkSize)));
+			
+			auto sums = _mm512_setzero_pd();
+			auto slot = 0;
+			
+			for (auto index = HexBasicSellMatrix::chunkOffsets[chunk]; index < HexBasicSellMatrix::chunkOffsets[chunk + 1]; index += ChunkSize, ++slot)
+			{
+				const auto chunkColumns = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(HexBasicSellMatrix::columns.data() + index));
+				const auto mask = static_cast<__mmask8>(_mm512_cmpgt_epi32_mask(lengths, _mm512_set1_epi32(slot))); // Only the 8 lanes of the chunk count, the upper half of lengths is undefined.
+				
+				sums = _mm512_fmadd_pd(_mm512_loadu_pd(HexBasicSellMatrix::values.data() + index), _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, chunkColumns, x, 8), sums);
+			}
+			
+			auto chunkSums = std::array<Accumulator, ChunkSize>();
+			_mm512_storeu_pd(chunkSums.data(), sums);
+			
+			HexBasicSellMatrix::storeChunk(chunk, chunkSums.data(), alpha, beta, y);
+		}
+	}
+	else
+		HexBasicSellMatrix::multiplyChunks(firstChunk, lastChunk, alpha, x, beta, y);
+}
+#else
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::multiplyChunksAvx2(Index firstChunk, Index lastChunk, Value alpha, const Value* x, Value beta, Value* y) const
+{
+	HexBasicSellMatrix::multiplyChunks(firstChunk, lastChunk, alpha, x, beta, y);
+}
+
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::multiplyChunksAvx512(Index firstChunk, Index lastChunk, Value alpha, const Value* x, Value beta, Value* y) const
+{
+	HexBasicSellMatrix::multiplyChunks(firstChunk, lastChunk, alpha, x, beta, y);
+}
+#endif
+
+/* Asking for a kernel the CPU doesn't have silently falls
+ * back on the best one it has, like everything else here.
+ */
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::setKernel(HexSellKernel knl)
+{
+	const auto bestKernel = HexBasicSellMatrix::GetBestKernel();
+	HexBasicSellMatrix::kernel = (static_cast<qint32>(knl) <= static_cast<qint32>(bestKernel) ? knl : bestKernel);
+}
+
+template<typename Value, typename Index>
+void HexBasicSellMatrix<Value, Index>::storeChunk(Index chunk, const Accumulator* sums, Value alpha, Value beta, Value* y) const
+{
+	for (auto lane = 0; lane < ChunkSize; ++lane)
+	{
+		const auto row = HexBasicSellMatrix::rows[chunk*ChunkSize + lane];
+		
+		if (row < 0)
+			break;
+		
+		y[row] = HexScalarTraits<Value>::UpdateOutput(static_cast<Accumulator>(alpha)*sums[lane], beta, y[row]);
+	}
+}
+
+#endif
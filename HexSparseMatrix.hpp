@@ -2,6 +2,16 @@
 #define __HEX_SPARSE_MATRIX_HPP__
 
 // Standard Libraries
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <queue>
+#include <type_traits>
 #include <vector>
 
 // Qt Libraries
@@ -9,72 +19,114 @@
 #include <QtMath>
 
 // Custom Libraries
+#include "HexOrdering.hpp"
+#include "HexParallel.hpp"
 #include "HexRandomGenerator.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrixLayouts.hpp"
+#include "HexVersionedCache.hpp"
+#include "HexWorkspace.hpp"
 
-struct HexColumnValuePair
+template<typename Matrix> struct HexBasicDecomposition;
+
+enum class HexQrMethod
 {
-	qreal	value = 0.;
-	qint32	column = 0;
-	
-	HexColumnValuePair(qreal v = 0., qint32 c = 0) : value(v), column(c)
-	{
-	}
+	GramSchmidt,	// Explicit Q, built from the columns of the matrix one after another
+	Householder	// Q kept as sparse Householder reflectors, after a fill-reducing column ordering
 };
 
-/* It's more efficient to tie these two values together
- * and make one vector, rather than use two separate vectors
- * that would always have the same length, and that would
- * always be parsed at the same time one after the other.
- */
-
-struct HexDecomposition;
-
-class HexSparseMatrix
+template<typename Value = qreal, typename Index = qint32, typename Layout = HexInterleavedLayout>
+class HexBasicSparseMatrix
 {
+	public:
+	
+		using Accumulator = typename HexScalarTraits<Value>::Accumulator;
+		using ColumnValuePair = HexBasicColumnValuePair<Value, Index>;
+		using Container = typename Layout::template Container<Value, Index>;
+		using IndexType = Index;
+		using Real = typename HexScalarTraits<Value>::Real;
+		using ValueType = Value;
+	
 	private:
 	
-		template<typename Type> inline static void				Change(std::vector<HexColumnValuePair>&, Type, Type, qreal);
-		inline static qreal							Normalise(std::vector<HexColumnValuePair>&);
+		using AccumulatorPair = HexBasicColumnValuePair<Accumulator, Index>;
+		using AccumulatorReal = typename HexScalarTraits<Accumulator>::Real;
+		
+		static constexpr qint64							DenseAccumulatorRatio = 16;
+		static constexpr qint64							GramSchmidtPanelSize = 16;
+		static constexpr qint64							MaximumInsertionSortLength = 32;
+		static constexpr qint64							MaximumNumberOfTransposeBlocks = 64;
+		static constexpr qint64							MaximumPanelValues = 1 << 22;
+		static constexpr qint32							MinimumTransposeBlockShift = 17;
+		static constexpr qreal							RankPivotThreshold = 0.1;
+		
+		template<typename Pair> inline static HexBasicSparseMatrix		Assemble(const std::pmr::vector<std::pmr::vector<Pair>>&, Index, bool);
+		inline static AccumulatorReal						Normalise(std::pmr::vector<AccumulatorPair>&);
 		template<typename Type1, typename Type2> inline static void		Rewrite(Type1&, Type2, Type2);
-		template<typename Type1, typename Type2> inline static qreal		Scalar(Type1, Type1, Type2, Type2);
 	
-		std::vector<HexColumnValuePair>						pairs;
-		std::vector<qint32>							rowOffsets;
+		Container								pairs;
+		std::vector<Index>							rowOffsets;
 		
-		qint32									numberOfRows = 0;
-		qint32									numberOfColumns = 0;
+		Index									numberOfRows = 0;
+		Index									numberOfColumns = 0;
 		
-		inline void								addValue(qint32, qint32, qreal);
-		inline qint32								indexOfFreeCell(qint32, qint32) const;
-		inline bool								insertColumnValuePair(qint32, qint32, qint32, qreal);
-		inline void								removeValue(qint32, qint32);
+		mutable HexVersionedCache<HexBasicSparseMatrix>				columnView;
+		quint64									version = 0;
+		
+		template<typename Type> inline void					accumulateTransposed(Value, const std::vector<Value>&, std::vector<Type>&) const;
+		inline void								addValue(Index, Index, Value);
+		inline HexBasicDecomposition<HexBasicSparseMatrix>			getHouseholderDecomposition(std::pmr::memory_resource*) const;
+		inline Index								indexOfFreeCell(Index, Index) const;
+		inline bool								insertColumnValuePair(Index, Index, Index, Value);
+		template<qint32 Width> inline void					multiplyPanel(Index, Index, const Value*, Value*, qint32) const;
+		inline void								removeValue(Index, Index);
 		inline void								updateNumberOfColumns(void);
 		inline void								updateNumberOfRows(void);
+		inline bool								writePermuted(Container&, std::vector<Index>&, const std::vector<Index>&, const std::vector<Index>&) const;
+		inline void								writeTransposed(Container&, std::vector<Index>&, std::pmr::memory_resource*) const;
 	
 	public:
 	
-		inline									HexSparseMatrix(void);
-		inline									HexSparseMatrix(const std::vector<std::vector<HexColumnValuePair>>&, qint32);
+		static constexpr qreal							RankTolerance = 20.*std::numeric_limits<Real>::epsilon();
+		
+		inline static HexBasicSparseMatrix					Multiply(const HexBasicSparseMatrix&, const HexBasicSparseMatrix&, std::pmr::memory_resource* = std::pmr::get_default_resource());
+		
+		inline									HexBasicSparseMatrix(void);
+		inline									HexBasicSparseMatrix(const std::vector<std::vector<ColumnValuePair>>&, Index);
+		inline									HexBasicSparseMatrix(Container&&, std::vector<Index>&&, Index);
+		template<typename... Types> inline explicit				HexBasicSparseMatrix(const HexBasicSparseMatrix<Types...>&);
 	
 		inline void								downsize(void);
-		inline HexDecomposition							getDecomposition(void) const;
-		inline std::vector<qreal>						getDenseMatrix(void) const;
+		inline std::vector<Real>						getColumnNorms(void) const;
+		inline std::shared_ptr<const HexBasicSparseMatrix>			getColumnView(void) const;
+		inline HexBasicDecomposition<HexBasicSparseMatrix>			getDecomposition(HexQrMethod = HexQrMethod::GramSchmidt, std::pmr::memory_resource* = std::pmr::get_default_resource()) const;
+		inline std::vector<Value>						getDenseMatrix(void) const;
 		inline qreal								getDensity(void) const;
 		inline QString								getDimensionString(void) const;
-		inline qint32								getHighestColumn(void) const;
-		inline qint32								getNumberOfColumns(void) const;
-		inline qint32								getNumberOfRows(void) const;
-		inline const std::vector<HexColumnValuePair>&				getPairs(void) const;
-		inline qint32								getRank(void) const;
-		inline const std::vector<qint32>&					getRowOffsets(void) const;
+		inline Index								getHighestColumn(void) const;
+		inline Index								getNumberOfColumns(void) const;
+		inline Index								getNumberOfRows(void) const;
+		inline const Container&							getPairs(void) const;
+		inline Index								getRank(qreal = HexBasicSparseMatrix::RankTolerance) const;
+		inline const std::vector<Index>&					getRowOffsets(void) const;
 		inline qreal								getSparsity(void) const;
 		inline bool								insertOne(HexRandomGenerator&);
-		inline void								setValue(qint32, qint32, qreal);
+		inline void								leastSquares(const std::vector<Value>&, std::vector<Value>&, HexQrMethod = HexQrMethod::Householder) const;
+		inline void								leastSquares(const std::vector<Value>&, qint32, std::vector<Value>&, HexQrMethod = HexQrMethod::Householder) const;
+		inline void								multiply(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiply(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline void								multiply(const std::vector<Value>&, qint32, std::vector<Value>&) const;
+		inline void								multiplyTransposed(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiplyTransposed(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline bool								permute(const std::vector<Index>&, const std::vector<Index>&);
+		inline HexBasicSparseMatrix						permuted(const std::vector<Index>&, const std::vector<Index>&) const;
+		inline void								releaseColumnView(void) const;
+		inline void								setValue(Index, Index, Value);
 		inline bool								shuffle(HexRandomGenerator&);
-		inline void								swapColumns(qint32, qint32);
-		inline void								swapRows(qint32, qint32);
-		inline void								transpose(void);
-		inline HexSparseMatrix							transposed(void) const;
+		inline void								swapColumns(Index, Index);
+		inline void								swapRows(Index, Index);
+		inline void								transpose(std::pmr::memory_resource* = std::pmr::get_default_resource());
+		inline HexBasicSparseMatrix						transposed(std::pmr::memory_resource* = std::pmr::get_default_resource()) const;
 };
 
 /* This class is supposed to recalculate its numberOfRows and
@@ -82,402 +134,2035 @@ class HexSparseMatrix
  * its last row and a non-zero value in its last column.
  */
 
-struct HexDecomposition // QR decomposition of matrix, where Q is unitary and R is upper triangular
+template<typename Matrix>
+struct HexBasicDecomposition // QR decomposition of matrix, where Q is unitary and R is upper triangular
 {
-	HexSparseMatrix unitary;		// Q
-	HexSparseMatrix triangular;		// R
+	using Index = typename Matrix::IndexType;
+	using Real = typename Matrix::Real;
+	using Value = typename Matrix::ValueType;
+	
+	HexQrMethod method = HexQrMethod::GramSchmidt;
+	
+	Matrix unitary;				// Q, Gram-Schmidt only
+	Matrix triangular;			// R
+	Matrix reflectors;			// Householder only, row k is v(k) and Q = H(0)...H(n - 1) with H(k) = I - beta(k)*v(k)*v(k)'
+	std::vector<Real> coefficients;		// Householder only, beta(k)
+	std::vector<Index> rowPermutation;	// Householder only, row i of the matrix is row rowPermutation[i] of QR
+	std::vector<Index> columnPermutation;	// Householder only, column k of QR is column columnPermutation[k] of the matrix
+	
+	inline void						applyInverseUnitary(const std::vector<Value>&, std::vector<Value>&) const;
+	inline void						applyInverseUnitary(const std::vector<Value>&, qint32, std::vector<Value>&) const;
+	inline void						applyReflector(Index, qint32, std::vector<typename Matrix::Accumulator>&) const;
+	inline void						applyUnitary(const std::vector<Value>&, std::vector<Value>&) const;
+	inline void						solve(const std::vector<Value>&, std::vector<Value>&) const;
+	inline void						solve(const std::vector<Value>&, qint32, std::vector<Value>&) const;
+	inline void						solveRevealingRank(const std::vector<Value>&, std::size_t, std::vector<typename Matrix::Accumulator>&) const;
 };
 
-HexSparseMatrix::HexSparseMatrix(void)
-{
-}
+using HexSparseMatrix = HexBasicSparseMatrix<>;
+using HexDecomposition = HexBasicDecomposition<HexSparseMatrix>;
 
-HexSparseMatrix::HexSparseMatrix(const std::vector<std::vector<HexColumnValuePair>>& rows, qint32 noc)
-{
-	HexSparseMatrix::numberOfRows = static_cast<qint32>(rows.size());
-	HexSparseMatrix::numberOfColumns = noc;
-	
-	HexSparseMatrix::rowOffsets.push_back(0);
-	
-	for (const auto& row : rows)
-	{
-		if (not row.empty())
-			HexSparseMatrix::pairs.insert(HexSparseMatrix::pairs.end(), row.cbegin(), row.cend());
-		
-		const auto nextIndex = HexSparseMatrix::rowOffsets.back() + static_cast<qint32>(row.size());
-		HexSparseMatrix::rowOffsets.push_back(nextIndex);
-	}
-}
+/* Mixed precision: values are stored as floats, which almost halves the
+ * memory traffic of the bandwidth-bound kernels, but every sum is still
+ * taken in double. Converting from and to HexSparseMatrix is explicit,
+ * e.g. HexMixedSparseMatrix(matrix) and HexSparseMatrix(mixedMatrix).
+ */
+using HexMixedSparseMatrix = HexBasicSparseMatrix<float>;
+using HexMixedDecomposition = HexBasicDecomposition<HexMixedSparseMatrix>;
 
-void HexSparseMatrix::addValue(qint32 row, qint32 column, qreal value)
+/* With Gram-Schmidt, y = Q'b goes through the explicit Q. With Householder
+ * reflections Q is never formed: b is permuted, then every reflector is
+ * applied in turn, in Accumulator precision. y then has as many rows as Q,
+ * which is more than the matrix when fictitious rows had to be added to put
+ * every reflector on the diagonal. Q' is the conjugate transpose, Q^-1.
+ */
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::applyInverseUnitary(const std::vector<Value>& b, std::vector<Value>& y) const
 {
-	if (HexSparseMatrix::pairs.empty())
+	if (HexBasicDecomposition::method == HexQrMethod::GramSchmidt)
 	{
-		HexSparseMatrix::rowOffsets = std::vector<qint32>(row + 1, 0);
-		HexSparseMatrix::rowOffsets.push_back(1);
+		if constexpr (std::is_same_v<Value, Real>)
+			HexBasicDecomposition::unitary.multiplyTransposed(b, y);
+		else // Q'b = conj(transpose(Q)*conj(b))
+		{
+			auto conjugatedB = std::vector<Value>(b.size());
 			
-		HexSparseMatrix::pairs.emplace_back(value, column);
+			std::transform(b.cbegin(), b.cend(), conjugatedB.begin(), HexScalarTraits<Value>::Conjugate);
+			HexBasicDecomposition::unitary.multiplyTransposed(conjugatedB, y);
+			std::transform(y.cbegin(), y.cend(), y.begin(), HexScalarTraits<Value>::Conjugate);
+		}
 		
-		HexSparseMatrix::numberOfRows = row + 1;
-		HexSparseMatrix::numberOfColumns = column + 1;
 		return;
 	}
 	
-	if (column >= HexSparseMatrix::numberOfColumns)
-		HexSparseMatrix::numberOfColumns = column + 1;
+	HexBasicDecomposition::applyInverseUnitary(b, 1, y);
+}
+
+/* The same for a row-major block of numberOfVectors right-hand sides,
+ * all of them going through Q' in a single pass: Gram-Schmidt multiplies
+ * them by the column view of Q, which Q keeps for the next solves, and
+ * Householder applies each reflector to the whole block.
+ */
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::applyInverseUnitary(const std::vector<Value>& b, qint32 numberOfVectors, std::vector<Value>& y) const
+{
+	using Accumulator = typename Matrix::Accumulator;
 	
-	if (HexSparseMatrix::numberOfRows <= row) // Here HexSparseMatrix::numberOfRows represents the first row that doesn't exist
+	if (HexBasicDecomposition::method == HexQrMethod::GramSchmidt)
 	{
-		const auto indexOfNewValue = static_cast<qint32>(HexSparseMatrix::pairs.size());
+		const auto view = HexBasicDecomposition::unitary.getColumnView();
 		
-		HexSparseMatrix::rowOffsets.insert(HexSparseMatrix::rowOffsets.end(), row - HexSparseMatrix::numberOfRows, indexOfNewValue);
-		HexSparseMatrix::rowOffsets.push_back(indexOfNewValue + 1);
+		if constexpr (std::is_same_v<Value, Real>)
+			view->multiply(b, numberOfVectors, y);
+		else // Q'B = conj(transpose(Q)*conj(B))
+		{
+			auto conjugatedB = std::vector<Value>(b.size());
+			
+			std::transform(b.cbegin(), b.cend(), conjugatedB.begin(), HexScalarTraits<Value>::Conjugate);
+			view->multiply(conjugatedB, numberOfVectors, y);
+			std::transform(y.cbegin(), y.cend(), y.begin(), HexScalarTraits<Value>::Conjugate);
+		}
 		
-		HexSparseMatrix::pairs.emplace_back(value, column);
-		HexSparseMatrix::numberOfRows = row + 1;
 		return;
 	}
 	
-	if (HexSparseMatrix::numberOfRows - 1 == row) // Here HexSparseMatrix::numberOfRows - 1 represents the last row
-	{	
-		const auto firstPossibleIndex = HexSparseMatrix::rowOffsets.back() - 1;
-		const auto lastPossibleIndex = HexSparseMatrix::rowOffsets[row];
-		const auto newValueWasInserted = HexSparseMatrix::insertColumnValuePair(firstPossibleIndex, lastPossibleIndex, column, value);
-		
-		if (newValueWasInserted)
-			++HexSparseMatrix::rowOffsets.back();
-		
+	const auto numberOfRows = HexBasicDecomposition::rowPermutation.size();
+	const auto width = static_cast<std::size_t>(numberOfVectors);
+	
+	if (numberOfVectors < 1 or b.size() < numberOfRows*width)
 		return;
-	}
 	
-	const auto startIndex = HexSparseMatrix::rowOffsets[row];
+	auto work = std::vector<Accumulator>(static_cast<std::size_t>(HexBasicDecomposition::reflectors.getNumberOfColumns())*width);
 	
-	if (HexSparseMatrix::rowOffsets[row + 1] == startIndex) // The row is full of zeroes
+	for (auto row = std::size_t(0); row < numberOfRows; ++row)
 	{
-		for (auto it = HexSparseMatrix::rowOffsets.begin() + row + 1; it != HexSparseMatrix::rowOffsets.end(); ++it)
-			++(*it);
-		
-		HexSparseMatrix::pairs.emplace(HexSparseMatrix::pairs.begin() + startIndex, value, column);
-		return;
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			work[HexBasicDecomposition::rowPermutation[row]*width + vector] = static_cast<Accumulator>(b[row*width + vector]);
 	}
 	
-	const auto firstPossibleIndex = HexSparseMatrix::rowOffsets[row + 1] - 1;
-	const auto lastPossibleIndex = HexSparseMatrix::rowOffsets[row];
-	const auto newValueWasInserted = HexSparseMatrix::insertColumnValuePair(firstPossibleIndex, lastPossibleIndex, column, value);
+	for (auto k = Index(0); k < HexBasicDecomposition::reflectors.getNumberOfRows(); ++k)
+		HexBasicDecomposition::applyReflector(k, numberOfVectors, work);
 	
-	if (newValueWasInserted)
-	{
-		for (auto it = HexSparseMatrix::rowOffsets.begin() + row + 1; it != HexSparseMatrix::rowOffsets.end(); ++it)
-			++(*it);
-	}
+	y.resize(work.size());
+	std::transform(work.cbegin(), work.cend(), y.begin(), [](Accumulator val) { return static_cast<Value>(val); });
 }
 
-template<typename Type>
-void HexSparseMatrix::Change(std::vector<HexColumnValuePair>& vect, Type beg2, Type end2, qreal coeff)
+/* x = H(k)x = x - beta(k)*v(k)*(v(k)'x), which only reads and writes
+ * the few rows where v(k) isn't zero. x is a row-major block of
+ * numberOfVectors vectors, taken by panels of up to PanelWidth so that
+ * v(k) is read once per panel rather than once per vector.
+ */
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::applyReflector(Index k, qint32 numberOfVectors, std::vector<typename Matrix::Accumulator>& x) const
 {
-	if (beg2 == end2 or coeff == 0.) // If row is full of zeroes OR if nothing to add
-		return;
+	using Accumulator = typename Matrix::Accumulator;
 	
-	auto newVect = std::vector<HexColumnValuePair>();
+	constexpr auto PanelWidth = 16;
 	
-	const auto end1 = vect.cend();
-	auto cit1 = vect.cbegin();
+	const auto& pairs = HexBasicDecomposition::reflectors.getPairs();
+	const auto& rowOffsets = HexBasicDecomposition::reflectors.getRowOffsets();
+	const auto coefficient = static_cast<Accumulator>(HexBasicDecomposition::coefficients[k]);
 	
-	for (auto cit2 = beg2; cit2 != end2; ++cit2)
+	for (auto firstVector = 0; firstVector < numberOfVectors; firstVector += PanelWidth)
 	{
-		while (cit1 != end1 and cit1->column < cit2->column)
+		const auto width = qMin(PanelWidth, numberOfVectors - firstVector);
+		auto taus = std::array<Accumulator, PanelWidth>();
+		
+		for (auto index = rowOffsets[k]; index < rowOffsets[k + 1]; ++index)
 		{
-			newVect.emplace_back(cit1->value, cit1->column);
-			++cit1;
+			const auto conjugated = HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(pairs[index].value));
+			const auto* const values = x.data() + static_cast<std::size_t>(pairs[index].column)*numberOfVectors + firstVector;
+			
+			for (auto vector = 0; vector < width; ++vector)
+				taus[vector] += conjugated*values[vector];
 		}
 		
-		if (cit1 == end1 or cit1->column != cit2->column)
-			newVect.emplace_back(cit2->value*coeff, cit2->column);
-		else
+		for (auto vector = 0; vector < width; ++vector)
+			taus[vector] *= coefficient;
+		
+		for (auto index = rowOffsets[k]; index < rowOffsets[k + 1]; ++index)
 		{
-			newVect.emplace_back(cit1->value + cit2->value*coeff, cit2->column);
-			++cit1;
+			const auto value = static_cast<Accumulator>(pairs[index].value);
+			auto* const values = x.data() + static_cast<std::size_t>(pairs[index].column)*numberOfVectors + firstVector;
+			
+			for (auto vector = 0; vector < width; ++vector)
+				values[vector] -= value*taus[vector];
 		}
 	}
+}
+
+/* The other way round, b = Qy, with the reflectors applied backwards
+ * and the rows permuted back. Rows of y beyond those of Q are ignored.
+ */
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::applyUnitary(const std::vector<Value>& y, std::vector<Value>& b) const
+{
+	if (HexBasicDecomposition::method == HexQrMethod::GramSchmidt)
+		return HexBasicDecomposition::unitary.multiply(y, b);
+	
+	auto work = std::vector<typename Matrix::Accumulator>(HexBasicDecomposition::reflectors.getNumberOfColumns());
+	
+	for (auto row = std::size_t(0); row < qMin(work.size(), y.size()); ++row)
+		work[row] = static_cast<typename Matrix::Accumulator>(y[row]);
+	
+	for (auto k = HexBasicDecomposition::reflectors.getNumberOfRows() - 1; k >= 0; --k)
+		HexBasicDecomposition::applyReflector(k, 1, work);
 	
-	newVect.insert(newVect.end(), cit1, end1);
-	vect.swap(newVect);
+	b.resize(HexBasicDecomposition::rowPermutation.size());
+	
+	for (auto row = std::size_t(0); row < HexBasicDecomposition::rowPermutation.size(); ++row)
+		b[row] = static_cast<Value>(work[HexBasicDecomposition::rowPermutation[row]]);
+}
+
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::solve(const std::vector<Value>& b, std::vector<Value>& x) const
+{
+	HexBasicDecomposition::solve(b, 1, x);
 }
 
-void HexSparseMatrix::downsize(void)
+/* x minimises ||Ax - b||, and solves Ax = b when A is square and
+ * invertible. y = Q'b, then R is solved from the bottom up. With
+ * Gram-Schmidt the pivot of row i of R is its first value, and a row
+ * without one belongs to a column that depends on the previous ones, whose
+ * value is left at zero. With Householder, see solveRevealingRank. For
+ * rank-deficient matrices, x is thus a basic solution, not the one with the
+ * smallest norm. b and x are row-major blocks of numberOfVectors vectors,
+ * solved in one pass, and nothing here changes the decomposition, which can
+ * be kept for the next right-hand sides.
+ */
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::solve(const std::vector<Value>& b, qint32 numberOfVectors, std::vector<Value>& x) const
 {
-	if (HexSparseMatrix::pairs.empty())
+	using Accumulator = typename Matrix::Accumulator;
+	
+	const auto isHouseholder = (HexBasicDecomposition::method == HexQrMethod::Householder);
+	const auto numberOfColumns = (isHouseholder ? static_cast<Index>(HexBasicDecomposition::columnPermutation.size()) : HexBasicDecomposition::triangular.getNumberOfColumns());
+	const auto width = static_cast<std::size_t>(qMax(numberOfVectors, 0));
+	
+	x.assign(static_cast<std::size_t>(numberOfColumns)*width, Value());
+	
+	if (width == 0 or HexBasicDecomposition::triangular.getPairs().empty())
+		return;
+	
+	auto y = std::vector<Value>();
+	HexBasicDecomposition::applyInverseUnitary(b, numberOfVectors, y);
+	
+	const auto& pairs = HexBasicDecomposition::triangular.getPairs();
+	const auto& rowOffsets = HexBasicDecomposition::triangular.getRowOffsets();
+	
+	if (y.size() < static_cast<std::size_t>(HexBasicDecomposition::triangular.getNumberOfRows())*width)
+		return;
+	
+	auto z = std::vector<Accumulator>(static_cast<std::size_t>(numberOfColumns)*width, Accumulator());
+	
+	if (isHouseholder)
+		HexBasicDecomposition::solveRevealingRank(y, width, z);
+	
+	for (auto row = HexBasicDecomposition::triangular.getNumberOfRows() - 1; row >= 0 and not isHouseholder; --row)
 	{
-		HexSparseMatrix::numberOfRows = 0;
-		HexSparseMatrix::numberOfColumns = 0;
+		const auto first = rowOffsets[row];
+		
+		if (first == rowOffsets[row + 1])
+			continue;
+		
+		const auto pivot = pairs[first].column;
+		const auto diagonal = static_cast<Accumulator>(pairs[first].value);
+		
+		if (diagonal == Accumulator())
+			continue;
+		
+		auto* const solution = z.data() + static_cast<std::size_t>(pivot)*width;
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			solution[vector] = static_cast<Accumulator>(y[static_cast<std::size_t>(row)*width + vector]);
+		
+		for (auto index = first + 1; index < rowOffsets[row + 1]; ++index)
+		{
+			const auto value = static_cast<Accumulator>(pairs[index].value);
+			const auto* const known = z.data() + static_cast<std::size_t>(pairs[index].column)*width;
+			
+			for (auto vector = std::size_t(0); vector < width; ++vector)
+				solution[vector] -= value*known[vector];
+		}
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			solution[vector] /= diagonal;
 	}
-	else
+	
+	for (auto column = Index(0); column < numberOfColumns; ++column)
 	{
-		HexSparseMatrix::updateNumberOfRows();
-		HexSparseMatrix::updateNumberOfColumns();
+		const auto target = static_cast<std::size_t>(isHouseholder ? HexBasicDecomposition::columnPermutation[column] : column)*width;
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			x[target + vector] = static_cast<Value>(z[static_cast<std::size_t>(column)*width + vector]);
 	}
 }
 
-/* The hard copy at the end of this function can't really be avoided
- * as you can't populate Q with a new vector until you know for sure
- * that this vector is independent from the previous ones. I chose to
- * populate Q with all the independent vectors that were found at the
- * end of the function, rather than do it one vector at a time at
- * each iteration. Same thing with R and its scalar coeffs.
+/* The R of Householder has a zero, or tiny, diagonal value wherever a
+ * column depends on the previous ones in fill-reducing order, yet such a row
+ * still holds an equation on the next columns, and can't simply be skipped.
+ * Its rows are rotated again, from the top, into an R' where each row owns a
+ * pivot column, together with the rows of y, the way getRank rotates the
+ * rows of the matrix: a row is rotated against the rows of R' whose pivot it
+ * holds, oldest first, and what is left of it is dropped, with its part of
+ * the residual, when it is below tolerance. A row keeps its diagonal as its
+ * pivot when that is at least PivotThreshold times its largest value, so
+ * that a full-rank R needs no rotation at all, and takes its largest value
+ * otherwise. Columns without a pivot are left at zero, and the others are
+ * solved from the newest row of R' to the oldest, every row of R' being zero
+ * on the pivots of the older ones.
  */
-HexDecomposition HexSparseMatrix::getDecomposition(void) const
+template<typename Matrix>
+void HexBasicDecomposition<Matrix>::solveRevealingRank(const std::vector<Value>& y, std::size_t width, std::vector<typename Matrix::Accumulator>& z) const
 {
-	auto decomp = HexDecomposition();
+	using Accumulator = typename Matrix::Accumulator;
+	using AccumulatorPair = HexBasicColumnValuePair<Accumulator, Index>;
+	using AccumulatorReal = typename HexScalarTraits<Accumulator>::Real;
 	
-	if (HexSparseMatrix::pairs.empty())
-		return decomp;
+	constexpr auto PivotThreshold = 0.1;
+	
+	const auto& pairs = HexBasicDecomposition::triangular.getPairs();
+	const auto& rowOffsets = HexBasicDecomposition::triangular.getRowOffsets();
+	const auto numberOfRows = HexBasicDecomposition::triangular.getNumberOfRows();
+	const auto numberOfColumns = static_cast<Index>(HexBasicDecomposition::columnPermutation.size());
+	
+	auto squaredNorms = std::vector<AccumulatorReal>(numberOfColumns, AccumulatorReal());
 	
-	const auto transposed = HexSparseMatrix::transposed();
-	auto stopIndex = transposed.rowOffsets.cbegin() + 1u;
+	for (const auto& pr : pairs) // Q is unitary, so these are the column norms of the matrix as well.
+		squaredNorms[pr.column] += HexScalarTraits<Accumulator>::SquaredMagnitude(static_cast<Accumulator>(pr.value));
 	
-	std::vector<std::vector<HexColumnValuePair>> rowBase;
-	std::vector<std::vector<HexColumnValuePair>> coeffs;
+	const auto numberOfMatrixRows = static_cast<AccumulatorReal>(HexBasicDecomposition::rowPermutation.size());
+	const auto threshold = static_cast<AccumulatorReal>(Matrix::RankTolerance)*(numberOfMatrixRows + static_cast<AccumulatorReal>(numberOfColumns))*qSqrt(*std::max_element(squaredNorms.cbegin(), squaredNorms.cend()));
 	
-	for (const auto& startIndex : transposed.rowOffsets)
+	auto rowsOfR = std::vector<std::vector<AccumulatorPair>>(numberOfColumns); // Rows of R', indexed by pivot, the pivot first
+	auto rightHandSides = std::vector<Accumulator>(z.size()); // Rows of y rotated along, indexed by pivot as well
+	auto pivots = std::vector<Index>(); // Pivot of each row of R', oldest first
+	auto ranks = std::vector<Index>(numberOfColumns, -1); // Row of R' of each pivot
+	
+	auto x = std::vector<Accumulator>(numberOfColumns, Accumulator());
+	auto rightHandSide = std::vector<Accumulator>(width);
+	auto pattern = std::vector<Index>();
+	auto inPattern = std::vector<bool>(numberOfColumns, false);
+	auto rotated = std::vector<quint64>(numberOfColumns, 0);
+	auto numberOfRotations = quint64(0);
+	auto queue = std::priority_queue<Index, std::vector<Index>, std::greater<Index>>();
+	
+	const auto addToPattern = [&](Index column)
+	{
+		if (inPattern[column])
+			return;
+		
+		inPattern[column] = true;
+		pattern.push_back(column);
+		
+		if (ranks[column] >= 0)
+			queue.push(ranks[column]);
+	};
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
 	{
-		auto& rowCoeffs = coeffs.emplace_back();
+		for (auto index = rowOffsets[row]; index < rowOffsets[row + 1]; ++index)
+		{
+			x[pairs[index].column] = static_cast<Accumulator>(pairs[index].value);
+			addToPattern(pairs[index].column);
+		}
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			rightHandSide[vector] = static_cast<Accumulator>(y[static_cast<std::size_t>(row)*width + vector]);
 		
-		if (startIndex != *stopIndex) // Row is not full of zeroes, it might be a new independent vector
+		while (not queue.empty())
 		{
-			const auto start = transposed.pairs.cbegin() + startIndex;
-			const auto stop = transposed.pairs.cbegin() + (*stopIndex);
+			const auto pivot = pivots[queue.top()];
+			queue.pop();
+			
+			const auto b = x[pivot];
+			
+			if (b == Accumulator())
+				continue;
 			
-			auto newCandidateForBase = std::vector<HexColumnValuePair>(start, stop);
-			auto rowIndex = 0;
+			// [c s; -conj(s) c] is unitary and zeroes x(pivot) against R'(pivot, pivot).
+			auto& rowOfR = rowsOfR[pivot];
+			auto* const rotatedRightHandSide = rightHandSides.data() + static_cast<std::size_t>(pivot)*width;
+			const auto a = rowOfR.front().value;
+			const auto magnitudeOfA = qSqrt(HexScalarTraits<Accumulator>::SquaredMagnitude(a));
+			const auto rho = qSqrt(HexScalarTraits<Accumulator>::SquaredMagnitude(a) + HexScalarTraits<Accumulator>::SquaredMagnitude(b));
+			const auto c = magnitudeOfA/rho;
+			const auto s = a/magnitudeOfA*HexScalarTraits<Accumulator>::Conjugate(b)/rho;
+			const auto conjugatedS = HexScalarTraits<Accumulator>::Conjugate(s);
+			const auto sizeOfPattern = pattern.size();
 			
-			for (const auto& vct : rowBase)
+			++numberOfRotations;
+			
+			for (auto& pr : rowOfR)
 			{
-				const auto scalar = HexSparseMatrix::Scalar(vct.cbegin(), vct.cend(), start, stop);
+				const auto r = pr.value;
 				
-				rowCoeffs.emplace_back(scalar, rowIndex);
-				++rowIndex;
+				addToPattern(pr.column);
+				rotated[pr.column] = numberOfRotations;
+				pr.value = c*r + s*x[pr.column];
+				x[pr.column] = c*x[pr.column] - conjugatedS*r;
 			}
 			
-			auto cit = rowCoeffs.cbegin();
-			
-			for (const auto& vct : rowBase)
+			for (auto index = std::size_t(0); index < sizeOfPattern; ++index)
 			{
-				HexSparseMatrix::Change(newCandidateForBase, vct.cbegin(), vct.cend(), -cit->value);
-				++cit;
+				const auto column = pattern[index];
+				
+				if (rotated[column] != numberOfRotations and x[column] != Accumulator())
+				{
+					rowOfR.emplace_back(s*x[column], column);
+					x[column] *= c;
+				}
 			}
 			
-			const auto norm = HexSparseMatrix::Normalise(newCandidateForBase);
-			
-			if (norm != 0.)
+			for (auto vector = std::size_t(0); vector < width; ++vector)
 			{
-				rowCoeffs.emplace_back(norm, rowIndex);
-				rowBase.emplace_back().swap(newCandidateForBase);
+				const auto r = rotatedRightHandSide[vector];
+				
+				rotatedRightHandSide[vector] = c*r + s*rightHandSide[vector];
+				rightHandSide[vector] = c*rightHandSide[vector] - conjugatedS*r;
 			}
+			
+			x[pivot] = Accumulator();
 		}
 		
-		++stopIndex;
+		auto squaredNorm = AccumulatorReal();
+		auto pivot = Index(-1);
 		
-		if (transposed.rowOffsets.cend() == stopIndex)
-			break;
-	}
-	
-	while (rowBase.size() < static_cast<quint32>(HexSparseMatrix::numberOfRows))
-		rowBase.emplace_back();
-	
-	decomp.unitary = HexSparseMatrix(rowBase, HexSparseMatrix::numberOfRows).transposed();
-	decomp.triangular = HexSparseMatrix(coeffs, HexSparseMatrix::numberOfRows).transposed();
-	
-	return decomp;
-}
-
-/* This function assumes the user knows how to read the vector,
- * meaning they know how many rows and columns this matrix has.
- */
-std::vector<qreal> HexSparseMatrix::getDenseMatrix(void) const
-{
-	std::vector<qreal> matrix;
-	matrix.reserve(HexSparseMatrix::numberOfRows*HexSparseMatrix::numberOfColumns);
-	
-	auto stopIndex = HexSparseMatrix::rowOffsets.cbegin() + 1u;
-	
-	for (const auto& startIndex : HexSparseMatrix::rowOffsets)
-	{
-		auto currentColumn = 0;
+		for (const auto& column : pattern)
+		{
+			const auto squaredMagnitude = HexScalarTraits<Accumulator>::SquaredMagnitude(x[column]);
+			
+			squaredNorm += squaredMagnitude;
+			
+			if (pivot < 0 or squaredMagnitude > HexScalarTraits<Accumulator>::SquaredMagnitude(x[pivot]))
+				pivot = column;
+		}
 		
-		for (auto index = startIndex; index < *stopIndex; ++index)
+		if (qSqrt(squaredNorm) > threshold) // Independent from the previous rows, x becomes a row of R'.
 		{
-			const auto& currentPair = HexSparseMatrix::pairs[index];
+			if (inPattern[row] and HexScalarTraits<Accumulator>::SquaredMagnitude(x[row]) >= PivotThreshold*PivotThreshold*HexScalarTraits<Accumulator>::SquaredMagnitude(x[pivot]))
+				pivot = row;
 			
-			while (currentColumn < currentPair.column)
+			auto& rowOfR = rowsOfR[pivot];
+			
+			rowOfR.emplace_back(x[pivot], pivot);
+			
+			for (const auto& column : pattern)
 			{
-				matrix.push_back(0.);
-				++currentColumn;
+				if (column != pivot and x[column] != Accumulator())
+					rowOfR.emplace_back(x[column], column);
 			}
 			
-			matrix.push_back(currentPair.value);
-			++currentColumn;
+			std::copy(rightHandSide.cbegin(), rightHandSide.cend(), rightHandSides.begin() + static_cast<qint64>(pivot)*static_cast<qint64>(width));
+			ranks[pivot] = static_cast<Index>(pivots.size());
+			pivots.push_back(pivot);
 		}
 		
-		while (currentColumn < HexSparseMatrix::numberOfColumns)
+		for (const auto& column : pattern)
 		{
-			matrix.push_back(0.);
-			++currentColumn;
+			x[column] = Accumulator();
+			inPattern[column] = false;
 		}
 		
-		++stopIndex;
-		
-		if (HexSparseMatrix::rowOffsets.cend() == stopIndex)
-			break;
+		pattern.clear();
 	}
 	
-	return matrix;
-}
-
-qreal HexSparseMatrix::getDensity(void) const
-{
-	return static_cast<qreal>(HexSparseMatrix::pairs.size())/static_cast<qreal>(HexSparseMatrix::numberOfColumns*HexSparseMatrix::numberOfRows);
+	for (auto rank = pivots.size(); rank-- > 0;)
+	{
+		const auto pivot = pivots[rank];
+		const auto& rowOfR = rowsOfR[pivot];
+		auto* const solution = z.data() + static_cast<std::size_t>(pivot)*width;
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			solution[vector] = rightHandSides[static_cast<std::size_t>(pivot)*width + vector];
+		
+		for (auto index = std::size_t(1); index < rowOfR.size(); ++index)
+		{
+			const auto* const known = z.data() + static_cast<std::size_t>(rowOfR[index].column)*width;
+			
+			for (auto vector = std::size_t(0); vector < width; ++vector)
+				solution[vector] -= rowOfR[index].value*known[vector];
+		}
+		
+		for (auto vector = std::size_t(0); vector < width; ++vector)
+			solution[vector] /= rowOfR.front().value;
+	}
 }
 
-QString HexSparseMatrix::getDimensionString(void) const
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout>::HexBasicSparseMatrix(void)
 {
-	return QString::number(HexSparseMatrix::numberOfRows) + " × " + QString::number(HexSparseMatrix::numberOfColumns);
 }
 
-qint32 HexSparseMatrix::getHighestColumn(void) const
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout>::HexBasicSparseMatrix(const std::vector<std::vector<ColumnValuePair>>& rows, Index noc)
 {
-	auto maxColumn = 0;
+	HexBasicSparseMatrix::numberOfRows = static_cast<Index>(rows.size());
+	HexBasicSparseMatrix::numberOfColumns = noc;
 	
-	for (const auto& pr : pairs)
+	HexBasicSparseMatrix::rowOffsets.push_back(0);
+	
+	for (const auto& row : rows)
 	{
-		if (pr.column + 1 == HexSparseMatrix::numberOfColumns)
-			return pr.column;
+		if (not row.empty())
+			HexBasicSparseMatrix::pairs.insert(HexBasicSparseMatrix::pairs.end(), row.cbegin(), row.cend());
 		
-		if (pr.column > maxColumn)
-			maxColumn = pr.column;
+		const auto nextIndex = HexBasicSparseMatrix::rowOffsets.back() + static_cast<Index>(row.size());
+		HexBasicSparseMatrix::rowOffsets.push_back(nextIndex);
 	}
-	
-	return maxColumn;
-}
-
-qint32 HexSparseMatrix::getNumberOfColumns(void) const
-{
-	return HexSparseMatrix::numberOfColumns;
 }
 
-qint32 HexSparseMatrix::getNumberOfRows(void) const
+/* This one takes ready-made CSR arrays, which is what bulk builders
+ * produce. The rows are expected to be sorted by column already.
+ */
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout>::HexBasicSparseMatrix(Container&& prs, std::vector<Index>&& offsets, Index noc) : pairs(std::move(prs)), rowOffsets(std::move(offsets))
 {
-	return HexSparseMatrix::numberOfRows;
+	HexBasicSparseMatrix::numberOfRows = (HexBasicSparseMatrix::rowOffsets.empty() ? 0 : static_cast<Index>(HexBasicSparseMatrix::rowOffsets.size()) - 1);
+	HexBasicSparseMatrix::numberOfColumns = noc;
 }
 
-const std::vector<HexColumnValuePair>& HexSparseMatrix::getPairs(void) const
+/* Converting from another layout costs one copy of the pairs, the row
+ * offsets being the same for all layouts. The value and index types may
+ * differ too, in which case every value and every index gets cast.
+ */
+template<typename Value, typename Index, typename Layout>
+template<typename... Types>
+HexBasicSparseMatrix<Value, Index, Layout>::HexBasicSparseMatrix(const HexBasicSparseMatrix<Types...>& matrix) : pairs(matrix.getPairs().size()), rowOffsets(matrix.getRowOffsets().cbegin(), matrix.getRowOffsets().cend())
 {
-	return HexSparseMatrix::pairs;
+	HexBasicSparseMatrix::numberOfRows = static_cast<Index>(matrix.getNumberOfRows());
+	HexBasicSparseMatrix::numberOfColumns = static_cast<Index>(matrix.getNumberOfColumns());
+	
+	auto it = HexBasicSparseMatrix::pairs.begin();
+	
+	for (const auto& pr : matrix.getPairs())
+	{
+		*it = ColumnValuePair(static_cast<Value>(pr.value), static_cast<Index>(pr.column));
+		++it;
+	}
 }
 
-const std::vector<qint32>& HexSparseMatrix::getRowOffsets(void) const
+/* This is the scattering part of multiplyTransposed, which adds
+ * alpha*transpose(A)*x to y. Type is either Value or Accumulator.
+ */
+template<typename Value, typename Index, typename Layout>
+template<typename Type>
+void HexBasicSparseMatrix<Value, Index, Layout>::accumulateTransposed(Value alpha, const std::vector<Value>& x, std::vector<Type>& y) const
 {
-	return HexSparseMatrix::rowOffsets;
+	const auto numberOfElements = static_cast<qint64>(HexBasicSparseMatrix::pairs.size());
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfElements);
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSparseMatrix::rowOffsets, numberOfThreads);
+	
+	if (numberOfThreads < 2)
+	{
+		for (auto row = Index(0); row < HexBasicSparseMatrix::numberOfRows; ++row)
+		{
+			const auto coeff = static_cast<Type>(alpha)*static_cast<Type>(x[row]);
+			
+			for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < HexBasicSparseMatrix::rowOffsets[row + 1]; ++index)
+				y[HexBasicSparseMatrix::pairs[index].column] += coeff*static_cast<Type>(HexBasicSparseMatrix::pairs[index].value);
+		}
+		
+		return;
+	}
+	
+	if (static_cast<qint64>(numberOfThreads)*HexBasicSparseMatrix::numberOfColumns > numberOfElements)
+	{
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+			{
+				const auto coeff = static_cast<Type>(alpha)*static_cast<Type>(x[row]);
+				
+				for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < HexBasicSparseMatrix::rowOffsets[row + 1]; ++index)
+				{
+					const auto& pr = HexBasicSparseMatrix::pairs[index];
+					HexScalarTraits<Type>::AtomicAdd(y[pr.column], coeff*static_cast<Type>(pr.value));
+				}
+			}
+		});
+		
+		return;
+	}
+	
+	auto partialResults = std::vector<std::vector<Type>>(numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		auto& partialResult = partialResults[thread];
+		partialResult.assign(HexBasicSparseMatrix::numberOfColumns, Type());
+		
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			const auto coeff = static_cast<Type>(alpha)*static_cast<Type>(x[row]);
+			
+			for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < HexBasicSparseMatrix::rowOffsets[row + 1]; ++index)
+				partialResult[HexBasicSparseMatrix::pairs[index].column] += coeff*static_cast<Type>(HexBasicSparseMatrix::pairs[index].value);
+		}
+	});
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread) // The reduction is split by columns, so that no two threads write to the same place.
+	{
+		const auto firstColumn = static_cast<Index>(static_cast<qint64>(HexBasicSparseMatrix::numberOfColumns)*thread/numberOfThreads);
+		const auto lastColumn = static_cast<Index>(static_cast<qint64>(HexBasicSparseMatrix::numberOfColumns)*(thread + 1)/numberOfThreads);
+		
+		for (const auto& partialResult : partialResults)
+		{
+			for (auto column = firstColumn; column < lastColumn; ++column)
+				y[column] += partialResult[column];
+		}
+	});
 }
 
-qreal HexSparseMatrix::getSparsity(void) const
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::addValue(Index row, Index column, Value value)
 {
-	return 1. - HexSparseMatrix::getDensity();
+	if (HexBasicSparseMatrix::pairs.empty())
+	{
+		HexBasicSparseMatrix::rowOffsets = std::vector<Index>(row + 1, 0);
+		HexBasicSparseMatrix::rowOffsets.push_back(1);
+			
+		HexBasicSparseMatrix::pairs.emplace_back(value, column);
+		
+		HexBasicSparseMatrix::numberOfRows = row + 1;
+		HexBasicSparseMatrix::numberOfColumns = column + 1;
+		return;
+	}
+	
+	if (column >= HexBasicSparseMatrix::numberOfColumns)
+		HexBasicSparseMatrix::numberOfColumns = column + 1;
+	
+	if (HexBasicSparseMatrix::numberOfRows <= row) // Here HexBasicSparseMatrix::numberOfRows represents the first row that doesn't exist
+	{
+		const auto indexOfNewValue = static_cast<Index>(HexBasicSparseMatrix::pairs.size());
+		
+		HexBasicSparseMatrix::rowOffsets.insert(HexBasicSparseMatrix::rowOffsets.end(), row - HexBasicSparseMatrix::numberOfRows, indexOfNewValue);
+		HexBasicSparseMatrix::rowOffsets.push_back(indexOfNewValue + 1);
+		
+		HexBasicSparseMatrix::pairs.emplace_back(value, column);
+		HexBasicSparseMatrix::numberOfRows = row + 1;
+		return;
+	}
+	
+	if (HexBasicSparseMatrix::numberOfRows - 1 == row) // Here HexBasicSparseMatrix::numberOfRows - 1 represents the last row
+	{	
+		const auto firstPossibleIndex = HexBasicSparseMatrix::rowOffsets.back() - 1;
+		const auto lastPossibleIndex = HexBasicSparseMatrix::rowOffsets[row];
+		const auto newValueWasInserted = HexBasicSparseMatrix::insertColumnValuePair(firstPossibleIndex, lastPossibleIndex, column, value);
+		
+		if (newValueWasInserted)
+			++HexBasicSparseMatrix::rowOffsets.back();
+		
+		return;
+	}
+	
+	const auto startIndex = HexBasicSparseMatrix::rowOffsets[row];
+	
+	if (HexBasicSparseMatrix::rowOffsets[row + 1] == startIndex) // The row is full of zeroes
+	{
+		for (auto it = HexBasicSparseMatrix::rowOffsets.begin() + row + 1; it != HexBasicSparseMatrix::rowOffsets.end(); ++it)
+			++(*it);
+		
+		HexBasicSparseMatrix::pairs.emplace(HexBasicSparseMatrix::pairs.begin() + startIndex, value, column);
+		return;
+	}
+	
+	const auto firstPossibleIndex = HexBasicSparseMatrix::rowOffsets[row + 1] - 1;
+	const auto lastPossibleIndex = HexBasicSparseMatrix::rowOffsets[row];
+	const auto newValueWasInserted = HexBasicSparseMatrix::insertColumnValuePair(firstPossibleIndex, lastPossibleIndex, column, value);
+	
+	if (newValueWasInserted)
+	{
+		for (auto it = HexBasicSparseMatrix::rowOffsets.begin() + row + 1; it != HexBasicSparseMatrix::rowOffsets.end(); ++it)
+			++(*it);
+	}
 }
 
-bool HexSparseMatrix::insertColumnValuePair(qint32 firstPossibleIndex, qint32 lastPossibleIndex, qint32 column, qreal value)
+/* Builds a matrix out of sparse lines, which are its rows, or its columns
+ * when transposed is set, and rounds values to Value on the way. Lines
+ * have to be sorted. Writing the CSR arrays directly saves the copies of
+ * building a matrix of Accumulator first, then converting it.
+ */
+template<typename Value, typename Index, typename Layout>
+template<typename Pair>
+HexBasicSparseMatrix<Value, Index, Layout> HexBasicSparseMatrix<Value, Index, Layout>::Assemble(const std::pmr::vector<std::pmr::vector<Pair>>& lines, Index lengthOfLines, bool transposed)
 {
-	const auto end = HexSparseMatrix::pairs.begin() + lastPossibleIndex - 1;
-	auto it = HexSparseMatrix::pairs.begin() + firstPossibleIndex;
+	const auto numberOfLines = static_cast<Index>(lines.size());
+	auto numberOfValues = std::size_t(0);
 	
-	while (it != end and it->column > column)
-		--it;
+	for (const auto& line : lines)
+		numberOfValues += line.size();
+	
+	auto newPairs = Container(numberOfValues);
+	auto offsets = std::vector<Index>();
+	
+	if (not transposed)
+	{
+		auto index = Index(0);
+		
+		offsets.reserve(numberOfLines + 1);
+		offsets.push_back(0);
+		
+		for (const auto& line : lines)
+		{
+			for (const auto& pr : line)
+			{
+				newPairs[index] = ColumnValuePair(static_cast<Value>(pr.value), pr.column);
+				++index;
+			}
+			
+			offsets.push_back(index);
+		}
+		
+		return HexBasicSparseMatrix(std::move(newPairs), std::move(offsets), lengthOfLines);
+	}
+	
+	offsets.assign(lengthOfLines + 1, 0);
+	
+	for (const auto& line : lines)
+	{
+		for (const auto& pr : line)
+			++offsets[pr.column + 1];
+	}
+	
+	std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+	auto cursors = std::vector<Index>(offsets.cbegin(), offsets.cend() - 1);
+	
+	for (auto line = Index(0); line < numberOfLines; ++line)
+	{
+		for (const auto& pr : lines[line])
+		{
+			newPairs[cursors[pr.column]] = ColumnValuePair(static_cast<Value>(pr.value), line);
+			++cursors[pr.column];
+		}
+	}
+	
+	return HexBasicSparseMatrix(std::move(newPairs), std::move(offsets), numberOfLines);
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::downsize(void)
+{
+	++HexBasicSparseMatrix::version;
+	
+	if (HexBasicSparseMatrix::pairs.empty())
+	{
+		HexBasicSparseMatrix::numberOfRows = 0;
+		HexBasicSparseMatrix::numberOfColumns = 0;
+	}
+	else
+	{
+		HexBasicSparseMatrix::updateNumberOfRows();
+		HexBasicSparseMatrix::updateNumberOfColumns();
+	}
+}
+
+/* Each norm is the norm of a row of the column view, so columns are
+ * summed one by one without any scattering, and in parallel.
+ */
+template<typename Value, typename Index, typename Layout>
+std::vector<typename HexBasicSparseMatrix<Value, Index, Layout>::Real> HexBasicSparseMatrix<Value, Index, Layout>::getColumnNorms(void) const
+{
+	auto norms = std::vector<Real>(HexBasicSparseMatrix::numberOfColumns, Real());
+	
+	if (HexBasicSparseMatrix::pairs.empty())
+		return norms;
+	
+	const auto view = HexBasicSparseMatrix::getColumnView();
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(view->pairs.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(view->rowOffsets, numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto column = boundaries[thread]; column < boundaries[thread + 1]; ++column)
+		{
+			auto norm = AccumulatorReal();
+			
+			for (auto index = view->rowOffsets[column]; index < view->rowOffsets[column + 1]; ++index)
+				norm += HexScalarTraits<Accumulator>::SquaredMagnitude(static_cast<Accumulator>(view->pairs[index].value));
+			
+			norms[column] = static_cast<Real>(qSqrt(norm));
+		}
+	});
+	
+	return norms;
+}
+
+/* The column view is the CSC form of this matrix, which is nothing but the
+ * CSR form of its transpose: row j of the view holds column j, with row
+ * indexes in place of column indexes. It is built on first use, then shared
+ * by every const call until a mutator bumps the version. It costs as much
+ * memory as the matrix itself, which releaseColumnView gives back.
+ */
+template<typename Value, typename Index, typename Layout>
+std::shared_ptr<const HexBasicSparseMatrix<Value, Index, Layout>> HexBasicSparseMatrix<Value, Index, Layout>::getColumnView(void) const
+{
+	return HexBasicSparseMatrix::columnView.get(HexBasicSparseMatrix::version, [this](void) { return HexBasicSparseMatrix::transposed(); });
+}
+
+/* The hard copy at the end of this function can't really be avoided
+ * as you can't populate Q with a new vector until you know for sure
+ * that this vector is independent from the previous ones. I chose to
+ * populate Q with all the independent vectors that were found at the
+ * end of the function, rather than do it one vector at a time at
+ * each iteration. Same thing with R and its scalar coeffs.
+ *
+ * Gram-Schmidt loses orthogonality quickly in single precision, so
+ * the basis is built in Accumulator precision and only rounded back
+ * to Value once Q and R are complete.
+ *
+ * Columns are taken by panels of up to GramSchmidtPanelSize, scattered
+ * into a dense accumulator where value (row, candidate) sits at
+ * row*panelSize + candidate, so that every basis value meets the whole
+ * panel in one contiguous loop. The panel is projected on the basis in
+ * parallel over basis vectors, then updated in parallel over candidates,
+ * and all of it twice (CGS2) for the orthogonality that classical
+ * Gram-Schmidt alone would lose. Only then are the candidates of the
+ * panel orthogonalised against each other, one after the other as
+ * before. Coefficients that are exactly zero, which are most of them,
+ * are not stored in R.
+ */
+template<typename Value, typename Index, typename Layout>
+HexBasicDecomposition<HexBasicSparseMatrix<Value, Index, Layout>> HexBasicSparseMatrix<Value, Index, Layout>::getDecomposition(HexQrMethod method, std::pmr::memory_resource* resource) const
+{
+	if (method == HexQrMethod::Householder)
+		return HexBasicSparseMatrix::getHouseholderDecomposition(resource);
+	
+	auto decomp = HexBasicDecomposition<HexBasicSparseMatrix>();
+	
+	if (HexBasicSparseMatrix::pairs.empty())
+		return decomp;
+	
+	const auto view = HexBasicSparseMatrix::getColumnView();
+	const auto& transposed = *view;
+	
+	const auto numberOfRows = static_cast<qint64>(HexBasicSparseMatrix::numberOfRows);
+	const auto panelSize = std::clamp(HexBasicSparseMatrix::MaximumPanelValues/numberOfRows, static_cast<qint64>(1), HexBasicSparseMatrix::GramSchmidtPanelSize);
+	
+	auto rowBase = std::pmr::vector<std::pmr::vector<AccumulatorPair>>(resource);
+	auto basisOffsets = std::pmr::vector<qint64>(1, 0, resource); // Prefix sum of the sizes of the basis vectors, to share them between threads
+	auto coeffs = std::pmr::vector<std::pmr::vector<AccumulatorPair>>(transposed.numberOfRows, resource);
+	
+	auto dense = std::pmr::vector<Accumulator>(numberOfRows*panelSize, Accumulator(), resource);
+	auto occupied = std::pmr::vector<quint8>(numberOfRows, 0, resource);
+	auto pattern = std::pmr::vector<Index>(resource); // Rows where any candidate of the panel may be non-zero
+	auto candidates = std::pmr::vector<Index>(resource);
+	
+	auto scalars = std::pmr::vector<Accumulator>(resource); // (basis vector, candidate) at basisIndex*panelSize + candidate, like dense
+	auto projections = std::pmr::vector<Accumulator>(resource); // Sum of both passes
+	auto involved = std::pmr::vector<quint8>(resource);
+	
+	const auto occupy = [&](Index row)
+	{
+		if (not occupied[row])
+		{
+			occupied[row] = 1;
+			pattern.push_back(row);
+		}
+	};
+	
+	// Projects every candidate on the whole basis, then takes the projections out.
+	const auto orthogonalise = [&](void)
+	{
+		const auto sizeOfBasis = static_cast<qint64>(rowBase.size());
+		const auto numberOfCandidates = static_cast<qint64>(candidates.size());
+		const auto work = basisOffsets.back()*numberOfCandidates;
+		const auto numberOfThreads = HexParallel::GetNumberOfThreads(work);
+		const auto boundaries = HexParallel::PartitionOffsets(basisOffsets, numberOfThreads);
+		
+		const auto lowestRow = *std::min_element(pattern.cbegin(), pattern.cend());
+		const auto highestRow = *std::max_element(pattern.cbegin(), pattern.cend());
+		
+		scalars.assign(sizeOfBasis*panelSize, Accumulator());
+		involved.assign(sizeOfBasis, 0);
+		
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			for (auto basisIndex = boundaries[thread]; basisIndex < boundaries[thread + 1]; ++basisIndex)
+			{
+				const auto& vct = rowBase[basisIndex];
+				
+				if (vct.back().column < lowestRow or vct.front().column > highestRow) // The basis vector and the panel share no row.
+					continue;
+				
+				auto* const scalarsOfVector = scalars.data() + basisIndex*panelSize;
+				
+				for (const auto& pr : vct)
+				{
+					if (not occupied[pr.column])
+						continue;
+					
+					const auto conjugated = HexScalarTraits<Accumulator>::Conjugate(pr.value); // Basis vectors come first, so they get the conjugate.
+					const auto* const values = dense.data() + pr.column*panelSize;
+					
+					for (auto candidate = qint64(0); candidate < numberOfCandidates; ++candidate)
+						scalarsOfVector[candidate] += conjugated*values[candidate];
+				}
+				
+				for (auto candidate = qint64(0); candidate < numberOfCandidates; ++candidate)
+				{
+					if (scalarsOfVector[candidate] != Accumulator())
+						involved[basisIndex] = 1;
+				}
+			}
+		});
+		
+		for (auto basisIndex = qint64(0); basisIndex < sizeOfBasis; ++basisIndex)
+		{
+			if (not involved[basisIndex])
+				continue;
+			
+			for (const auto& pr : rowBase[basisIndex])
+				occupy(pr.column);
+			
+			for (auto candidate = qint64(0); candidate < numberOfCandidates; ++candidate)
+				projections[basisIndex*panelSize + candidate] += scalars[basisIndex*panelSize + candidate];
+		}
+		
+		const auto numberOfUpdateThreads = qMin(numberOfThreads, static_cast<qint32>(numberOfCandidates));
+		
+		HexParallel::Run(numberOfUpdateThreads, [&](qint32 thread)
+		{
+			const auto firstCandidate = numberOfCandidates*thread/numberOfUpdateThreads;
+			const auto lastCandidate = numberOfCandidates*(thread + 1)/numberOfUpdateThreads;
+			
+			for (auto basisIndex = qint64(0); basisIndex < sizeOfBasis; ++basisIndex)
+			{
+				if (not involved[basisIndex])
+					continue;
+				
+				const auto* const scalarsOfVector = scalars.data() + basisIndex*panelSize;
+				
+				for (const auto& pr : rowBase[basisIndex])
+				{
+					auto* const values = dense.data() + pr.column*panelSize;
+					
+					for (auto candidate = firstCandidate; candidate < lastCandidate; ++candidate)
+						values[candidate] -= scalarsOfVector[candidate]*pr.value;
+				}
+			}
+		});
+	};
+	
+	for (auto column = Index(0); column < transposed.numberOfRows;)
+	{
+		candidates.clear();
+		
+		for (; column < transposed.numberOfRows and static_cast<qint64>(candidates.size()) < panelSize; ++column)
+		{
+			if (transposed.rowOffsets[column] != transposed.rowOffsets[column + 1]) // Column is not full of zeroes, it might be a new independent vector
+				candidates.push_back(column);
+		}
+		
+		const auto numberOfCandidates = static_cast<qint64>(candidates.size());
+		
+		for (auto candidate = qint64(0); candidate < numberOfCandidates; ++candidate)
+		{
+			for (auto index = transposed.rowOffsets[candidates[candidate]]; index < transposed.rowOffsets[candidates[candidate] + 1]; ++index)
+			{
+				const auto row = transposed.pairs[index].column;
+				
+				occupy(row);
+				dense[row*panelSize + candidate] = static_cast<Accumulator>(transposed.pairs[index].value);
+			}
+		}
+		
+		const auto sizeOfBasis = static_cast<qint64>(rowBase.size());
+		
+		if (sizeOfBasis > 0)
+		{
+			projections.assign(sizeOfBasis*panelSize, Accumulator());
+			
+			orthogonalise();
+			orthogonalise();
+		}
+		
+		std::sort(pattern.begin(), pattern.end());
+		
+		for (auto candidate = qint64(0); candidate < numberOfCandidates; ++candidate)
+		{
+			auto& rowCoeffs = coeffs[candidates[candidate]];
+			
+			for (auto basisIndex = qint64(0); basisIndex < sizeOfBasis; ++basisIndex)
+			{
+				if (projections[basisIndex*panelSize + candidate] != Accumulator())
+					rowCoeffs.emplace_back(projections[basisIndex*panelSize + candidate], static_cast<Index>(basisIndex));
+			}
+			
+			for (auto basisIndex = sizeOfBasis; basisIndex < static_cast<qint64>(rowBase.size()); ++basisIndex) // Vectors of the same panel
+			{
+				auto coefficient = Accumulator();
+				
+				for (auto pass = 0; pass < 2; ++pass)
+				{
+					auto scalar = Accumulator();
+					
+					for (const auto& pr : rowBase[basisIndex])
+						scalar += HexScalarTraits<Accumulator>::Conjugate(pr.value)*dense[pr.column*panelSize + candidate];
+					
+					for (const auto& pr : rowBase[basisIndex])
+						dense[pr.column*panelSize + candidate] -= scalar*pr.value;
+					
+					coefficient += scalar;
+				}
+				
+				if (coefficient != Accumulator())
+					rowCoeffs.emplace_back(coefficient, static_cast<Index>(basisIndex));
+			}
+			
+			auto newCandidateForBase = std::pmr::vector<AccumulatorPair>(resource);
+			
+			for (const auto& row : pattern)
+			{
+				auto& value = dense[row*panelSize + candidate];
+				
+				if (value != Accumulator())
+					newCandidateForBase.emplace_back(value, row);
+				
+				value = Accumulator();
+			}
+			
+			const auto norm = (newCandidateForBase.empty() ? AccumulatorReal() : HexBasicSparseMatrix::Normalise(newCandidateForBase));
+			
+			if (norm != 0. and static_cast<qint64>(rowBase.size()) < numberOfRows) // With floats, rounding errors alone could make a vector look independent from a full basis.
+			{
+				rowCoeffs.emplace_back(norm, static_cast<Index>(rowBase.size()));
+				basisOffsets.push_back(basisOffsets.back() + static_cast<qint64>(newCandidateForBase.size()));
+				rowBase.emplace_back().swap(newCandidateForBase);
+			}
+		}
+		
+		for (const auto& row : pattern)
+			occupied[row] = 0;
+		
+		pattern.clear();
+	}
+	
+	while (rowBase.size() < static_cast<std::size_t>(HexBasicSparseMatrix::numberOfRows))
+		rowBase.emplace_back();
+	
+	decomp.unitary = HexBasicSparseMatrix::Assemble(rowBase, HexBasicSparseMatrix::numberOfRows, true);
+	decomp.triangular = HexBasicSparseMatrix::Assemble(coeffs, HexBasicSparseMatrix::numberOfRows, true);
+	
+	return decomp;
+}
+
+/* This function assumes the user knows how to read the vector,
+ * meaning they know how many rows and columns this matrix has.
+ */
+template<typename Value, typename Index, typename Layout>
+std::vector<Value> HexBasicSparseMatrix<Value, Index, Layout>::getDenseMatrix(void) const
+{
+	std::vector<Value> matrix;
+	matrix.reserve(static_cast<std::size_t>(HexBasicSparseMatrix::numberOfRows)*static_cast<std::size_t>(HexBasicSparseMatrix::numberOfColumns));
+	
+	auto stopIndex = HexBasicSparseMatrix::rowOffsets.cbegin() + 1u;
+	
+	for (const auto& startIndex : HexBasicSparseMatrix::rowOffsets)
+	{
+		auto currentColumn = Index(0);
+		
+		for (auto index = startIndex; index < *stopIndex; ++index)
+		{
+			const auto& currentPair = HexBasicSparseMatrix::pairs[index];
+			
+			while (currentColumn < currentPair.column)
+			{
+				matrix.push_back(Value());
+				++currentColumn;
+			}
+			
+			matrix.push_back(currentPair.value);
+			++currentColumn;
+		}
+		
+		while (currentColumn < HexBasicSparseMatrix::numberOfColumns)
+		{
+			matrix.push_back(Value());
+			++currentColumn;
+		}
+		
+		++stopIndex;
+		
+		if (HexBasicSparseMatrix::rowOffsets.cend() == stopIndex)
+			break;
+	}
+	
+	return matrix;
+}
+
+template<typename Value, typename Index, typename Layout>
+qreal HexBasicSparseMatrix<Value, Index, Layout>::getDensity(void) const
+{
+	return static_cast<qreal>(HexBasicSparseMatrix::pairs.size())/(static_cast<qreal>(HexBasicSparseMatrix::numberOfColumns)*static_cast<qreal>(HexBasicSparseMatrix::numberOfRows)); // The product is taken in floating point, as it doesn't fit in Index for large matrices.
+}
+
+template<typename Value, typename Index, typename Layout>
+QString HexBasicSparseMatrix<Value, Index, Layout>::getDimensionString(void) const
+{
+	return QString::number(HexBasicSparseMatrix::numberOfRows) + " × " + QString::number(HexBasicSparseMatrix::numberOfColumns);
+}
+
+template<typename Value, typename Index, typename Layout>
+Index HexBasicSparseMatrix<Value, Index, Layout>::getHighestColumn(void) const
+{
+	auto maxColumn = Index(0);
+	
+	for (const auto& pr : pairs)
+	{
+		if (pr.column + 1 == HexBasicSparseMatrix::numberOfColumns)
+			return pr.column;
+		
+		if (pr.column > maxColumn)
+			maxColumn = pr.column;
+	}
+	
+	return maxColumn;
+}
+
+/* This is the left-looking sparse Householder QR of CSparse (cs_sqr and
+ * cs_qr), on the columns of the matrix reordered by HexOrdering to limit
+ * the fill of R. The column elimination tree, which is the elimination
+ * tree of A'A, tells where everything goes before any number is computed:
+ * rows are permuted so that every reflector has its first non-zero value on
+ * the diagonal, with fictitious rows added where there is none, and column k
+ * of R only involves the reflectors met while walking up the tree from the
+ * non-zero values of column k. Reflector k is then what remains of column k
+ * below the diagonal, merged with the reflectors of its children in the
+ * tree. Neither R nor the reflectors ever hold more than their fill, which
+ * is why Q is left as reflectors rather than formed, Q having no reason to
+ * be sparse at all.
+ */
+template<typename Value, typename Index, typename Layout>
+HexBasicDecomposition<HexBasicSparseMatrix<Value, Index, Layout>> HexBasicSparseMatrix<Value, Index, Layout>::getHouseholderDecomposition(std::pmr::memory_resource* resource) const
+{
+	auto decomp = HexBasicDecomposition<HexBasicSparseMatrix>();
+	decomp.method = HexQrMethod::Householder;
+	
+	if (HexBasicSparseMatrix::pairs.empty())
+		return decomp;
+	
+	const auto m = HexBasicSparseMatrix::numberOfRows;
+	const auto n = HexBasicSparseMatrix::numberOfColumns;
+	
+	const auto ordering = HexOrdering::ColumnMinimumDegree(*this);
+	const auto view = HexBasicSparseMatrix::getColumnView();
+	
+	const auto& columnOffsets = view->rowOffsets;
+	const auto& columnPairs = view->pairs; // Columns of these pairs are rows of the matrix.
+	
+	auto parent = std::pmr::vector<Index>(n, -1, resource);
+	auto leftmost = std::pmr::vector<Index>(m, -1, resource);
+	
+	{ // Column elimination tree, with path compression through ancestor.
+		auto ancestor = std::pmr::vector<Index>(n, -1, resource);
+		auto previous = std::pmr::vector<Index>(m, -1, resource);
+		
+		for (auto k = Index(0); k < n; ++k)
+		{
+			for (auto p = columnOffsets[ordering[k]]; p < columnOffsets[ordering[k] + 1]; ++p)
+			{
+				const auto row = columnPairs[p].column;
+				
+				for (auto i = previous[row]; i != -1 and i < k;)
+				{
+					const auto next = ancestor[i];
+					ancestor[i] = k;
+					
+					if (next == -1)
+						parent[i] = k;
+					
+					i = next;
+				}
+				
+				previous[row] = k;
+			}
+		}
+	}
+	
+	for (auto k = n - 1; k >= 0; --k)
+	{
+		for (auto p = columnOffsets[ordering[k]]; p < columnOffsets[ordering[k] + 1]; ++p)
+			leftmost[columnPairs[p].column] = k;
+	}
+	
+	auto rowPermutation = std::vector<Index>(m + n, -1);
+	auto numberOfReflectorValues = static_cast<qint64>(0);
+	auto m2 = m;
+	
+	{ // Each row goes to the reflector of its leftmost column, or up the tree if that one is taken.
+		auto nextRow = std::pmr::vector<Index>(m, -1, resource);
+		auto head = std::pmr::vector<Index>(n, -1, resource);
+		auto tail = std::pmr::vector<Index>(n, -1, resource);
+		auto queueLength = std::pmr::vector<Index>(n, 0, resource);
+		
+		for (auto row = m - 1; row >= 0; --row)
+		{
+			const auto k = leftmost[row];
+			
+			if (k == -1)
+				continue;
+			
+			if (queueLength[k]++ == 0)
+				tail[k] = row;
+			
+			nextRow[row] = head[k];
+			head[k] = row;
+		}
+		
+		for (auto k = Index(0); k < n; ++k)
+		{
+			auto row = head[k];
+			++numberOfReflectorValues;
+			
+			if (row < 0) // Nothing left for this reflector, it gets a fictitious row.
+				row = m2++;
+			
+			rowPermutation[row] = k;
+			
+			if (--queueLength[k] <= 0)
+				continue;
+			
+			numberOfReflectorValues += queueLength[k];
+			const auto pa = parent[k];
+			
+			if (pa != -1) // The other rows of k move up to its parent.
+			{
+				if (queueLength[pa] == 0)
+					tail[pa] = tail[k];
+				
+				nextRow[tail[k]] = head[pa];
+				head[pa] = nextRow[row];
+				queueLength[pa] += queueLength[k];
+			}
+		}
+		
+		auto k = n;
+		
+		for (auto row = Index(0); row < m; ++row)
+		{
+			if (rowPermutation[row] < 0)
+				rowPermutation[row] = k++;
+		}
+		
+		rowPermutation.resize(m);
+	}
+	
+	auto reflectorOffsets = std::vector<Index>(n + 1, 0);
+	auto reflectorRows = std::pmr::vector<Index>(resource);
+	auto reflectorValues = std::pmr::vector<Accumulator>(resource);
+	auto coefficients = std::pmr::vector<AccumulatorReal>(n, AccumulatorReal(), resource);
+	auto rowsOfR = std::pmr::vector<std::pmr::vector<ColumnValuePair>>(n, resource);
+	
+	reflectorRows.reserve(numberOfReflectorValues);
+	reflectorValues.reserve(numberOfReflectorValues);
+	
+	auto x = std::pmr::vector<Accumulator>(m2, Accumulator(), resource);
+	auto marks = std::pmr::vector<Index>(m2, -1, resource); // Marks both columns, in the tree, and rows, in reflectors, as row k is the diagonal of column k.
+	auto stack = std::pmr::vector<Index>(n, 0, resource);
+	
+	for (auto k = Index(0); k < n; ++k)
+	{
+		const auto firstValue = static_cast<Index>(reflectorRows.size());
+		auto top = n;
+		
+		reflectorOffsets[k] = firstValue;
+		reflectorRows.push_back(k);
+		marks[k] = k;
+		
+		for (auto p = columnOffsets[ordering[k]]; p < columnOffsets[ordering[k] + 1]; ++p)
+		{
+			const auto row = columnPairs[p].column;
+			auto length = Index(0);
+			
+			for (auto i = leftmost[row]; marks[i] != k; i = parent[i]) // Reflectors to apply, found by going up the tree.
+			{
+				stack[length++] = i;
+				marks[i] = k;
+			}
+			
+			while (length > 0)
+				stack[--top] = stack[--length];
+			
+			const auto i = rowPermutation[row];
+			x[i] = static_cast<Accumulator>(columnPairs[p].value);
+			
+			if (i > k and marks[i] < k)
+			{
+				reflectorRows.push_back(i);
+				marks[i] = k;
+			}
+		}
+		
+		for (auto p = top; p < n; ++p)
+		{
+			const auto i = stack[p];
+			auto tau = Accumulator();
+			
+			for (auto q = reflectorOffsets[i]; q < reflectorOffsets[i + 1]; ++q)
+				tau += HexScalarTraits<Accumulator>::Conjugate(reflectorValues[q])*x[reflectorRows[q]];
+			
+			tau *= coefficients[i];
+			
+			for (auto q = reflectorOffsets[i]; q < reflectorOffsets[i + 1]; ++q)
+				x[reflectorRows[q]] -= reflectorValues[q]*tau;
+			
+			if (x[i] != Accumulator())
+				rowsOfR[i].emplace_back(static_cast<Value>(x[i]), k);
+			
+			x[i] = Accumulator();
+			
+			if (parent[i] == k) // Reflector k inherits the pattern of its children.
+			{
+				for (auto q = reflectorOffsets[i]; q < reflectorOffsets[i + 1]; ++q)
+				{
+					const auto row = reflectorRows[q];
+					
+					if (marks[row] < k)
+					{
+						reflectorRows.push_back(row);
+						marks[row] = k;
+					}
+				}
+			}
+		}
+		
+		reflectorValues.resize(reflectorRows.size());
+		auto norm = AccumulatorReal();
+		
+		for (auto q = static_cast<std::size_t>(firstValue); q < reflectorRows.size(); ++q)
+		{
+			reflectorValues[q] = x[reflectorRows[q]];
+			x[reflectorRows[q]] = Accumulator();
+			norm += HexScalarTraits<Accumulator>::SquaredMagnitude(reflectorValues[q]);
+		}
+		
+		auto s = static_cast<Accumulator>(qSqrt(norm));
+		auto& head = reflectorValues[firstValue];
+		
+		if (norm == AccumulatorReal())
+			head = Accumulator(1);
+		else // Same sign as the head, so that adding them can't cancel out.
+		{
+			if (head != Accumulator())
+				s *= head/static_cast<Accumulator>(std::abs(head));
+			
+			head += s;
+			coefficients[k] = 1./std::real(HexScalarTraits<Accumulator>::Conjugate(s)*head);
+		}
+		
+		if (s != Accumulator()) // Row k of R is still empty, its other values come from the next columns.
+			rowsOfR[k].emplace_back(static_cast<Value>(-s), k);
+	}
+	
+	reflectorOffsets[n] = static_cast<Index>(reflectorRows.size());
+	
+	auto reflectorPairs = Container(reflectorRows.size());
+	auto reflectorOrder = std::pmr::vector<Index>(resource);
+	
+	for (auto k = Index(0); k < n; ++k) // Rows of reflectors were found in no particular order.
+	{
+		reflectorOrder.resize(reflectorOffsets[k + 1] - reflectorOffsets[k]);
+		std::iota(reflectorOrder.begin(), reflectorOrder.end(), reflectorOffsets[k]);
+		std::sort(reflectorOrder.begin(), reflectorOrder.end(), [&reflectorRows](Index q1, Index q2) { return reflectorRows[q1] < reflectorRows[q2]; });
+		
+		auto index = reflectorOffsets[k];
+		
+		for (const auto& q : reflectorOrder)
+		{
+			reflectorPairs[index] = ColumnValuePair(static_cast<Value>(reflectorValues[q]), reflectorRows[q]);
+			++index;
+		}
+	}
+	
+	decomp.triangular = HexBasicSparseMatrix::Assemble(rowsOfR, n, false);
+	decomp.reflectors = HexBasicSparseMatrix(std::move(reflectorPairs), std::move(reflectorOffsets), m2);
+	decomp.coefficients.assign(coefficients.cbegin(), coefficients.cend());
+	decomp.rowPermutation = std::move(rowPermutation);
+	decomp.columnPermutation = ordering;
+	
+	return decomp;
+}
+
+template<typename Value, typename Index, typename Layout>
+Index HexBasicSparseMatrix<Value, Index, Layout>::getNumberOfColumns(void) const
+{
+	return HexBasicSparseMatrix::numberOfColumns;
+}
+
+template<typename Value, typename Index, typename Layout>
+Index HexBasicSparseMatrix<Value, Index, Layout>::getNumberOfRows(void) const
+{
+	return HexBasicSparseMatrix::numberOfRows;
+}
+
+template<typename Value, typename Index, typename Layout>
+const typename HexBasicSparseMatrix<Value, Index, Layout>::Container& HexBasicSparseMatrix<Value, Index, Layout>::getPairs(void) const
+{
+	return HexBasicSparseMatrix::pairs;
+}
+
+/* The rows are rotated into R one at a time with Givens rotations, so that
+ * Q is never formed, nor even stored: all it takes is R and the row being
+ * rotated in. Each row of R owns a pivot column. A new row is rotated
+ * against the rows of R whose pivot it holds, oldest first, as every row
+ * of R is zero on the pivots of the older ones. What is left of it is its
+ * distance to the rows seen so far: when that is below tolerance times
+ * (m + n) times the largest column norm, the row is dependent and thrown
+ * away. Otherwise it becomes a row of R, pivoting on the first column in
+ * fill-reducing order whose value is at least RankPivotThreshold times the
+ * largest one, which trades a little stability for a sparse R, as sparse
+ * LU does. The rank is the number of rows of R in the end.
+ */
+template<typename Value, typename Index, typename Layout>
+Index HexBasicSparseMatrix<Value, Index, Layout>::getRank(qreal tolerance) const
+{
+	if (HexBasicSparseMatrix::pairs.empty())
+		return 0;
+	
+	const auto numberOfColumns = HexBasicSparseMatrix::numberOfColumns;
+	const auto maximumRank = qMin(HexBasicSparseMatrix::numberOfRows, numberOfColumns);
+	const auto ordering = HexOrdering::ColumnMinimumDegree(*this);
+	
+	auto positions = std::vector<Index>(numberOfColumns);
+	auto squaredNorms = std::vector<AccumulatorReal>(numberOfColumns, AccumulatorReal());
+	
+	for (auto k = Index(0); k < numberOfColumns; ++k)
+		positions[ordering[k]] = k;
+	
+	for (const auto& pr : HexBasicSparseMatrix::pairs)
+		squaredNorms[pr.column] += HexScalarTraits<Accumulator>::SquaredMagnitude(static_cast<Accumulator>(pr.value));
+	
+	const auto threshold = static_cast<AccumulatorReal>(tolerance)*static_cast<AccumulatorReal>(HexBasicSparseMatrix::numberOfRows + numberOfColumns)*qSqrt(*std::max_element(squaredNorms.cbegin(), squaredNorms.cend()));
+	
+	auto rowsOfR = std::vector<std::vector<AccumulatorPair>>(numberOfColumns); // Indexed by pivot
+	auto pivots = std::vector<Index>(); // Pivot of each row of R, oldest first
+	auto ranks = std::vector<Index>(numberOfColumns, -1); // Row of R of each pivot
+	
+	auto x = std::vector<Accumulator>(numberOfColumns, Accumulator());
+	auto pattern = std::vector<Index>();
+	auto inPattern = std::vector<bool>(numberOfColumns, false);
+	auto rotated = std::vector<quint64>(numberOfColumns, 0);
+	auto numberOfRotations = quint64(0);
+	auto queue = std::priority_queue<Index, std::vector<Index>, std::greater<Index>>();
+	
+	const auto addToPattern = [&](Index column)
+	{
+		if (inPattern[column])
+			return;
+		
+		inPattern[column] = true;
+		pattern.push_back(column);
+		
+		if (ranks[column] >= 0)
+			queue.push(ranks[column]);
+	};
+	
+	for (auto i = Index(0); i < HexBasicSparseMatrix::numberOfRows and static_cast<Index>(pivots.size()) < maximumRank; ++i)
+	{
+		for (auto index = HexBasicSparseMatrix::rowOffsets[i]; index < HexBasicSparseMatrix::rowOffsets[i + 1]; ++index)
+		{
+			x[HexBasicSparseMatrix::pairs[index].column] = static_cast<Accumulator>(HexBasicSparseMatrix::pairs[index].value);
+			addToPattern(HexBasicSparseMatrix::pairs[index].column);
+		}
+		
+		while (not queue.empty())
+		{
+			const auto pivot = pivots[queue.top()];
+			queue.pop();
+			
+			const auto b = x[pivot];
+			
+			if (b == Accumulator())
+				continue;
+			
+			// [c s; -conj(s) c] is unitary and zeroes x(pivot) against R(pivot, pivot).
+			auto& rowOfR = rowsOfR[pivot];
+			const auto a = rowOfR.front().value;
+			const auto magnitudeOfA = qSqrt(HexScalarTraits<Accumulator>::SquaredMagnitude(a));
+			const auto rho = qSqrt(HexScalarTraits<Accumulator>::SquaredMagnitude(a) + HexScalarTraits<Accumulator>::SquaredMagnitude(b));
+			const auto c = magnitudeOfA/rho;
+			const auto s = a/magnitudeOfA*HexScalarTraits<Accumulator>::Conjugate(b)/rho;
+			const auto conjugatedS = HexScalarTraits<Accumulator>::Conjugate(s);
+			const auto sizeOfPattern = pattern.size();
+			
+			++numberOfRotations;
+			
+			for (auto& pr : rowOfR)
+			{
+				const auto r = pr.value;
+				
+				addToPattern(pr.column);
+				rotated[pr.column] = numberOfRotations;
+				pr.value = c*r + s*x[pr.column];
+				x[pr.column] = c*x[pr.column] - conjugatedS*r;
+			}
+			
+			for (auto index = std::size_t(0); index < sizeOfPattern; ++index)
+			{
+				const auto column = pattern[index];
+				
+				if (rotated[column] != numberOfRotations and x[column] != Accumulator())
+				{
+					rowOfR.emplace_back(s*x[column], column);
+					x[column] *= c;
+				}
+			}
+			
+			x[pivot] = Accumulator();
+		}
+		
+		auto squaredNorm = AccumulatorReal();
+		auto largestSquaredMagnitude = AccumulatorReal();
+		
+		for (const auto& column : pattern)
+		{
+			const auto squaredMagnitude = HexScalarTraits<Accumulator>::SquaredMagnitude(x[column]);
+			
+			squaredNorm += squaredMagnitude;
+			largestSquaredMagnitude = qMax(largestSquaredMagnitude, squaredMagnitude);
+		}
+		
+		if (qSqrt(squaredNorm) > threshold) // Independent from the previous rows, x becomes a row of R.
+		{
+			const auto minimumSquaredMagnitude = HexBasicSparseMatrix::RankPivotThreshold*HexBasicSparseMatrix::RankPivotThreshold*largestSquaredMagnitude;
+			auto pivot = Index(-1);
+			
+			for (const auto& column : pattern)
+			{
+				if (HexScalarTraits<Accumulator>::SquaredMagnitude(x[column]) >= minimumSquaredMagnitude and (pivot < 0 or positions[column] < positions[pivot]))
+					pivot = column;
+			}
+			
+			auto& rowOfR = rowsOfR[pivot];
+			
+			rowOfR.emplace_back(x[pivot], pivot);
+			
+			for (const auto& column : pattern)
+			{
+				if (column != pivot and x[column] != Accumulator())
+					rowOfR.emplace_back(x[column], column);
+			}
+			
+			ranks[pivot] = static_cast<Index>(pivots.size());
+			pivots.push_back(pivot);
+		}
+		
+		for (const auto& column : pattern)
+		{
+			x[column] = Accumulator();
+			inPattern[column] = false;
+		}
+		
+		pattern.clear();
+	}
+	
+	return static_cast<Index>(pivots.size());
+}
+
+template<typename Value, typename Index, typename Layout>
+const std::vector<Index>& HexBasicSparseMatrix<Value, Index, Layout>::getRowOffsets(void) const
+{
+	return HexBasicSparseMatrix::rowOffsets;
+}
+
+template<typename Value, typename Index, typename Layout>
+qreal HexBasicSparseMatrix<Value, Index, Layout>::getSparsity(void) const
+{
+	return 1. - HexBasicSparseMatrix::getDensity();
+}
+
+template<typename Value, typename Index, typename Layout>
+bool HexBasicSparseMatrix<Value, Index, Layout>::insertColumnValuePair(Index firstPossibleIndex, Index lastPossibleIndex, Index column, Value value)
+{
+	const auto end = HexBasicSparseMatrix::pairs.begin() + lastPossibleIndex - 1;
+	auto it = HexBasicSparseMatrix::pairs.begin() + firstPossibleIndex;
+	
+	while (it != end and it->column > column)
+		--it;
+	
+	if (it == end or it->column != column)
+	{
+		HexBasicSparseMatrix::pairs.emplace(it + 1u, value, column);
+		return true;
+	}
+	
+	it->value = value;
+	return false;
+}
+
+template<typename Value, typename Index, typename Layout>
+Index HexBasicSparseMatrix<Value, Index, Layout>::indexOfFreeCell(Index row, Index column) const
+{
+	const auto startIndex = HexBasicSparseMatrix::rowOffsets[row];
+	const auto stopIndex = HexBasicSparseMatrix::rowOffsets[row + 1];
+	
+	if (stopIndex - startIndex == HexBasicSparseMatrix::numberOfColumns)
+		return -1;
+	
+	if (startIndex == stopIndex)
+		return startIndex;
+	
+	const auto end = HexBasicSparseMatrix::pairs.cbegin() + stopIndex;
+	auto index = startIndex;
+	
+	for (auto it = HexBasicSparseMatrix::pairs.cbegin() + startIndex; it != end; ++it)
+	{
+		if (it->column >= column)
+			return (it->column == column ? -1 : index);
+		
+		++index;
+	}
+	
+	return index;
+}
+
+template<typename Value, typename Index, typename Layout>
+bool HexBasicSparseMatrix<Value, Index, Layout>::insertOne(HexRandomGenerator& generator)
+{
+	const auto numberOfCells = static_cast<qint64>(HexBasicSparseMatrix::numberOfRows)*static_cast<qint64>(HexBasicSparseMatrix::numberOfColumns); // This product overflows 32 bits long before the matrix gets large.
+	const auto numberOfElements = static_cast<qint64>(HexBasicSparseMatrix::pairs.size());
+	
+	if (numberOfElements >= numberOfCells)
+		return false;
+	
+	++HexBasicSparseMatrix::version;
+	
+	auto cell = generator.getNumberWithinRange(numberOfCells);
+	auto column = static_cast<Index>(cell % HexBasicSparseMatrix::numberOfColumns);
+	auto row = static_cast<Index>(cell/HexBasicSparseMatrix::numberOfColumns);
+	
+	if (numberOfElements < 1)
+		HexBasicSparseMatrix::pairs.emplace_back(Value(1), column);
+	else // Very unoptimised for large, dense matrices, but then this project is all about sparse matrices...
+	{
+		auto index = HexBasicSparseMatrix::indexOfFreeCell(row, column);
+		
+		while (index < 0)
+		{
+			cell = generator.getNumberWithinRange(numberOfCells);
+			column = static_cast<Index>(cell % HexBasicSparseMatrix::numberOfColumns);
+			row = static_cast<Index>(cell/HexBasicSparseMatrix::numberOfColumns);
+			
+			index = HexBasicSparseMatrix::indexOfFreeCell(row, column);
+		}
+		
+		const auto it = HexBasicSparseMatrix::pairs.begin() + index;
+		HexBasicSparseMatrix::pairs.emplace(it, Value(1), column);
+	}
+	
+	for (auto r = row + 1; r <= HexBasicSparseMatrix::numberOfRows; ++r)
+		++HexBasicSparseMatrix::rowOffsets[r];
+	
+	return true;
+}
+
+/* For a one-off solve. To solve against the same matrix again, keep
+ * getDecomposition(method) and call its solve, which skips the factorization.
+ * Householder is the default here, as its R stays far sparser than the
+ * Q and R of Gram-Schmidt.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::leastSquares(const std::vector<Value>& b, std::vector<Value>& x, HexQrMethod method) const
+{
+	HexBasicSparseMatrix::getDecomposition(method).solve(b, x);
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::leastSquares(const std::vector<Value>& b, qint32 numberOfVectors, std::vector<Value>& x, HexQrMethod method) const
+{
+	HexBasicSparseMatrix::getDecomposition(method).solve(b, numberOfVectors, x);
+}
+
+/* This is Gustavson's algorithm: row i of the product is the sum of the
+ * rows of matrix2 picked by the non-zero values of row i of matrix1. Every
+ * row is first counted, then computed, so that the product is allocated
+ * once with its exact size. Rows that require many multiplications compared
+ * to the number of columns of matrix2 use a dense accumulator, the others
+ * use a small hash table which stays in cache. Columns of matrix1 beyond the
+ * last row of matrix2 simply meet zeroes, like everywhere else in this class.
+ */
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout> HexBasicSparseMatrix<Value, Index, Layout>::Multiply(const HexBasicSparseMatrix& matrix1, const HexBasicSparseMatrix& matrix2, std::pmr::memory_resource* resource)
+{
+	auto product = HexBasicSparseMatrix();
+	product.numberOfRows = matrix1.numberOfRows;
+	product.numberOfColumns = matrix2.numberOfColumns;
+	product.rowOffsets.assign(product.numberOfRows + 1, 0);
+	
+	if (matrix1.pairs.empty() or matrix2.pairs.empty())
+		return product;
+	
+	auto rowFlops = std::pmr::vector<qint64>(matrix1.numberOfRows + 1, 0, resource);
+	
+	for (auto row = Index(0); row < matrix1.numberOfRows; ++row)
+	{
+		auto flops = rowFlops[row];
+		
+		for (auto index = matrix1.rowOffsets[row]; index < matrix1.rowOffsets[row + 1]; ++index)
+		{
+			const auto column = matrix1.pairs[index].column;
+			
+			if (column < matrix2.numberOfRows)
+				flops += matrix2.rowOffsets[column + 1] - matrix2.rowOffsets[column];
+		}
+		
+		rowFlops[row + 1] = flops;
+	}
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(rowFlops.back());
+	const auto boundaries = HexParallel::PartitionOffsets(rowFlops, numberOfThreads);
+	
+	auto denseMarkers = std::pmr::vector<std::pmr::vector<qint64>>(numberOfThreads, resource);
+	auto denseValues = std::pmr::vector<std::pmr::vector<Accumulator>>(numberOfThreads, resource);
+	auto hashColumns = std::pmr::vector<std::pmr::vector<Index>>(numberOfThreads, resource);
+	auto hashValues = std::pmr::vector<std::pmr::vector<Accumulator>>(numberOfThreads, resource);
+	auto touched = std::pmr::vector<std::pmr::vector<Index>>(numberOfThreads, resource);
+	auto numbersOfZeroes = std::vector<qint64>(numberOfThreads, 0);
+	
+	const auto accumulate = [&](qint32 thread, Index row, bool computeValues) -> Index // Returns the number of non-zero values of this row of the product.
+	{
+		const auto flops = rowFlops[row + 1] - rowFlops[row];
+		
+		if (flops == 0)
+			return 0;
+		
+		auto& columns = touched[thread];
+		columns.clear();
+		
+		if (flops*HexBasicSparseMatrix::DenseAccumulatorRatio >= matrix2.numberOfColumns)
+		{
+			auto& markers = denseMarkers[thread];
+			auto& values = denseValues[thread];
+			
+			if (markers.empty())
+			{
+				markers.assign(matrix2.numberOfColumns, -1);
+				values.assign(matrix2.numberOfColumns, Accumulator());
+			}
+			
+			const auto stamp = 2*static_cast<qint64>(row) + (computeValues ? 1 : 0); // Both passes visit the same row, so they need different stamps.
+			
+			for (auto index1 = matrix1.rowOffsets[row]; index1 < matrix1.rowOffsets[row + 1]; ++index1)
+			{
+				const auto& pr1 = matrix1.pairs[index1];
+				
+				if (pr1.column >= matrix2.numberOfRows)
+					continue;
+				
+				for (auto index2 = matrix2.rowOffsets[pr1.column]; index2 < matrix2.rowOffsets[pr1.column + 1]; ++index2)
+				{
+					const auto& pr2 = matrix2.pairs[index2];
+					
+					if (markers[pr2.column] != stamp)
+					{
+						markers[pr2.column] = stamp;
+						values[pr2.column] = static_cast<Accumulator>(pr1.value)*static_cast<Accumulator>(pr2.value);
+						columns.push_back(pr2.column);
+					}
+					else
+						values[pr2.column] += static_cast<Accumulator>(pr1.value)*static_cast<Accumulator>(pr2.value);
+				}
+			}
+			
+			if (not computeValues)
+				return static_cast<Index>(columns.size());
+			
+			std::sort(columns.begin(), columns.end());
+			auto it = product.pairs.begin() + product.rowOffsets[row];
+			
+			for (const auto& column : columns)
+			{
+				*it = ColumnValuePair(static_cast<Value>(values[column]), column);
+				numbersOfZeroes[thread] += (it->value == Value() ? 1 : 0); // Values that cancelled out, or that are too small for Value.
+				++it;
+			}
+			
+			return static_cast<Index>(columns.size());
+		}
+		
+		const auto tableSize = std::bit_ceil(static_cast<quint64>(2*flops));
+		const auto mask = tableSize - 1u;
+		
+		auto& keys = hashColumns[thread];
+		auto& values = hashValues[thread];
+		
+		keys.assign(tableSize, -1);
+		values.assign(tableSize, Accumulator());
+		
+		for (auto index1 = matrix1.rowOffsets[row]; index1 < matrix1.rowOffsets[row + 1]; ++index1)
+		{
+			const auto& pr1 = matrix1.pairs[index1];
+			
+			if (pr1.column >= matrix2.numberOfRows)
+				continue;
+			
+			for (auto index2 = matrix2.rowOffsets[pr1.column]; index2 < matrix2.rowOffsets[pr1.column + 1]; ++index2)
+			{
+				const auto& pr2 = matrix2.pairs[index2];
+				auto slot = (static_cast<quint64>(pr2.column)*0x9E3779B1u) & mask;
+				
+				while (keys[slot] != -1 and keys[slot] != pr2.column)
+					slot = (slot + 1u) & mask;
+				
+				if (keys[slot] == -1)
+				{
+					keys[slot] = pr2.column;
+					columns.push_back(static_cast<Index>(slot));
+				}
+				
+				values[slot] += static_cast<Accumulator>(pr1.value)*static_cast<Accumulator>(pr2.value);
+			}
+		}
+		
+		if (not computeValues)
+			return static_cast<Index>(columns.size());
+		
+		std::sort(columns.begin(), columns.end(), [&keys](Index slot1, Index slot2) { return keys[slot1] < keys[slot2]; });
+		auto it = product.pairs.begin() + product.rowOffsets[row];
+		
+		for (const auto& slot : columns)
+		{
+			*it = ColumnValuePair(static_cast<Value>(values[slot]), keys[slot]);
+			numbersOfZeroes[thread] += (it->value == Value() ? 1 : 0);
+			++it;
+		}
+		
+		return static_cast<Index>(columns.size());
+	};
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+			product.rowOffsets[row + 1] = accumulate(thread, row, false);
+	});
+	
+	for (auto row = Index(0); row < product.numberOfRows; ++row)
+		product.rowOffsets[row + 1] += product.rowOffsets[row];
+	
+	product.pairs.resize(product.rowOffsets.back());
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+			accumulate(thread, row, true);
+	});
+	
+	if (std::all_of(numbersOfZeroes.cbegin(), numbersOfZeroes.cend(), [](qint64 zeroes) { return zeroes == 0; }))
+		return product;
+	
+	auto newIndex = Index(0); // Values that cancelled out are squeezed out in place, which never reallocates anything.
+	auto startIndex = Index(0);
+	
+	for (auto row = Index(0); row < product.numberOfRows; ++row)
+	{
+		const auto stopIndex = product.rowOffsets[row + 1];
+		
+		for (auto index = startIndex; index < stopIndex; ++index)
+		{
+			if (product.pairs[index].value != Value())
+			{
+				product.pairs[newIndex] = product.pairs[index];
+				++newIndex;
+			}
+		}
+		
+		startIndex = stopIndex;
+		product.rowOffsets[row + 1] = newIndex;
+	}
+	
+	product.pairs.resize(newIndex);
+	return product;
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiply(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBasicSparseMatrix::multiply(Value(1), x, Value(), y);
+}
+
+/* This computes y = alpha*A*x + beta*y. Rows are handed out so that each
+ * thread gets about the same number of non-zero values rather than the
+ * same number of rows, otherwise a handful of heavy rows would keep one
+ * core busy while the others are already done. Small matrices don't
+ * spawn any thread at all. Each row is summed in Accumulator precision
+ * and only rounded to Value when it is written to y.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiply(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBasicSparseMatrix::numberOfColumns))
+		return;
+	
+	y.resize(HexBasicSparseMatrix::numberOfRows, Value());
 	
-	if (it == end or it->column != column)
+	if (HexBasicSparseMatrix::pairs.empty())
 	{
-		HexSparseMatrix::pairs.emplace(it + 1u, value, column);
-		return true;
+		for (auto& val : y)
+			val = HexScalarTraits<Value>::ScaleOutput(beta, val);
+		
+		return;
 	}
 	
-	it->value = value;
-	return false;
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBasicSparseMatrix::pairs.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSparseMatrix::rowOffsets, numberOfThreads);
+	
+	const auto accumulatedAlpha = static_cast<Accumulator>(alpha);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			const auto stopIndex = HexBasicSparseMatrix::rowOffsets[row + 1];
+			auto sum = Accumulator();
+			
+			for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < stopIndex; ++index)
+			{
+				const auto& pr = HexBasicSparseMatrix::pairs[index];
+				sum += static_cast<Accumulator>(pr.value)*static_cast<Accumulator>(x[pr.column]);
+			}
+			
+			y[row] = HexScalarTraits<Value>::UpdateOutput(accumulatedAlpha*sum, beta, y[row]);
+		}
+	});
 }
 
-qint32 HexSparseMatrix::indexOfFreeCell(qint32 row, qint32 column) const
+/* This multiplies the matrix by a block of numberOfVectors vectors at once,
+ * where x is a row-major numberOfColumns × numberOfVectors dense matrix and y
+ * ends up as a row-major numberOfRows × numberOfVectors one. The block is
+ * processed in panels of 16, 8, 4, 2 and 1 columns, so that each non-zero
+ * value is loaded once per panel instead of once per vector.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiply(const std::vector<Value>& x, qint32 numberOfVectors, std::vector<Value>& y) const
 {
-	const auto startIndex = HexSparseMatrix::rowOffsets[row];
-	const auto stopIndex = HexSparseMatrix::rowOffsets[row + 1];
+	if (numberOfVectors < 1 or x.size() < static_cast<quint64>(HexBasicSparseMatrix::numberOfColumns)*static_cast<quint64>(numberOfVectors))
+		return;
 	
-	if (stopIndex - startIndex == HexSparseMatrix::numberOfColumns)
-		return -1;
+	y.assign(static_cast<quint64>(HexBasicSparseMatrix::numberOfRows)*static_cast<quint64>(numberOfVectors), Value());
 	
-	if (startIndex == stopIndex)
-		return startIndex;
+	if (HexBasicSparseMatrix::pairs.empty())
+		return;
 	
-	const auto end = HexSparseMatrix::pairs.cbegin() + stopIndex;
-	auto index = startIndex;
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBasicSparseMatrix::pairs.size())*numberOfVectors);
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSparseMatrix::rowOffsets, numberOfThreads);
 	
-	for (auto it = HexSparseMatrix::pairs.cbegin() + startIndex; it != end; ++it)
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
 	{
-		if (it->column >= column)
-			return (it->column == column ? -1 : index);
+		const auto firstRow = boundaries[thread];
+		const auto lastRow = boundaries[thread + 1];
+		auto firstVector = 0;
 		
-		++index;
-	}
-	
-	return index;
+		while (firstVector < numberOfVectors)
+		{
+			const auto remainingVectors = numberOfVectors - firstVector;
+			const auto xPanel = x.data() + firstVector;
+			const auto yPanel = y.data() + firstVector;
+			
+			if (remainingVectors >= 16)
+				HexBasicSparseMatrix::multiplyPanel<16>(firstRow, lastRow, xPanel, yPanel, numberOfVectors);
+			else if (remainingVectors >= 8)
+				HexBasicSparseMatrix::multiplyPanel<8>(firstRow, lastRow, xPanel, yPanel, numberOfVectors);
+			else if (remainingVectors >= 4)
+				HexBasicSparseMatrix::multiplyPanel<4>(firstRow, lastRow, xPanel, yPanel, numberOfVectors);
+			else if (remainingVectors >= 2)
+				HexBasicSparseMatrix::multiplyPanel<2>(firstRow, lastRow, xPanel, yPanel, numberOfVectors);
+			else
+				HexBasicSparseMatrix::multiplyPanel<1>(firstRow, lastRow, xPanel, yPanel, numberOfVectors);
+			
+			firstVector += (remainingVectors >= 16 ? 16 : std::bit_floor(static_cast<quint32>(remainingVectors)));
+		}
+	});
 }
 
-bool HexSparseMatrix::insertOne(HexRandomGenerator& generator)
+/* The width is known at compile time, so the accumulators stay in
+ * registers and the inner loop over the panel gets fully unrolled
+ * and vectorised by the compiler.
+ */
+template<typename Value, typename Index, typename Layout>
+template<qint32 Width>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiplyPanel(Index firstRow, Index lastRow, const Value* x, Value* y, qint32 stride) const
 {
-	const auto numberOfCells = HexSparseMatrix::numberOfRows*HexSparseMatrix::numberOfColumns;
-	const auto numberOfElements = static_cast<qint32>(HexSparseMatrix::pairs.size());
-	
-	if (numberOfElements >= numberOfCells)
-		return false;
-	
-	auto cell = generator.getNumberWithinRange(numberOfCells);
-	auto column = cell % HexSparseMatrix::numberOfColumns;
-	auto row = cell/HexSparseMatrix::numberOfColumns;
-	
-	if (numberOfElements < 1)
-		HexSparseMatrix::pairs.emplace_back(1., column);
-	else // Very unoptimised for large, dense matrices, but then this project is all about sparse matrices...
+	for (auto row = firstRow; row < lastRow; ++row)
 	{
-		auto index = HexSparseMatrix::indexOfFreeCell(row, column);
+		const auto stopIndex = HexBasicSparseMatrix::rowOffsets[row + 1];
+		auto sums = std::array<Accumulator, Width>();
 		
-		while (index < 0)
+		for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < stopIndex; ++index)
 		{
-			cell = generator.getNumberWithinRange(numberOfCells);
-			column = cell % HexSparseMatrix::numberOfColumns;
-			row = cell/HexSparseMatrix::numberOfColumns;
+			const auto& pr = HexBasicSparseMatrix::pairs[index];
+			const auto value = static_cast<Accumulator>(pr.value);
+			const auto xRow = x + static_cast<qint64>(pr.column)*stride;
 			
-			index = HexSparseMatrix::indexOfFreeCell(row, column);
+			for (auto k = 0; k < Width; ++k)
+				sums[k] += value*static_cast<Accumulator>(xRow[k]);
 		}
 		
-		const auto it = HexSparseMatrix::pairs.begin() + index;
-		HexSparseMatrix::pairs.emplace(it, 1., column);
+		const auto yRow = y + static_cast<qint64>(row)*stride;
+		
+		for (auto k = 0; k < Width; ++k)
+			yRow[k] = static_cast<Value>(sums[k]);
 	}
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiplyTransposed(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBasicSparseMatrix::multiplyTransposed(Value(1), x, Value(), y);
+}
+
+/* This computes y = alpha*transpose(A)*x + beta*y straight from the CSR
+ * arrays, so there is no need to pay for transposed() and its copy of the
+ * whole matrix. Each row scatters into y, which means two threads may hit
+ * the same column: when y is small compared to the number of non-zero
+ * values, every thread gets its own private copy of y and these are summed
+ * at the end, otherwise the private copies would cost more memory than the
+ * matrix itself and we fall back on atomic additions.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::multiplyTransposed(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBasicSparseMatrix::numberOfRows))
+		return;
 	
-	for (auto r = row + 1; r <= HexSparseMatrix::numberOfRows; ++r)
-		++HexSparseMatrix::rowOffsets[r];
+	if (const auto view = HexBasicSparseMatrix::columnView.getIfCurrent(HexBasicSparseMatrix::version)) // Gathering from the column view beats scattering, but isn't worth building it for.
+		return view->multiply(alpha, x, beta, y);
 	
-	return true;
+	y.resize(HexBasicSparseMatrix::numberOfColumns, Value());
+	
+	for (auto& val : y)
+		val = HexScalarTraits<Value>::ScaleOutput(beta, val);
+	
+	if (HexBasicSparseMatrix::pairs.empty())
+		return;
+	
+	if constexpr (std::is_same_v<Accumulator, Value>)
+		HexBasicSparseMatrix::accumulateTransposed(alpha, x, y);
+	else // Sums are taken in Accumulator precision, so y gets widened for the time of the product.
+	{
+		auto accumulatedY = std::vector<Accumulator>(y.cbegin(), y.cend());
+		HexBasicSparseMatrix::accumulateTransposed(alpha, x, accumulatedY);
+		
+		std::transform(accumulatedY.cbegin(), accumulatedY.cend(), y.begin(), [](Accumulator val) { return static_cast<Value>(val); });
+	}
 }
 
 /* Vectors with very short norms are considered null to avoid
  * numerical instability. I guess 0.001 is still too high though.
  */
-qreal HexSparseMatrix::Normalise(std::vector<HexColumnValuePair>& vect)
+template<typename Value, typename Index, typename Layout>
+typename HexBasicSparseMatrix<Value, Index, Layout>::AccumulatorReal HexBasicSparseMatrix<Value, Index, Layout>::Normalise(std::pmr::vector<AccumulatorPair>& vect)
 {
-	auto norm = 0.;
+	auto norm = AccumulatorReal();
 	
 	for (const auto& pr : vect)
-		norm += pr.value*pr.value;
+		norm += HexScalarTraits<Accumulator>::SquaredMagnitude(pr.value);
 	
 	norm = qSqrt(norm);
 	
 	if (norm < 0.001)
-		return 0.;
+		return AccumulatorReal();
 	
 	for (auto& pr : vect)
 		pr.value /= norm;
@@ -485,20 +2170,67 @@ qreal HexSparseMatrix::Normalise(std::vector<HexColumnValuePair>& vect)
 	return norm;
 }
 
-void HexSparseMatrix::removeValue(qint32 row, qint32 column)
+/* Row k of the result is row rowPermutation[k] of this matrix, and
+ * column k is column columnPermutation[k], the way orderings are returned
+ * by HexOrdering. An empty permutation leaves rows, or columns, where they
+ * are. Nothing is changed, and false is returned, unless both are either
+ * empty or permutations of all the rows, or columns.
+ */
+template<typename Value, typename Index, typename Layout>
+bool HexBasicSparseMatrix<Value, Index, Layout>::permute(const std::vector<Index>& rowPermutation, const std::vector<Index>& columnPermutation)
+{
+	auto newPairs = Container();
+	auto newRowOffsets = std::vector<Index>();
+	
+	if (not HexBasicSparseMatrix::writePermuted(newPairs, newRowOffsets, rowPermutation, columnPermutation))
+		return false;
+	
+	HexBasicSparseMatrix::pairs.swap(newPairs);
+	HexBasicSparseMatrix::rowOffsets.swap(newRowOffsets);
+	++HexBasicSparseMatrix::version;
+	
+	return true;
+}
+
+/* Same as permute, on a copy. Invalid permutations give back an unchanged
+ * copy of this matrix.
+ */
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout> HexBasicSparseMatrix<Value, Index, Layout>::permuted(const std::vector<Index>& rowPermutation, const std::vector<Index>& columnPermutation) const
+{
+	auto permuted = HexBasicSparseMatrix();
+	
+	if (not HexBasicSparseMatrix::writePermuted(permuted.pairs, permuted.rowOffsets, rowPermutation, columnPermutation))
+		return HexBasicSparseMatrix(Container(HexBasicSparseMatrix::pairs), std::vector<Index>(HexBasicSparseMatrix::rowOffsets), HexBasicSparseMatrix::numberOfColumns);
+	
+	permuted.numberOfColumns = HexBasicSparseMatrix::numberOfColumns;
+	permuted.numberOfRows = HexBasicSparseMatrix::numberOfRows;
+	
+	return permuted;
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::releaseColumnView(void) const
 {
-	if (row >= HexSparseMatrix::numberOfRows or column >= HexSparseMatrix::numberOfColumns)
+	HexBasicSparseMatrix::columnView.release();
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::removeValue(Index row, Index column)
+{
+	if (row >= HexBasicSparseMatrix::numberOfRows or column >= HexBasicSparseMatrix::numberOfColumns)
 		return;
 	
-	const auto startIndex = HexSparseMatrix::rowOffsets[row];
-	const auto stopIndex = HexSparseMatrix::rowOffsets[row + 1];
+	const auto startIndex = HexBasicSparseMatrix::rowOffsets[row];
+	const auto stopIndex = HexBasicSparseMatrix::rowOffsets[row + 1];
 	
 	if (startIndex == stopIndex)
 		return;
 	
-	const auto iteratorToNextRow = HexSparseMatrix::pairs.begin() + stopIndex;
+	const auto iteratorToNextRow = HexBasicSparseMatrix::pairs.begin() + stopIndex;
+	auto valueWasRemoved = false;
 	
-	for (auto it = HexSparseMatrix::pairs.begin() + startIndex; it != iteratorToNextRow; ++it)
+	for (auto it = HexBasicSparseMatrix::pairs.begin() + startIndex; it != iteratorToNextRow; ++it)
 	{
 		if (it->column < column)
 			continue;
@@ -506,16 +2238,21 @@ void HexSparseMatrix::removeValue(qint32 row, qint32 column)
 		if (it->column > column) // It is now clear that there is no value to remove
 			return;
 		
-		HexSparseMatrix::pairs.erase(it);
+		HexBasicSparseMatrix::pairs.erase(it);
+		valueWasRemoved = true;
 		break;
 	}
 	
-	for (auto r = row + 1; r <= HexSparseMatrix::numberOfRows; ++r)
-		--HexSparseMatrix::rowOffsets[r];
+	if (not valueWasRemoved) // Every column of the row was lower, so there was no value to remove either.
+		return;
+	
+	for (auto r = row + 1; r <= HexBasicSparseMatrix::numberOfRows; ++r)
+		--HexBasicSparseMatrix::rowOffsets[r];
 }
 
+template<typename Value, typename Index, typename Layout>
 template<typename Type1, typename Type2>
-void HexSparseMatrix::Rewrite(Type1& it, Type2 beg, Type2 end)
+void HexBasicSparseMatrix<Value, Index, Layout>::Rewrite(Type1& it, Type2 beg, Type2 end)
 {
 	for (auto itt = beg; itt != end; ++itt)
 	{
@@ -524,77 +2261,59 @@ void HexSparseMatrix::Rewrite(Type1& it, Type2 beg, Type2 end)
 	}
 }
 
-template<typename Type1, typename Type2>
-qreal HexSparseMatrix::Scalar(Type1 beg1, Type1 end1, Type2 beg2, Type2 end2)
-{
-	if (beg1 == end1 or beg2 == end2) // If either row is full of zeroes
-		return 0.;
-	
-	auto cit2 = beg2;
-	auto result = 0.;
-	
-	for (auto cit1 = beg1; cit1 != end1; ++cit1)
-	{
-		while (cit2 != end2 and cit2->column < cit1->column)
-			++cit2;
-		
-		if (cit2 == end2)
-			break;
-		
-		if (cit2->column == cit1->column)
-			result += cit1->value*cit2->value;
-	}
-	
-	return result;
-}
-
-void HexSparseMatrix::setValue(qint32 row, qint32 column, qreal value)
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::setValue(Index row, Index column, Value value)
 {
 	if (row < 0 or column < 0)
 		return;
 	
-	if (value != 0.)
-		return HexSparseMatrix::addValue(row, column, value);
+	++HexBasicSparseMatrix::version;
+	
+	if (value != Value())
+		return HexBasicSparseMatrix::addValue(row, column, value);
 	
-	HexSparseMatrix::removeValue(row, column);
+	HexBasicSparseMatrix::removeValue(row, column);
 }
 
-bool HexSparseMatrix::shuffle(HexRandomGenerator& generator)
+template<typename Value, typename Index, typename Layout>
+bool HexBasicSparseMatrix<Value, Index, Layout>::shuffle(HexRandomGenerator& generator)
 {
-	const auto numberOfElements = HexSparseMatrix::pairs.size();
+	const auto numberOfElements = HexBasicSparseMatrix::pairs.size();
 	
 	if (numberOfElements < 1u)
 		return false;
 	
-	auto newRowOffsets = std::vector<qint32>(HexSparseMatrix::numberOfRows + 1, 0);
-	auto rowCounts = std::vector<qint32>(HexSparseMatrix::numberOfRows, 0);
+	++HexBasicSparseMatrix::version;
 	
-	for (auto i = 0u; i < numberOfElements; ++i)
+	auto newRowOffsets = std::vector<Index>(HexBasicSparseMatrix::numberOfRows + 1, 0);
+	auto rowCounts = std::vector<Index>(HexBasicSparseMatrix::numberOfRows, 0);
+	
+	for (auto i = std::size_t(0); i < numberOfElements; ++i)
 	{
-		auto row = generator.getNumberWithinRange(HexSparseMatrix::numberOfRows);
+		auto row = generator.getNumberWithinRange(HexBasicSparseMatrix::numberOfRows);
 		
-		while (rowCounts[row] >= HexSparseMatrix::numberOfColumns)
-			row = generator.getNumberWithinRange(HexSparseMatrix::numberOfRows);
+		while (rowCounts[row] >= HexBasicSparseMatrix::numberOfColumns)
+			row = generator.getNumberWithinRange(HexBasicSparseMatrix::numberOfRows);
 		
 		++rowCounts[row];
 	}
 	
-	for (auto row = 1; row <= HexSparseMatrix::numberOfRows; ++row)
+	for (auto row = Index(1); row <= HexBasicSparseMatrix::numberOfRows; ++row)
 		newRowOffsets[row] = newRowOffsets[row - 1] + rowCounts[row - 1];
 	
-	HexSparseMatrix::rowOffsets.swap(newRowOffsets);
-	generator.shuffle(HexSparseMatrix::pairs);
+	HexBasicSparseMatrix::rowOffsets.swap(newRowOffsets);
+	generator.shuffle(HexBasicSparseMatrix::pairs);
 	
-	auto stopIndex = HexSparseMatrix::rowOffsets.cbegin() + 1u;
+	auto stopIndex = HexBasicSparseMatrix::rowOffsets.cbegin() + 1u;
 	
-	for (const auto& startIndex : HexSparseMatrix::rowOffsets)
+	for (const auto& startIndex : HexBasicSparseMatrix::rowOffsets)
 	{
 		const auto numberOfElementsInRow = (*stopIndex) - startIndex;
 		
 		if (numberOfElementsInRow >= 1)
 		{
-			const auto newColumns = generator.getNumbersWithinRange(numberOfElementsInRow, HexSparseMatrix::numberOfColumns);
-			auto it = HexSparseMatrix::pairs.begin() + startIndex;
+			const auto newColumns = generator.getNumbersWithinRange(numberOfElementsInRow, HexBasicSparseMatrix::numberOfColumns);
+			auto it = HexBasicSparseMatrix::pairs.begin() + startIndex;
 			
 			for (const auto& column : newColumns)
 			{
@@ -605,16 +2324,17 @@ bool HexSparseMatrix::shuffle(HexRandomGenerator& generator)
 		
 		++stopIndex;
 		
-		if (HexSparseMatrix::rowOffsets.cend() == stopIndex)
+		if (HexBasicSparseMatrix::rowOffsets.cend() == stopIndex)
 			break;
 	}
 	
 	return true;
 }
 
-void HexSparseMatrix::swapColumns(qint32 column1, qint32 column2)
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::swapColumns(Index column1, Index column2)
 {	
-	if (HexSparseMatrix::pairs.empty())
+	if (HexBasicSparseMatrix::pairs.empty())
 		return;
 	
 	if (column1 == column2)
@@ -623,73 +2343,115 @@ void HexSparseMatrix::swapColumns(qint32 column1, qint32 column2)
 	if (column1 < 0 or column2 < 0)
 		return;
 	
-	if (column1 >= HexSparseMatrix::numberOfColumns or column2 >= HexSparseMatrix::numberOfColumns)
+	if (column1 >= HexBasicSparseMatrix::numberOfColumns or column2 >= HexBasicSparseMatrix::numberOfColumns)
 		return;
 	
 	if (column1 > column2)
 		std::swap(column1, column2);
 	
-	auto stopIndex = HexSparseMatrix::rowOffsets.cbegin() + 1u;
-	
-	for (const auto& startIndex : HexSparseMatrix::rowOffsets) // We have to perform the swap row by row.
+	const auto swapInRow = [this, column1, column2](Index startIndex, Index stopIndex)
 	{
-		if (*stopIndex != startIndex)
+		auto cit = HexBasicSparseMatrix::pairs.cbegin() + startIndex;
+		
+		auto index1 = Index(-1);
+		auto index2 = Index(-1); 
+		
+		for (auto index = startIndex; index < stopIndex; ++index)
 		{
-			auto cit = HexSparseMatrix::pairs.cbegin() + startIndex;
+			if (cit->column == column1)
+				index1 = index;
 			
-			auto index1 = -1;
-			auto index2 = -1; 
+			if (cit->column == column2)
+				index2 = index;
 			
-			for (auto index = startIndex; index < *stopIndex; ++index)
-			{
-				if (cit->column == column1)
-					index1 = index;
-				
-				if (cit->column == column2)
-					index2 = index;
-				
-				++cit;
-			}
+			++cit;
+		}
+		
+		if (index1 >= 0 and index2 >= 0) // Both cells were non-zeroes. No std::swap here, packed values can't be bound to references.
+		{
+			const auto value = HexBasicSparseMatrix::pairs[index1].value;
 			
-			if (index1 >= 0 and index2 >= 0) // Both cells were non-zeroes.
-				std::swap(HexSparseMatrix::pairs[index1].value, HexSparseMatrix::pairs[index2].value);
-			else if (index1 >= 0) // One cell was non-zero but the other was zero.
-			{
-				const auto value = HexSparseMatrix::pairs[index1].value;
-					
-				while (index1 + 1 != *stopIndex and HexSparseMatrix::pairs[index1 + 1].column < column2)
-				{
-					HexSparseMatrix::pairs[index1] = HexSparseMatrix::pairs[index1 + 1];
-					++index1;
-				}
+			HexBasicSparseMatrix::pairs[index1].value = HexBasicSparseMatrix::pairs[index2].value;
+			HexBasicSparseMatrix::pairs[index2].value = value;
+		}
+		else if (index1 >= 0) // One cell was non-zero but the other was zero.
+		{
+			const auto value = HexBasicSparseMatrix::pairs[index1].value;
 				
-				HexSparseMatrix::pairs[index1] = HexColumnValuePair(value, column2);
+			while (index1 + 1 != stopIndex and HexBasicSparseMatrix::pairs[index1 + 1].column < column2)
+			{
+				HexBasicSparseMatrix::pairs[index1] = HexBasicSparseMatrix::pairs[index1 + 1];
+				++index1;
 			}
-			else if (index2 >= 0) // One cell was non-zero but the other was zero.
+			
+			HexBasicSparseMatrix::pairs[index1] = ColumnValuePair(value, column2);
+		}
+		else if (index2 >= 0) // One cell was non-zero but the other was zero.
+		{
+			const auto value = HexBasicSparseMatrix::pairs[index2].value;
+			
+			while (index2 != startIndex and HexBasicSparseMatrix::pairs[index2 - 1].column > column1)
 			{
-				const auto value = HexSparseMatrix::pairs[index2].value;
-				
-				while (index2 != startIndex and HexSparseMatrix::pairs[index2 - 1].column > column1)
-				{
-					HexSparseMatrix::pairs[index2] = HexSparseMatrix::pairs[index2 - 1];
-					--index2;
-				}
-				
-				HexSparseMatrix::pairs[index2] = HexColumnValuePair(value, column1);
+				HexBasicSparseMatrix::pairs[index2] = HexBasicSparseMatrix::pairs[index2 - 1];
+				--index2;
 			}
-			// Else: both cells are zeroes so there's nothing to swap here.
+			
+			HexBasicSparseMatrix::pairs[index2] = ColumnValuePair(value, column1);
 		}
+		// Else: both cells are zeroes so there's nothing to swap here.
+	};
+	
+	if (auto view = HexBasicSparseMatrix::columnView.getIfCurrent(HexBasicSparseMatrix::version)) // Rows of both columns are listed in the view, and these are the only rows to visit.
+	{
+		auto it1 = view->pairs.cbegin() + view->rowOffsets[column1];
+		auto it2 = view->pairs.cbegin() + view->rowOffsets[column2];
 		
-		++stopIndex;
+		const auto end1 = view->pairs.cbegin() + view->rowOffsets[column1 + 1];
+		const auto end2 = view->pairs.cbegin() + view->rowOffsets[column2 + 1];
 		
-		if (HexSparseMatrix::rowOffsets.cend() == stopIndex)
-			break;
+		while (it1 != end1 or it2 != end2) // Both lists are sorted, so they are merged like in a merge sort.
+		{
+			auto row = Index(0);
+			
+			if (it2 == end2 or (it1 != end1 and it1->column < it2->column))
+			{
+				row = it1->column;
+				++it1;
+			}
+			else if (it1 == end1 or it2->column < it1->column)
+			{
+				row = it2->column;
+				++it2;
+			}
+			else
+			{
+				row = it1->column;
+				++it1;
+				++it2;
+			}
+			
+			swapInRow(HexBasicSparseMatrix::rowOffsets[row], HexBasicSparseMatrix::rowOffsets[row + 1]);
+		}
+	}
+	else // We have to perform the swap row by row.
+	{
+		for (auto row = Index(0); row < HexBasicSparseMatrix::numberOfRows; ++row)
+		{
+			if (HexBasicSparseMatrix::rowOffsets[row] != HexBasicSparseMatrix::rowOffsets[row + 1])
+				swapInRow(HexBasicSparseMatrix::rowOffsets[row], HexBasicSparseMatrix::rowOffsets[row + 1]);
+		}
 	}
+	
+	const auto oldVersion = HexBasicSparseMatrix::version;
+	++HexBasicSparseMatrix::version;
+	
+	HexBasicSparseMatrix::columnView.update(oldVersion, HexBasicSparseMatrix::version, [column1, column2](HexBasicSparseMatrix& view) { view.swapRows(column1, column2); }); // Swapping columns here swaps rows in the view, which is cheaper than building it again.
 }
 
-void HexSparseMatrix::swapRows(qint32 row1, qint32 row2)
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::swapRows(Index row1, Index row2)
 {
-	if (HexSparseMatrix::pairs.empty())
+	if (HexBasicSparseMatrix::pairs.empty())
 		return;
 	
 	if (row1 == row2)
@@ -698,138 +2460,382 @@ void HexSparseMatrix::swapRows(qint32 row1, qint32 row2)
 	if (row1 < 0 or row2 < 0)
 		return;
 	
-	if (row1 >= HexSparseMatrix::numberOfRows or row2 >= HexSparseMatrix::numberOfRows)
+	if (row1 >= HexBasicSparseMatrix::numberOfRows or row2 >= HexBasicSparseMatrix::numberOfRows)
 		return;
 	
 	if (row1 > row2)
 		std::swap(row1, row2);
 	
-	const auto numberOfElementsInRow1 = HexSparseMatrix::rowOffsets[row1 + 1] - HexSparseMatrix::rowOffsets[row1];
-	const auto numberOfElementsInRow2 = HexSparseMatrix::rowOffsets[row2 + 1] - HexSparseMatrix::rowOffsets[row2];
+	const auto numberOfElementsInRow1 = HexBasicSparseMatrix::rowOffsets[row1 + 1] - HexBasicSparseMatrix::rowOffsets[row1];
+	const auto numberOfElementsInRow2 = HexBasicSparseMatrix::rowOffsets[row2 + 1] - HexBasicSparseMatrix::rowOffsets[row2];
 	
 	if (numberOfElementsInRow1 < 1 and numberOfElementsInRow2 < 1)
 		return;
 	
+	++HexBasicSparseMatrix::version;
+	
 	if (numberOfElementsInRow2 < numberOfElementsInRow1)
 	{
-		const auto beg1 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1];
-		const auto end1 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1 + 1];
+		const auto beg1 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1];
+		const auto end1 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1 + 1];
 		
-		const auto beg2 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2];
-		const auto end2 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2 + 1];
+		const auto beg2 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2];
+		const auto end2 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2 + 1];
 		
-		const auto values1 = std::vector<HexColumnValuePair>(beg1, end1);
-		auto it = HexSparseMatrix::pairs.begin() + HexSparseMatrix::rowOffsets[row1];
+		const auto values1 = std::vector<ColumnValuePair>(beg1, end1);
+		auto it = HexBasicSparseMatrix::pairs.begin() + HexBasicSparseMatrix::rowOffsets[row1];
 		
-		HexSparseMatrix::Rewrite(it, beg2, end2);
-		HexSparseMatrix::Rewrite(it, end1, beg2);
-		HexSparseMatrix::Rewrite(it, values1.cbegin(), values1.cend());
+		HexBasicSparseMatrix::Rewrite(it, beg2, end2);
+		HexBasicSparseMatrix::Rewrite(it, end1, beg2);
+		HexBasicSparseMatrix::Rewrite(it, values1.cbegin(), values1.cend());
 	}
 	else if (numberOfElementsInRow2 > numberOfElementsInRow1)
 	{
-		const auto beg1 = std::make_reverse_iterator(HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1 + 1]);
-		const auto end1 = std::make_reverse_iterator(HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1]);
+		const auto beg1 = std::make_reverse_iterator(HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1 + 1]);
+		const auto end1 = std::make_reverse_iterator(HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1]);
 		
-		const auto beg2 = std::make_reverse_iterator(HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2 + 1]);
-		const auto end2 = std::make_reverse_iterator(HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2]);
+		const auto beg2 = std::make_reverse_iterator(HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2 + 1]);
+		const auto end2 = std::make_reverse_iterator(HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2]);
 		
-		const auto values2 = std::vector<HexColumnValuePair>(beg2, end2);
-		auto it = std::make_reverse_iterator(HexSparseMatrix::pairs.begin() + HexSparseMatrix::rowOffsets[row2 + 1]);
+		const auto values2 = std::vector<ColumnValuePair>(beg2, end2);
+		auto it = std::make_reverse_iterator(HexBasicSparseMatrix::pairs.begin() + HexBasicSparseMatrix::rowOffsets[row2 + 1]);
 		
-		HexSparseMatrix::Rewrite(it, beg1, end1);
-		HexSparseMatrix::Rewrite(it, end2, beg1);
-		HexSparseMatrix::Rewrite(it, values2.cbegin(), values2.cend());
+		HexBasicSparseMatrix::Rewrite(it, beg1, end1);
+		HexBasicSparseMatrix::Rewrite(it, end2, beg1);
+		HexBasicSparseMatrix::Rewrite(it, values2.cbegin(), values2.cend());
 	}
 	else
 	{
-		const auto beg1 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1];
-		const auto end1 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row1 + 1];
+		const auto beg1 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1];
+		const auto end1 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row1 + 1];
 		
-		const auto beg2 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2];
-		const auto end2 = HexSparseMatrix::pairs.cbegin() + HexSparseMatrix::rowOffsets[row2 + 1];
+		const auto beg2 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2];
+		const auto end2 = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[row2 + 1];
 		
-		const auto values1 = std::vector<HexColumnValuePair>(beg1, end1);
-		auto it1 = HexSparseMatrix::pairs.begin() + HexSparseMatrix::rowOffsets[row1];
-		auto it2 = HexSparseMatrix::pairs.begin() + HexSparseMatrix::rowOffsets[row2];
+		const auto values1 = std::vector<ColumnValuePair>(beg1, end1);
+		auto it1 = HexBasicSparseMatrix::pairs.begin() + HexBasicSparseMatrix::rowOffsets[row1];
+		auto it2 = HexBasicSparseMatrix::pairs.begin() + HexBasicSparseMatrix::rowOffsets[row2];
 		
-		HexSparseMatrix::Rewrite(it1, beg2, end2);
-		HexSparseMatrix::Rewrite(it2, values1.cbegin(), values1.cend());
+		HexBasicSparseMatrix::Rewrite(it1, beg2, end2);
+		HexBasicSparseMatrix::Rewrite(it2, values1.cbegin(), values1.cend());
 	}
 	
 	const auto differenceOfElements = numberOfElementsInRow2 - numberOfElementsInRow1;
 	
 	for (auto row = row1 + 1; row <= row2; ++row) // There is no difference beyond row2 as the sum of past elements is unchanged.
-		HexSparseMatrix::rowOffsets[row] += differenceOfElements;
+		HexBasicSparseMatrix::rowOffsets[row] += differenceOfElements;
 }
 
-void HexSparseMatrix::transpose(void)
+/* The result is built next to this matrix and swapped in, so both are
+ * held at once while it is written.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::transpose(std::pmr::memory_resource* resource)
 {
-	auto newMatrix = HexSparseMatrix::transposed();
+	auto newMatrix = HexBasicSparseMatrix::transposed(resource);
 	
-	HexSparseMatrix::rowOffsets.swap(newMatrix.rowOffsets);
-	HexSparseMatrix::pairs.swap(newMatrix.pairs);
+	HexBasicSparseMatrix::rowOffsets.swap(newMatrix.rowOffsets);
+	HexBasicSparseMatrix::pairs.swap(newMatrix.pairs);
 	
-	std::swap(HexSparseMatrix::numberOfRows, HexSparseMatrix::numberOfColumns);
+	std::swap(HexBasicSparseMatrix::numberOfRows, HexBasicSparseMatrix::numberOfColumns);
+	++HexBasicSparseMatrix::version;
 }
 
-HexSparseMatrix HexSparseMatrix::transposed(void) const
+template<typename Value, typename Index, typename Layout>
+HexBasicSparseMatrix<Value, Index, Layout> HexBasicSparseMatrix<Value, Index, Layout>::transposed(std::pmr::memory_resource* resource) const
 {
-	auto rowCounts = std::vector<qint32>(HexSparseMatrix::numberOfColumns, 0);
+	auto transposed = HexBasicSparseMatrix();
+	HexBasicSparseMatrix::writeTransposed(transposed.pairs, transposed.rowOffsets, resource);
+	
+	transposed.numberOfColumns = HexBasicSparseMatrix::numberOfRows;
+	transposed.numberOfRows = HexBasicSparseMatrix::numberOfColumns;
 	
-	for (const auto& pr : HexSparseMatrix::pairs)
-		++rowCounts[pr.column];
+	return transposed;
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::updateNumberOfColumns(void)
+{
+	const auto highestColumn = HexBasicSparseMatrix::getHighestColumn();
+	HexBasicSparseMatrix::numberOfColumns = highestColumn + 1;
+}
+
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::updateNumberOfRows(void)
+{
+	const auto lastValue = HexBasicSparseMatrix::rowOffsets.back();
 	
-	auto transposed = HexSparseMatrix();
-	transposed.rowOffsets = std::vector<qint32>(HexSparseMatrix::numberOfColumns + 1, 0);
+	while (HexBasicSparseMatrix::rowOffsets.back() == lastValue)
+		HexBasicSparseMatrix::rowOffsets.pop_back();
 	
-	for (auto row = 1; row <= HexSparseMatrix::numberOfColumns; ++row)
-		transposed.rowOffsets[row] = transposed.rowOffsets[row - 1] + rowCounts[row - 1];
+	HexBasicSparseMatrix::numberOfRows = static_cast<Index>(HexBasicSparseMatrix::rowOffsets.size());
+	HexBasicSparseMatrix::rowOffsets.push_back(lastValue);
+}
+
+/* This writes the permuted matrix in a single pass over the new rows,
+ * split between threads by number of values. Every new row is the copy of
+ * an old one, with its columns renamed, and then sorted again, which for
+ * the handful of values most rows hold is done by insertion. Checking both
+ * permutations comes first, so that nothing is written when either is
+ * invalid.
+ */
+template<typename Value, typename Index, typename Layout>
+bool HexBasicSparseMatrix<Value, Index, Layout>::writePermuted(Container& newPairs, std::vector<Index>& newRowOffsets, const std::vector<Index>& rowPermutation, const std::vector<Index>& columnPermutation) const
+{
+	const auto numberOfRows = HexBasicSparseMatrix::numberOfRows;
+	const auto numberOfColumns = HexBasicSparseMatrix::numberOfColumns;
 	
-	transposed.pairs = std::vector<HexColumnValuePair>(HexSparseMatrix::pairs.size());
-	auto rowIndexes = transposed.rowOffsets;
+	if (not rowPermutation.empty() and static_cast<Index>(rowPermutation.size()) != numberOfRows)
+		return false;
 	
-	auto stopIndex = HexSparseMatrix::rowOffsets.cbegin() + 1u;
-	auto row = 0;
+	if (not columnPermutation.empty() and static_cast<Index>(columnPermutation.size()) != numberOfColumns)
+		return false;
 	
-	for (const auto& startIndex : HexSparseMatrix::rowOffsets)
 	{
-		for (auto oldIndex = startIndex; oldIndex < *stopIndex; ++oldIndex)
+		auto seen = std::vector<bool>(numberOfRows, false);
+		
+		for (const auto row : rowPermutation)
 		{
-			const auto& pr = HexSparseMatrix::pairs[oldIndex];
-			auto& newIndex = rowIndexes[pr.column];
+			if (row < 0 or row >= numberOfRows or seen[row])
+				return false;
 			
-			transposed.pairs[newIndex] = HexColumnValuePair(pr.value, row);
-			++newIndex; // We need to increment that reference so that, next time another element of the same column is found, it is located right next to the previous one in the vector.
+			seen[row] = true;
 		}
+	}
+	
+	auto columns = std::vector<Index>(columnPermutation.empty() ? 0 : numberOfColumns, -1); // New column of each old column
+	
+	for (auto column = Index(0); column < static_cast<Index>(columnPermutation.size()); ++column)
+	{
+		const auto oldColumn = columnPermutation[column];
 		
-		++row;
-		++stopIndex;
+		if (oldColumn < 0 or oldColumn >= numberOfColumns or columns[oldColumn] != -1)
+			return false;
 		
-		if (HexSparseMatrix::rowOffsets.cend() == stopIndex)
-			break;
+		columns[oldColumn] = column;
 	}
 	
-	transposed.numberOfColumns = HexSparseMatrix::numberOfRows;
-	transposed.numberOfRows = HexSparseMatrix::numberOfColumns;
+	const auto oldRow = [&rowPermutation](Index row) { return (rowPermutation.empty() ? row : rowPermutation[row]); };
 	
-	return transposed;
-}
-
-void HexSparseMatrix::updateNumberOfColumns(void)
-{
-	const auto highestColumn = HexSparseMatrix::getHighestColumn();
-	HexSparseMatrix::numberOfColumns = highestColumn + 1;
+	newRowOffsets.assign(numberOfRows + 1, 0);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+		newRowOffsets[row + 1] = newRowOffsets[row] + HexBasicSparseMatrix::rowOffsets[oldRow(row) + 1] - HexBasicSparseMatrix::rowOffsets[oldRow(row)];
+	
+	newPairs.resize(HexBasicSparseMatrix::pairs.size());
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(HexBasicSparseMatrix::pairs.size()));
+	const auto boundaries = HexParallel::PartitionOffsets(newRowOffsets, numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		auto rowPairs = std::vector<ColumnValuePair>();
+		
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			const auto beg = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[oldRow(row)];
+			const auto end = HexBasicSparseMatrix::pairs.cbegin() + HexBasicSparseMatrix::rowOffsets[oldRow(row) + 1];
+			
+			auto it = newPairs.begin() + newRowOffsets[row];
+			
+			if (columns.empty())
+			{
+				HexBasicSparseMatrix::Rewrite(it, beg, end);
+				continue;
+			}
+			
+			rowPairs.clear();
+			
+			for (auto itt = beg; itt != end; ++itt)
+				rowPairs.emplace_back(itt->value, columns[itt->column]);
+			
+			if (static_cast<qint64>(rowPairs.size()) > HexBasicSparseMatrix::MaximumInsertionSortLength)
+			{
+				std::sort(rowPairs.begin(), rowPairs.end(), [](const ColumnValuePair& pr1, const ColumnValuePair& pr2) { return pr1.column < pr2.column; });
+			}
+			else
+			{
+				for (auto position = std::size_t(1); position < rowPairs.size(); ++position)
+				{
+					const auto pr = rowPairs[position];
+					auto previous = position;
+					
+					for (; previous > 0u and rowPairs[previous - 1].column > pr.column; --previous)
+						rowPairs[previous] = rowPairs[previous - 1];
+					
+					rowPairs[previous] = pr;
+				}
+			}
+			
+			HexBasicSparseMatrix::Rewrite(it, rowPairs.cbegin(), rowPairs.cend());
+		}
+	});
+	
+	return true;
 }
 
-void HexSparseMatrix::updateNumberOfRows(void)
+/* Both transposes share this counting sort. Each thread counts the values
+ * of its own rows per column, and every column then gets one slice of the
+ * result per thread, in thread order, which keeps each column in row order
+ * without any locking. The catch is that the scatter writes to as many places
+ * at once as there are columns, and past a hundred thousand columns or so,
+ * every single write misses the cache. Wider matrices are thus sorted in two
+ * passes: the first one scatters the values into a few dozen blocks of
+ * columns, and the second one sorts every block by column on its own, with
+ * counters that fit in L2 and writes that stay within the block.
+ *
+ * newPairs and newRowOffsets must not be this matrix's own, as the values
+ * are read from pairs while they are written.
+ */
+template<typename Value, typename Index, typename Layout>
+void HexBasicSparseMatrix<Value, Index, Layout>::writeTransposed(Container& newPairs, std::vector<Index>& newRowOffsets, std::pmr::memory_resource* resource) const
 {
-	const auto lastValue = HexSparseMatrix::rowOffsets.back();
+	const auto numberOfValues = static_cast<Index>(HexBasicSparseMatrix::pairs.size());
+	const auto numberOfColumns = HexBasicSparseMatrix::numberOfColumns;
+	
+	if (numberOfValues < 1)
+	{
+		newPairs.clear();
+		newRowOffsets.assign(numberOfColumns + 1, 0);
+		return;
+	}
+	
+	auto shift = HexBasicSparseMatrix::MinimumTransposeBlockShift;
+	
+	while ((static_cast<qint64>(numberOfColumns) >> shift) >= HexBasicSparseMatrix::MaximumNumberOfTransposeBlocks)
+		++shift;
+	
+	const auto numberOfBlocks = (numberOfColumns >> shift) + 1;
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(static_cast<qint64>(numberOfValues));
+	const auto boundaries = HexParallel::PartitionOffsets(HexBasicSparseMatrix::rowOffsets, numberOfThreads);
+	
+	const auto scatter = [&](qint32 keyShift, Index numberOfKeys, auto write) // Every value goes to the slice of its thread in its key, the key being its column shifted right. Returns the offsets of the keys.
+	{
+		auto cursors = std::pmr::vector<std::pmr::vector<Index>>(numberOfThreads, resource);
+		auto keyOffsets = std::vector<Index>(numberOfKeys + 1, 0);
+		
+		const auto firstKey = [numberOfKeys, numberOfThreads](qint32 thread) { return static_cast<Index>(static_cast<qint64>(numberOfKeys)*thread/numberOfThreads); };
+		
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			auto& threadCursors = cursors[thread];
+			threadCursors.assign(numberOfKeys, 0);
+			
+			for (auto index = HexBasicSparseMatrix::rowOffsets[boundaries[thread]]; index < HexBasicSparseMatrix::rowOffsets[boundaries[thread + 1]]; ++index)
+				++threadCursors[HexBasicSparseMatrix::pairs[index].column >> keyShift];
+		});
+		
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			for (auto key = firstKey(thread); key < firstKey(thread + 1); ++key)
+			{
+				for (const auto& threadCursors : cursors)
+					keyOffsets[key + 1] += threadCursors[key];
+			}
+		});
+		
+		for (auto key = Index(0); key < numberOfKeys; ++key)
+			keyOffsets[key + 1] += keyOffsets[key];
+		
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			for (auto key = firstKey(thread); key < firstKey(thread + 1); ++key)
+			{
+				auto offset = keyOffsets[key];
+				
+				for (auto& threadCursors : cursors) // Counts become the positions where each thread starts writing.
+				{
+					const auto count = threadCursors[key];
+					
+					threadCursors[key] = offset;
+					offset += count;
+				}
+			}
+		});
+		
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			auto& threadCursors = cursors[thread];
+			
+			for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+			{
+				for (auto index = HexBasicSparseMatrix::rowOffsets[row]; index < HexBasicSparseMatrix::rowOffsets[row + 1]; ++index)
+				{
+					const auto& pr = HexBasicSparseMatrix::pairs[index];
+					auto& cursor = threadCursors[pr.column >> keyShift];
+					
+					write(cursor, pr, row);
+					++cursor;
+				}
+			}
+		});
+		
+		return keyOffsets;
+	};
+	
+	if (numberOfBlocks == 1)
+	{
+		newPairs.resize(numberOfValues);
+		newRowOffsets = scatter(0, numberOfColumns, [&newPairs](Index position, const auto& pr, Index row) { newPairs[position] = ColumnValuePair(pr.value, row); });
+		
+		return;
+	}
+	
+	auto columnsByBlock = std::pmr::vector<Index>(numberOfValues, resource);
+	
+	newPairs.resize(numberOfValues);
+	
+	const auto blockOffsets = scatter(shift, numberOfBlocks, [&newPairs, &columnsByBlock](Index position, const auto& pr, Index row)
+	{
+		newPairs[position] = ColumnValuePair(pr.value, row); // Columns of these pairs are rows, as in the result.
+		columnsByBlock[position] = pr.column;
+	});
+	
+	newRowOffsets.resize(numberOfColumns + 1);
+	newRowOffsets.back() = numberOfValues;
 	
-	while (HexSparseMatrix::rowOffsets.back() == lastValue)
-		HexSparseMatrix::rowOffsets.pop_back();
+	const auto blockWidth = Index(1) << shift;
+	const auto blockBoundaries = HexParallel::PartitionOffsets(blockOffsets, numberOfThreads);
 	
-	HexSparseMatrix::numberOfRows = static_cast<qint32>(HexSparseMatrix::rowOffsets.size());
-	HexSparseMatrix::rowOffsets.push_back(lastValue);
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		auto columnOffsets = std::pmr::vector<Index>(resource);
+		auto blockPairs = Container();
+		
+		for (auto block = blockBoundaries[thread]; block < blockBoundaries[thread + 1]; ++block)
+		{
+			const auto firstColumn = block << shift;
+			const auto width = qMin(blockWidth, numberOfColumns - firstColumn);
+			
+			const auto blockStart = blockOffsets[block];
+			const auto blockStop = blockOffsets[block + 1];
+			
+			columnOffsets.assign(width + 1, 0);
+			
+			for (auto index = blockStart; index < blockStop; ++index)
+				++columnOffsets[columnsByBlock[index] - firstColumn + 1];
+			
+			columnOffsets[0] = blockStart;
+			
+			for (auto column = Index(0); column < width; ++column)
+			{
+				columnOffsets[column + 1] += columnOffsets[column];
+				newRowOffsets[firstColumn + column] = columnOffsets[column];
+			}
+			
+			blockPairs.clear(); // The block is sorted where it lies, so it has to be moved out of the way first.
+			blockPairs.insert(blockPairs.end(), newPairs.cbegin() + blockStart, newPairs.cbegin() + blockStop);
+			
+			for (auto index = blockStart; index < blockStop; ++index)
+			{
+				const auto& pr = blockPairs[index - blockStart];
+				auto& newIndex = columnOffsets[columnsByBlock[index] - firstColumn];
+				
+				newPairs[newIndex] = ColumnValuePair(pr.value, pr.column);
+				++newIndex; // We need to increment that reference so that, next time another element of the same column is found, it is located right next to the previous one in the vector.
+			}
+		}
+	});
 }
 
 #endif
@@ -0,0 +1,300 @@
+#ifndef __HEX_SPARSE_MATRIX_BUILDER_HPP__
+#define __HEX_SPARSE_MATRIX_BUILDER_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexSparseMatrix.hpp"
+
+enum class HexDuplicatePolicy
+{
+	Sum,		// Duplicates are added together, which is what most assembly codes expect
+	LastWins,	// The value that was added last overwrites the previous ones, like setValue does
+	Max		// Only the highest value is kept, the one of highest magnitude for complex values
+};
+
+template<typename Value = qreal, typename Index = qint32>
+struct HexBasicRowColumnValueTriplet
+{
+	Value	value = Value();
+	Index	row = 0;
+	Index	column = 0;
+	
+	HexBasicRowColumnValueTriplet(Value v = Value(), Index r = 0, Index c = 0) : value(v), row(r), column(c)
+	{
+	}
+};
+
+using HexRowColumnValueTriplet = HexBasicRowColumnValueTriplet<>;
+
+/* Calling HexSparseMatrix::setValue for every value shifts the end of the
+ * pairs and of the row offsets each time, which is quadratic. This class
+ * only collects (row, column, value) triplets, and builds the CSR arrays
+ * in one go when asked to: a stable counting sort by row, then a sort by
+ * column within each row, then a merge of duplicates which also drops the
+ * explicit zeroes. Being stable, the sort keeps the triplets of a given
+ * cell in the order they were added, which LastWins relies on. Row
+ * offsets are computed in Index, so a 64-bit Index can build matrices of
+ * more than 2^31 values.
+ */
+template<typename Value = qreal, typename Index = qint32>
+class HexBasicSparseMatrixBuilder
+{
+	private:
+	
+		static constexpr qint32							InsertionSortThreshold = 32;
+		
+		template<typename Type> inline static void				InsertionSort(Type, Type);
+		
+		inline static bool							IsGreater(Value, Value);
+		
+		std::vector<HexBasicRowColumnValueTriplet<Value, Index>>		triplets;
+		HexDuplicatePolicy							policy = HexDuplicatePolicy::Sum;
+		
+		Index									minimumNumberOfRows = 0;
+		Index									minimumNumberOfColumns = 0;
+		
+	public:
+	
+		inline									HexBasicSparseMatrixBuilder(void);
+		inline									HexBasicSparseMatrixBuilder(Index, Index);
+		
+		inline void								addValue(Index, Index, Value);
+		inline HexBasicSparseMatrix<Value, Index>				build(void) const;
+		inline void								clear(void);
+		inline qint64								getNumberOfValues(void) const;
+		inline void								reserve(qint64);
+		inline void								setDuplicatePolicy(HexDuplicatePolicy);
+};
+
+using HexSparseMatrixBuilder = HexBasicSparseMatrixBuilder<>;
+
+template<typename Value, typename Index>
+HexBasicSparseMatrixBuilder<Value, Index>::HexBasicSparseMatrixBuilder(void)
+{
+}
+
+/* The matrix that gets built is at least this large, even
+ * if its last rows or columns only contain zeroes.
+ */
+template<typename Value, typename Index>
+HexBasicSparseMatrixBuilder<Value, Index>::HexBasicSparseMatrixBuilder(Index nor, Index noc) : minimumNumberOfRows(qMax(nor, Index(0))), minimumNumberOfColumns(qMax(noc, Index(0)))
+{
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixBuilder<Value, Index>::addValue(Index row, Index column, Value value)
+{
+	if (row < 0 or column < 0)
+		return;
+	
+	HexBasicSparseMatrixBuilder::triplets.emplace_back(value, row, column);
+}
+
+template<typename Value, typename Index>
+HexBasicSparseMatrix<Value, Index> HexBasicSparseMatrixBuilder<Value, Index>::build(void) const
+{
+	auto numberOfRows = HexBasicSparseMatrixBuilder::minimumNumberOfRows;
+	
+	for (const auto& triplet : HexBasicSparseMatrixBuilder::triplets)
+	{
+		if (triplet.row >= numberOfRows)
+			numberOfRows = triplet.row + 1;
+	}
+	
+	const auto numberOfTriplets = static_cast<qint64>(HexBasicSparseMatrixBuilder::triplets.size());
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfTriplets);
+	
+	auto rowCounts = std::vector<std::vector<Index>>(numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread) // Every thread counts the rows of its own slice of triplets...
+	{
+		const auto first = numberOfTriplets*thread/numberOfThreads;
+		const auto last = numberOfTriplets*(thread + 1)/numberOfThreads;
+		
+		auto& counts = rowCounts[thread];
+		counts.assign(numberOfRows, 0);
+		
+		for (auto index = first; index < last; ++index)
+			++counts[HexBasicSparseMatrixBuilder::triplets[index].row];
+	});
+	
+	auto rowOffsets = std::vector<Index>(numberOfRows + 1, 0);
+	auto position = Index(0);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row) // ... and these counts become the place where it writes each row, slice after slice.
+	{
+		rowOffsets[row] = position;
+		
+		for (auto& counts : rowCounts)
+		{
+			const auto count = counts[row];
+			counts[row] = position;
+			position += count;
+		}
+	}
+	
+	rowOffsets[numberOfRows] = position;
+	auto sortedPairs = std::vector<HexBasicColumnValuePair<Value, Index>>(numberOfTriplets);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto first = numberOfTriplets*thread/numberOfThreads;
+		const auto last = numberOfTriplets*(thread + 1)/numberOfThreads;
+		
+		auto& positions = rowCounts[thread];
+		
+		for (auto index = first; index < last; ++index)
+		{
+			const auto& triplet = HexBasicSparseMatrixBuilder::triplets[index];
+			sortedPairs[positions[triplet.row]] = HexBasicColumnValuePair<Value, Index>(triplet.value, triplet.column);
+			++positions[triplet.row];
+		}
+	});
+	
+	rowCounts.clear();
+	
+	const auto boundaries = HexParallel::PartitionOffsets(rowOffsets, numberOfThreads);
+	auto newRowCounts = std::vector<Index>(numberOfRows, 0);
+	auto highestColumns = std::vector<Index>(numberOfThreads, -1);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			const auto beg = sortedPairs.begin() + rowOffsets[row];
+			const auto end = sortedPairs.begin() + rowOffsets[row + 1];
+			
+			if (end - beg < HexBasicSparseMatrixBuilder::InsertionSortThreshold)
+				HexBasicSparseMatrixBuilder::InsertionSort(beg, end);
+			else
+				std::stable_sort(beg, end, [](const auto& pr1, const auto& pr2) { return pr1.column < pr2.column; });
+			
+			auto out = beg;
+			
+			for (auto it = beg; it != end; )
+			{
+				auto merged = *it;
+				
+				for (++it; it != end and it->column == merged.column; ++it)
+				{
+					if (HexBasicSparseMatrixBuilder::policy == HexDuplicatePolicy::Sum)
+						merged.value += it->value;
+					else if (HexBasicSparseMatrixBuilder::policy == HexDuplicatePolicy::LastWins or HexBasicSparseMatrixBuilder::IsGreater(it->value, merged.value))
+						merged.value = it->value;
+				}
+				
+				if (merged.value != Value())
+				{
+					*out = merged;
+					++out;
+				}
+			}
+			
+			newRowCounts[row] = static_cast<Index>(out - beg);
+			
+			if (out != beg and (out - 1)->column > highestColumns[thread])
+				highestColumns[thread] = (out - 1)->column;
+		}
+	});
+	
+	auto numberOfColumns = HexBasicSparseMatrixBuilder::minimumNumberOfColumns;
+	
+	for (const auto& column : highestColumns)
+		numberOfColumns = qMax(numberOfColumns, column + 1);
+	
+	while (numberOfRows > HexBasicSparseMatrixBuilder::minimumNumberOfRows and newRowCounts[numberOfRows - 1] == 0) // Rows that only held zeroes don't count, just like with setValue.
+		--numberOfRows;
+	
+	auto newRowOffsets = std::vector<Index>(numberOfRows + 1, 0);
+	
+	for (auto row = Index(0); row < numberOfRows; ++row)
+		newRowOffsets[row + 1] = newRowOffsets[row] + newRowCounts[row];
+	
+	if (newRowOffsets.back() == numberOfTriplets) // Nothing was merged nor dropped, so the sorted pairs are already the final ones.
+		return HexBasicSparseMatrix<Value, Index>(std::move(sortedPairs), std::move(newRowOffsets), numberOfColumns);
+	
+	auto pairs = std::vector<HexBasicColumnValuePair<Value, Index>>(newRowOffsets.back());
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto lastRow = qMin(boundaries[thread + 1], numberOfRows);
+		
+		for (auto row = boundaries[thread]; row < lastRow; ++row)
+		{
+			const auto beg = sortedPairs.cbegin() + rowOffsets[row];
+			std::copy(beg, beg + newRowCounts[row], pairs.begin() + newRowOffsets[row]);
+		}
+	});
+	
+	return HexBasicSparseMatrix<Value, Index>(std::move(pairs), std::move(newRowOffsets), numberOfColumns);
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixBuilder<Value, Index>::clear(void)
+{
+	HexBasicSparseMatrixBuilder::triplets.clear();
+}
+
+template<typename Value, typename Index>
+qint64 HexBasicSparseMatrixBuilder<Value, Index>::getNumberOfValues(void) const
+{
+	return static_cast<qint64>(HexBasicSparseMatrixBuilder::triplets.size());
+}
+
+/* Most rows only hold a handful of values, for which std::stable_sort
+ * and its temporary buffer would be overkill. This sort is stable too.
+ */
+template<typename Value, typename Index>
+template<typename Type>
+void HexBasicSparseMatrixBuilder<Value, Index>::InsertionSort(Type beg, Type end)
+{
+	if (beg == end)
+		return;
+	
+	for (auto it = beg + 1; it != end; ++it)
+	{
+		const auto pr = *it;
+		auto itt = it;
+		
+		while (itt != beg and (itt - 1)->column > pr.column)
+		{
+			*itt = *(itt - 1);
+			--itt;
+		}
+		
+		*itt = pr;
+	}
+}
+
+/* Complex values have no order, so Max keeps the one of highest magnitude.
+ */
+template<typename Value, typename Index>
+bool HexBasicSparseMatrixBuilder<Value, Index>::IsGreater(Value value1, Value value2)
+{
+	if constexpr (std::is_same_v<Value, typename HexScalarTraits<Value>::Real>)
+		return (value1 > value2);
+	else
+		return (HexScalarTraits<Value>::SquaredMagnitude(value1) > HexScalarTraits<Value>::SquaredMagnitude(value2));
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixBuilder<Value, Index>::reserve(qint64 numberOfValues)
+{
+	HexBasicSparseMatrixBuilder::triplets.reserve(numberOfValues);
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixBuilder<Value, Index>::setDuplicatePolicy(HexDuplicatePolicy pol)
+{
+	HexBasicSparseMatrixBuilder::policy = pol;
+}
+
+#endif
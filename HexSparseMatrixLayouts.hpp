@@ -0,0 +1,423 @@
+#ifndef __HEX_SPARSE_MATRIX_LAYOUTS_HPP__
+#define __HEX_SPARSE_MATRIX_LAYOUTS_HPP__
+
+// Standard Libraries
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+template<typename Value, typename Index>
+struct HexBasicColumnValuePair
+{
+	Value	value = Value();
+	Index	column = 0;
+	
+	HexBasicColumnValuePair(Value v = Value(), Index c = 0) : value(v), column(c)
+	{
+	}
+};
+
+using HexColumnValuePair = HexBasicColumnValuePair<qreal, qint32>;
+
+/* Tying these two values together means that one single vector is
+ * parsed when reading a row, but a qreal and a qint32 take 16 bytes
+ * together once aligned, so a quarter of every pair is padding. This
+ * is why the way pairs are stored is a policy of HexBasicSparseMatrix:
+ *
+ *  - HexInterleavedLayout stores the pairs above as they are,
+ *  - HexPackedLayout drops the padding (12 bytes per pair), at the
+ *    cost of misaligned values,
+ *  - HexSplitLayout stores the values and the columns in two separate
+ *    vectors, which is what SIMD gathers want.
+ *
+ * Whatever the layout, the pairs can always be read through
+ * it->value and it->column, so algorithms don't need to care.
+ * The benchmark target times the kernels on all three layouts.
+ */
+
+#pragma pack(push, 4)
+
+template<typename Value, typename Index>
+struct HexPackedColumnValuePair
+{
+	Value	value = Value();
+	Index	column = 0;
+	
+	HexPackedColumnValuePair(Value v = Value(), Index c = 0) : value(v), column(c)
+	{
+	}
+	
+	HexPackedColumnValuePair(const HexBasicColumnValuePair<Value, Index>& pr) : value(pr.value), column(pr.column)
+	{
+	}
+	
+	operator HexBasicColumnValuePair<Value, Index>(void) const
+	{
+		return HexBasicColumnValuePair<Value, Index>(value, column);
+	}
+};
+
+#pragma pack(pop)
+
+/* A pair of references into the two vectors of HexSplitPairs,
+ * which behaves like a HexBasicColumnValuePair as far as possible.
+ */
+template<typename ValueType, typename ColumnType>
+struct HexSplitReference
+{
+	using Pair = HexBasicColumnValuePair<std::remove_const_t<ValueType>, std::remove_const_t<ColumnType>>;
+	
+	ValueType&	value;
+	ColumnType&	column;
+	
+	HexSplitReference(ValueType& v, ColumnType& c) : value(v), column(c)
+	{
+	}
+	
+	HexSplitReference(const HexSplitReference&) = default;
+	
+	template<typename OtherValueType, typename OtherColumnType>
+	HexSplitReference(const HexSplitReference<OtherValueType, OtherColumnType>& ref) : value(ref.value), column(ref.column)
+	{
+	}
+	
+	HexSplitReference& operator=(const HexSplitReference& ref) // Assigning writes through, it never rebinds.
+	{
+		value = ref.value;
+		column = ref.column;
+		
+		return *this;
+	}
+	
+	template<typename OtherValueType, typename OtherColumnType>
+	HexSplitReference& operator=(const HexSplitReference<OtherValueType, OtherColumnType>& ref)
+	{
+		value = ref.value;
+		column = ref.column;
+		
+		return *this;
+	}
+	
+	HexSplitReference& operator=(const Pair& pr)
+	{
+		value = pr.value;
+		column = pr.column;
+		
+		return *this;
+	}
+	
+	operator Pair(void) const
+	{
+		return Pair(value, column);
+	}
+	
+	HexSplitReference* operator->(void)
+	{
+		return this;
+	}
+	
+	friend void swap(HexSplitReference ref1, HexSplitReference ref2)
+	{
+		std::swap(ref1.value, ref2.value);
+		std::swap(ref1.column, ref2.column);
+	}
+};
+
+template<typename ValueType, typename ColumnType>
+class HexSplitIterator
+{
+	private:
+	
+		ValueType*					value = nullptr;
+		ColumnType*					column = nullptr;
+		
+		template<typename, typename> friend class	HexSplitIterator;
+		
+	public:
+	
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = HexBasicColumnValuePair<std::remove_const_t<ValueType>, std::remove_const_t<ColumnType>>;
+		using difference_type = std::ptrdiff_t;
+		using reference = HexSplitReference<ValueType, ColumnType>;
+		using pointer = HexSplitReference<ValueType, ColumnType>;
+		
+		HexSplitIterator(void)
+		{
+		}
+		
+		HexSplitIterator(ValueType* v, ColumnType* c) : value(v), column(c)
+		{
+		}
+		
+		template<typename OtherValueType, typename OtherColumnType>
+		HexSplitIterator(const HexSplitIterator<OtherValueType, OtherColumnType>& it) : value(it.value), column(it.column)
+		{
+		}
+		
+		reference operator*(void) const { return reference(*value, *column); }
+		pointer operator->(void) const { return pointer(*value, *column); }
+		reference operator[](difference_type n) const { return reference(value[n], column[n]); }
+		
+		HexSplitIterator& operator++(void) { ++value; ++column; return *this; }
+		HexSplitIterator& operator--(void) { --value; --column; return *this; }
+		HexSplitIterator operator++(int) { auto it = *this; ++(*this); return it; }
+		HexSplitIterator operator--(int) { auto it = *this; --(*this); return it; }
+		
+		HexSplitIterator& operator+=(difference_type n) { value += n; column += n; return *this; }
+		HexSplitIterator& operator-=(difference_type n) { value -= n; column -= n; return *this; }
+		
+		friend HexSplitIterator operator+(HexSplitIterator it, difference_type n) { return it += n; }
+		friend HexSplitIterator operator+(difference_type n, HexSplitIterator it) { return it += n; }
+		friend HexSplitIterator operator-(HexSplitIterator it, difference_type n) { return it -= n; }
+		friend difference_type operator-(const HexSplitIterator& it1, const HexSplitIterator& it2) { return it1.column - it2.column; }
+		
+		friend bool operator==(const HexSplitIterator& it1, const HexSplitIterator& it2) { return it1.column == it2.column; }
+		friend auto operator<=>(const HexSplitIterator& it1, const HexSplitIterator& it2) { return it1.column <=> it2.column; }
+};
+
+/* The structure-of-arrays container behind HexSplitLayout. Its interface
+ * is the part of std::vector that HexBasicSparseMatrix uses, and its
+ * values() and columns() give direct access to the two raw arrays.
+ */
+template<typename Value, typename Index>
+class HexSplitPairs
+{
+	private:
+	
+		std::vector<Value>						vals;
+		std::vector<Index>						cols;
+		
+	public:
+	
+		using value_type = HexBasicColumnValuePair<Value, Index>;
+		using size_type = std::size_t;
+		using reference = HexSplitReference<Value, Index>;
+		using const_reference = HexSplitReference<const Value, const Index>;
+		using iterator = HexSplitIterator<Value, Index>;
+		using const_iterator = HexSplitIterator<const Value, const Index>;
+		
+		inline							HexSplitPairs(void);
+		inline explicit						HexSplitPairs(size_type);
+		
+		inline reference					operator[](size_type);
+		inline const_reference					operator[](size_type) const;
+		
+		inline iterator						begin(void);
+		inline const_iterator					begin(void) const;
+		inline const_iterator					cbegin(void) const;
+		inline const_iterator					cend(void) const;
+		inline void						clear(void);
+		inline const Index*					columns(void) const;
+		template<typename... Types> inline iterator		emplace(const_iterator, Types&&...);
+		template<typename... Types> inline void			emplace_back(Types&&...);
+		inline bool						empty(void) const;
+		inline iterator						end(void);
+		inline const_iterator					end(void) const;
+		inline iterator						erase(const_iterator);
+		template<typename Type> inline iterator			insert(const_iterator, Type, Type);
+		inline void						push_back(const value_type&);
+		inline void						reserve(size_type);
+		inline void						resize(size_type);
+		inline size_type					size(void) const;
+		inline void						swap(HexSplitPairs&);
+		inline const Value*					values(void) const;
+};
+
+template<typename Value, typename Index>
+HexSplitPairs<Value, Index>::HexSplitPairs(void)
+{
+}
+
+template<typename Value, typename Index>
+HexSplitPairs<Value, Index>::HexSplitPairs(size_type n) : vals(n, Value()), cols(n, 0)
+{
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::reference HexSplitPairs<Value, Index>::operator[](size_type index)
+{
+	return reference(HexSplitPairs::vals[index], HexSplitPairs::cols[index]);
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::const_reference HexSplitPairs<Value, Index>::operator[](size_type index) const
+{
+	return const_reference(HexSplitPairs::vals[index], HexSplitPairs::cols[index]);
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::iterator HexSplitPairs<Value, Index>::begin(void)
+{
+	return iterator(HexSplitPairs::vals.data(), HexSplitPairs::cols.data());
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::const_iterator HexSplitPairs<Value, Index>::begin(void) const
+{
+	return HexSplitPairs::cbegin();
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::const_iterator HexSplitPairs<Value, Index>::cbegin(void) const
+{
+	return const_iterator(HexSplitPairs::vals.data(), HexSplitPairs::cols.data());
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::const_iterator HexSplitPairs<Value, Index>::cend(void) const
+{
+	return HexSplitPairs::cbegin() + static_cast<std::ptrdiff_t>(HexSplitPairs::cols.size());
+}
+
+template<typename Value, typename Index>
+void HexSplitPairs<Value, Index>::clear(void)
+{
+	HexSplitPairs::vals.clear();
+	HexSplitPairs::cols.clear();
+}
+
+template<typename Value, typename Index>
+const Index* HexSplitPairs<Value, Index>::columns(void) const
+{
+	return HexSplitPairs::cols.data();
+}
+
+template<typename Value, typename Index>
+template<typename... Types>
+typename HexSplitPairs<Value, Index>::iterator HexSplitPairs<Value, Index>::emplace(const_iterator position, Types&&... args)
+{
+	const auto pr = value_type(std::forward<Types>(args)...);
+	const auto index = position - HexSplitPairs::cbegin();
+	
+	HexSplitPairs::vals.insert(HexSplitPairs::vals.begin() + index, pr.value);
+	HexSplitPairs::cols.insert(HexSplitPairs::cols.begin() + index, pr.column);
+	
+	return HexSplitPairs::begin() + index;
+}
+
+template<typename Value, typename Index>
+template<typename... Types>
+void HexSplitPairs<Value, Index>::emplace_back(Types&&... args)
+{
+	HexSplitPairs::push_back(value_type(std::forward<Types>(args)...));
+}
+
+template<typename Value, typename Index>
+bool HexSplitPairs<Value, Index>::empty(void) const
+{
+	return HexSplitPairs::cols.empty();
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::iterator HexSplitPairs<Value, Index>::end(void)
+{
+	return HexSplitPairs::begin() + static_cast<std::ptrdiff_t>(HexSplitPairs::cols.size());
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::const_iterator HexSplitPairs<Value, Index>::end(void) const
+{
+	return HexSplitPairs::cend();
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::iterator HexSplitPairs<Value, Index>::erase(const_iterator position)
+{
+	const auto index = position - HexSplitPairs::cbegin();
+	
+	HexSplitPairs::vals.erase(HexSplitPairs::vals.begin() + index);
+	HexSplitPairs::cols.erase(HexSplitPairs::cols.begin() + index);
+	
+	return HexSplitPairs::begin() + index;
+}
+
+template<typename Value, typename Index>
+template<typename Type>
+typename HexSplitPairs<Value, Index>::iterator HexSplitPairs<Value, Index>::insert(const_iterator position, Type first, Type last)
+{
+	const auto index = position - HexSplitPairs::cbegin();
+	
+	auto newValues = std::vector<Value>();
+	auto newColumns = std::vector<Index>();
+	
+	for (auto it = first; it != last; ++it)
+	{
+		const auto pr = static_cast<value_type>(*it);
+		
+		newValues.push_back(pr.value);
+		newColumns.push_back(pr.column);
+	}
+	
+	HexSplitPairs::vals.insert(HexSplitPairs::vals.begin() + index, newValues.cbegin(), newValues.cend());
+	HexSplitPairs::cols.insert(HexSplitPairs::cols.begin() + index, newColumns.cbegin(), newColumns.cend());
+	
+	return HexSplitPairs::begin() + index;
+}
+
+template<typename Value, typename Index>
+void HexSplitPairs<Value, Index>::push_back(const value_type& pr)
+{
+	HexSplitPairs::vals.push_back(pr.value);
+	HexSplitPairs::cols.push_back(pr.column);
+}
+
+template<typename Value, typename Index>
+void HexSplitPairs<Value, Index>::reserve(size_type n)
+{
+	HexSplitPairs::vals.reserve(n);
+	HexSplitPairs::cols.reserve(n);
+}
+
+template<typename Value, typename Index>
+void HexSplitPairs<Value, Index>::resize(size_type n)
+{
+	HexSplitPairs::vals.resize(n, Value());
+	HexSplitPairs::cols.resize(n, 0);
+}
+
+template<typename Value, typename Index>
+typename HexSplitPairs<Value, Index>::size_type HexSplitPairs<Value, Index>::size(void) const
+{
+	return HexSplitPairs::cols.size();
+}
+
+template<typename Value, typename Index>
+void HexSplitPairs<Value, Index>::swap(HexSplitPairs& other)
+{
+	HexSplitPairs::vals.swap(other.vals);
+	HexSplitPairs::cols.swap(other.cols);
+}
+
+template<typename Value, typename Index>
+const Value* HexSplitPairs<Value, Index>::values(void) const
+{
+	return HexSplitPairs::vals.data();
+}
+
+/* Layouts are templates on the value and index types of the matrix,
+ * so that the same policy works for floats, complex numbers and
+ * 64-bit indexes alike.
+ */
+
+struct HexInterleavedLayout
+{
+	template<typename Value, typename Index> using Container = std::vector<HexBasicColumnValuePair<Value, Index>>;
+};
+
+struct HexPackedLayout
+{
+	template<typename Value, typename Index> using Container = std::vector<HexPackedColumnValuePair<Value, Index>>;
+};
+
+struct HexSplitLayout
+{
+	template<typename Value, typename Index> using Container = HexSplitPairs<Value, Index>;
+};
+
+#endif
@@ -0,0 +1,783 @@
+#ifndef __HEX_SPARSE_MATRIX_VIEW_HPP__
+#define __HEX_SPARSE_MATRIX_VIEW_HPP__
+
+// Standard Libraries
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Qt Libraries
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexParallel.hpp"
+#include "HexScalarTraits.hpp"
+#include "HexSparseMatrix.hpp"
+
+/* A file holds this header, then the row offsets, the columns and the
+ * values, as arrays of the Index and Value types of the matrix, each
+ * starting on a multiple of 64 bytes so that they can be used in place
+ * once mapped. Every section has its own checksum, and so does the header.
+ * Files are written in the byte order of the machine, and are refused by
+ * machines of the other one, rather than swapped.
+ */
+struct HexSparseMatrixFileHeader
+{
+	char	magic[8] = {'H', 'E', 'X', 'S', 'P', 'M', 'A', 'T'};
+	quint32	version = 0;
+	quint32	byteOrder = 0;		// ByteOrderMark, as stored by the machine that wrote the file
+	quint32	valueSize = 0;
+	quint32	valueKind = 0;		// 0 for integers, 1 for real floating point values, 2 for complex ones
+	quint32	indexSize = 0;
+	quint32	reserved = 0;
+	qint64	numberOfRows = 0;
+	qint64	numberOfColumns = 0;
+	qint64	numberOfValues = 0;
+	qint64	rowOffsetsPosition = 0;
+	qint64	columnsPosition = 0;
+	qint64	valuesPosition = 0;
+	quint64	rowOffsetsChecksum = 0;
+	quint64	columnsChecksum = 0;
+	quint64	valuesChecksum = 0;
+	quint64	headerChecksum = 0;	// Checksum of the header with this field set to zero
+};
+
+/* This is a read-only HexBasicSparseMatrix over a file written by Save,
+ * which is mapped rather than read: opening it only checks the header, and
+ * pages are loaded by the system as the products touch them, so that even
+ * matrices larger than memory open in no time. The checksums of the
+ * sections are only checked by verify, which has to read everything.
+ *
+ * A damaged file can pass open, so the row offsets and columns are checked
+ * before their first use, once, and only then trusted: on a file whose
+ * structure is broken, products leave y alone, and getDenseMatrix,
+ * getSparseMatrix and transposed return empty matrices, rather than access
+ * memory outside of the mapping.
+ *
+ * Products, scalar, getDenseMatrix and the conversions to
+ * HexBasicSparseMatrix all work on the mapped arrays, and the transposed
+ * product is computed from them directly as well, without building the
+ * transpose.
+ */
+template<typename Value = qreal, typename Index = qint32>
+class HexBasicSparseMatrixView
+{
+	public:
+	
+		using Accumulator = typename HexScalarTraits<Value>::Accumulator;
+		using IndexType = Index;
+		using ValueType = Value;
+		
+		static constexpr quint32						Version = 1;
+		
+	private:
+	
+		static constexpr quint32						ByteOrderMark = 0x01020304;
+		static constexpr qint64							ChecksumBlockSize = 1 << 20;
+		static constexpr qint64							SectionAlignment = 64;
+		static constexpr quint32						ValueKind = (std::is_floating_point_v<Value> ? 1 : (std::is_floating_point_v<typename HexScalarTraits<Value>::Real> ? 2 : 0));
+		
+		inline static qint64							Align(qint64);
+		inline static quint64							Checksum(const uchar*, qint64);
+		inline static quint64							ChecksumOfBlock(const uchar*, qint64, quint64);
+		inline static quint64							ChecksumOfHeader(HexSparseMatrixFileHeader);
+		
+		QFile									file;
+		uchar*									memory = nullptr;
+		HexSparseMatrixFileHeader						header;
+		
+		const Index*								rowOffsets = nullptr;
+		const Index*								columns = nullptr;
+		const Value*								values = nullptr;
+		
+		Index									numberOfRows = 0;
+		Index									numberOfColumns = 0;
+		
+		mutable std::atomic<qint8>						validStructure = 0;	// 1 or -1 once hasValidStructure has checked the file, 0 before
+		
+		template<typename Type> inline void					accumulateTransposed(Value, const std::vector<Value>&, std::vector<Type>&) const;
+		inline bool								hasValidStructure(void) const;
+		
+	public:
+	
+		inline									HexBasicSparseMatrixView(void);
+		inline explicit								HexBasicSparseMatrixView(const QString&);
+		inline									~HexBasicSparseMatrixView(void);
+		
+		template<typename Layout> inline static bool				Save(const HexBasicSparseMatrix<Value, Index, Layout>&, const QString&);
+		
+		inline void								close(void);
+		inline const Index*							getColumns(void) const;
+		inline std::vector<Value>						getDenseMatrix(void) const;
+		inline Index								getNumberOfColumns(void) const;
+		inline Index								getNumberOfRows(void) const;
+		inline qint64								getNumberOfValues(void) const;
+		inline const Index*							getRowOffsets(void) const;
+		template<typename Layout = HexInterleavedLayout> inline auto		getSparseMatrix(void) const;
+		inline const Value*							getValues(void) const;
+		inline bool								isOpen(void) const;
+		inline void								multiply(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiply(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline void								multiplyTransposed(const std::vector<Value>&, std::vector<Value>&) const;
+		inline void								multiplyTransposed(Value, const std::vector<Value>&, Value, std::vector<Value>&) const;
+		inline bool								open(const QString&);
+		inline Accumulator							scalar(Index, Index) const;
+		template<typename Layout = HexInterleavedLayout> inline auto		transposed(void) const;
+		inline bool								verify(void) const;
+};
+
+using HexSparseMatrixView = HexBasicSparseMatrixView<>;
+
+template<typename Value, typename Index>
+HexBasicSparseMatrixView<Value, Index>::HexBasicSparseMatrixView(void)
+{
+}
+
+template<typename Value, typename Index>
+HexBasicSparseMatrixView<Value, Index>::HexBasicSparseMatrixView(const QString& fileName)
+{
+	HexBasicSparseMatrixView::open(fileName);
+}
+
+template<typename Value, typename Index>
+HexBasicSparseMatrixView<Value, Index>::~HexBasicSparseMatrixView(void)
+{
+	HexBasicSparseMatrixView::close();
+}
+
+/* Same as HexBasicSparseMatrix::accumulateTransposed, on the mapped arrays.
+ */
+template<typename Value, typename Index>
+template<typename Type>
+void HexBasicSparseMatrixView<Value, Index>::accumulateTransposed(Value alpha, const std::vector<Value>& x, std::vector<Type>& y) const
+{
+	const auto numberOfValues = HexBasicSparseMatrixView::getNumberOfValues();
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfValues);
+	const auto boundaries = HexParallel::PartitionOffsets(std::span<const Index>(HexBasicSparseMatrixView::rowOffsets, HexBasicSparseMatrixView::numberOfRows + 1), numberOfThreads);
+	
+	const auto scatter = [&](Index firstRow, Index lastRow, auto add)
+	{
+		for (auto row = firstRow; row < lastRow; ++row)
+		{
+			const auto coeff = static_cast<Type>(alpha)*static_cast<Type>(x[row]);
+			
+			for (auto index = HexBasicSparseMatrixView::rowOffsets[row]; index < HexBasicSparseMatrixView::rowOffsets[row + 1]; ++index)
+				add(HexBasicSparseMatrixView::columns[index], coeff*static_cast<Type>(HexBasicSparseMatrixView::values[index]));
+		}
+	};
+	
+	if (numberOfThreads < 2)
+	{
+		scatter(0, HexBasicSparseMatrixView::numberOfRows, [&y](Index column, Type value) { y[column] += value; });
+		return;
+	}
+	
+	if (static_cast<qint64>(numberOfThreads)*HexBasicSparseMatrixView::numberOfColumns > numberOfValues)
+	{
+		HexParallel::Run(numberOfThreads, [&](qint32 thread)
+		{
+			scatter(boundaries[thread], boundaries[thread + 1], [&y](Index column, Type value) { HexScalarTraits<Type>::AtomicAdd(y[column], value); });
+		});
+		
+		return;
+	}
+	
+	auto partialResults = std::vector<std::vector<Type>>(numberOfThreads);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		auto& partialResult = partialResults[thread];
+		partialResult.assign(HexBasicSparseMatrixView::numberOfColumns, Type());
+		
+		scatter(boundaries[thread], boundaries[thread + 1], [&partialResult](Index column, Type value) { partialResult[column] += value; });
+	});
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread) // The reduction is split by columns, so that no two threads write to the same place.
+	{
+		const auto firstColumn = static_cast<Index>(static_cast<qint64>(HexBasicSparseMatrixView::numberOfColumns)*thread/numberOfThreads);
+		const auto lastColumn = static_cast<Index>(static_cast<qint64>(HexBasicSparseMatrixView::numberOfColumns)*(thread + 1)/numberOfThreads);
+		
+		for (const auto& partialResult : partialResults)
+		{
+			for (auto column = firstColumn; column < lastColumn; ++column)
+				y[column] += partialResult[column];
+		}
+	});
+}
+
+template<typename Value, typename Index>
+qint64 HexBasicSparseMatrixView<Value, Index>::Align(qint64 position)
+{
+	return (position + HexBasicSparseMatrixView::SectionAlignment - 1)/HexBasicSparseMatrixView::SectionAlignment*HexBasicSparseMatrixView::SectionAlignment;
+}
+
+/* Sections are checksummed by blocks of ChecksumBlockSize bytes, which are
+ * independent of each other, so that verify can split them between threads,
+ * and Save can compute them as it writes, with a buffer of a single block.
+ */
+template<typename Value, typename Index>
+quint64 HexBasicSparseMatrixView<Value, Index>::Checksum(const uchar* data, qint64 size)
+{
+	const auto numberOfBlocks = (size + HexBasicSparseMatrixView::ChecksumBlockSize - 1)/HexBasicSparseMatrixView::ChecksumBlockSize;
+	const auto numberOfThreads = static_cast<qint32>(qMin(static_cast<qint64>(HexParallel::GetNumberOfThreads(size/8)), qMax(numberOfBlocks, static_cast<qint64>(1))));
+	
+	auto partialChecksums = std::vector<quint64>(numberOfThreads, 0);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto lastBlock = numberOfBlocks*(thread + 1)/numberOfThreads;
+		
+		for (auto block = numberOfBlocks*thread/numberOfThreads; block < lastBlock; ++block)
+		{
+			const auto start = block*HexBasicSparseMatrixView::ChecksumBlockSize;
+			partialChecksums[thread] += HexBasicSparseMatrixView::ChecksumOfBlock(data + start, qMin(HexBasicSparseMatrixView::ChecksumBlockSize, size - start), static_cast<quint64>(block));
+		}
+	});
+	
+	auto checksum = static_cast<quint64>(0);
+	
+	for (const auto partialChecksum : partialChecksums)
+		checksum += partialChecksum;
+	
+	return checksum;
+}
+
+/* Four independent multiply-xorshift lanes over 8-byte words, so that the
+ * multiplications of one word don't wait for those of the previous one.
+ * It catches torn writes, truncations and flipped bits, it isn't meant to
+ * stand up to anyone crafting a file on purpose.
+ */
+template<typename Value, typename Index>
+quint64 HexBasicSparseMatrixView<Value, Index>::ChecksumOfBlock(const uchar* data, qint64 size, quint64 block)
+{
+	constexpr auto Multiplier = static_cast<quint64>(0xFF51AFD7ED558CCDull);
+	
+	const auto mix = [](quint64 hash, quint64 word)
+	{
+		hash = (hash ^ word)*Multiplier;
+		return hash ^ (hash >> 29);
+	};
+	
+	auto lanes = std::array<quint64, 4>();
+	auto index = static_cast<qint64>(0);
+	
+	for (auto lane = std::size_t(0); lane < lanes.size(); ++lane)
+		lanes[lane] = (block*lanes.size() + lane + 1)*0x9E3779B97F4A7C15ull;
+	
+	for (; index + 32 <= size; index += 32)
+	{
+		for (auto lane = std::size_t(0); lane < lanes.size(); ++lane)
+		{
+			auto word = static_cast<quint64>(0);
+			
+			std::memcpy(&word, data + index + 8*lane, 8);
+			lanes[lane] = mix(lanes[lane], word);
+		}
+	}
+	
+	for (; index < size; index += 8)
+	{
+		auto word = static_cast<quint64>(0);
+		
+		std::memcpy(&word, data + index, static_cast<std::size_t>(qMin(static_cast<qint64>(8), size - index)));
+		lanes[0] = mix(lanes[0], word);
+	}
+	
+	auto hash = static_cast<quint64>(size);
+	
+	for (const auto lane : lanes)
+		hash = mix(hash, lane);
+	
+	return hash;
+}
+
+template<typename Value, typename Index>
+quint64 HexBasicSparseMatrixView<Value, Index>::ChecksumOfHeader(HexSparseMatrixFileHeader header)
+{
+	header.headerChecksum = 0;
+	return HexBasicSparseMatrixView::ChecksumOfBlock(reinterpret_cast<const uchar*>(&header), sizeof(header), 0);
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixView<Value, Index>::close(void)
+{
+	if (HexBasicSparseMatrixView::memory != nullptr)
+		HexBasicSparseMatrixView::file.unmap(HexBasicSparseMatrixView::memory);
+	
+	HexBasicSparseMatrixView::file.close();
+	
+	HexBasicSparseMatrixView::memory = nullptr;
+	HexBasicSparseMatrixView::header = HexSparseMatrixFileHeader();
+	HexBasicSparseMatrixView::rowOffsets = nullptr;
+	HexBasicSparseMatrixView::columns = nullptr;
+	HexBasicSparseMatrixView::values = nullptr;
+	HexBasicSparseMatrixView::numberOfRows = 0;
+	HexBasicSparseMatrixView::numberOfColumns = 0;
+	HexBasicSparseMatrixView::validStructure = 0;
+}
+
+template<typename Value, typename Index>
+const Index* HexBasicSparseMatrixView<Value, Index>::getColumns(void) const
+{
+	return HexBasicSparseMatrixView::columns;
+}
+
+template<typename Value, typename Index>
+std::vector<Value> HexBasicSparseMatrixView<Value, Index>::getDenseMatrix(void) const
+{
+	if (not HexBasicSparseMatrixView::hasValidStructure())
+		return {};
+	
+	const auto numberOfColumns = static_cast<std::size_t>(HexBasicSparseMatrixView::numberOfColumns);
+	auto matrix = std::vector<Value>(static_cast<std::size_t>(HexBasicSparseMatrixView::numberOfRows)*numberOfColumns, Value());
+	
+	for (auto row = Index(0); row < HexBasicSparseMatrixView::numberOfRows; ++row)
+		for (auto index = HexBasicSparseMatrixView::rowOffsets[row]; index < HexBasicSparseMatrixView::rowOffsets[row + 1]; ++index)
+			matrix[static_cast<std::size_t>(row)*numberOfColumns + static_cast<std::size_t>(HexBasicSparseMatrixView::columns[index])] = HexBasicSparseMatrixView::values[index];
+	
+	return matrix;
+}
+
+template<typename Value, typename Index>
+Index HexBasicSparseMatrixView<Value, Index>::getNumberOfColumns(void) const
+{
+	return HexBasicSparseMatrixView::numberOfColumns;
+}
+
+template<typename Value, typename Index>
+Index HexBasicSparseMatrixView<Value, Index>::getNumberOfRows(void) const
+{
+	return HexBasicSparseMatrixView::numberOfRows;
+}
+
+template<typename Value, typename Index>
+qint64 HexBasicSparseMatrixView<Value, Index>::getNumberOfValues(void) const
+{
+	return HexBasicSparseMatrixView::header.numberOfValues;
+}
+
+template<typename Value, typename Index>
+const Index* HexBasicSparseMatrixView<Value, Index>::getRowOffsets(void) const
+{
+	return HexBasicSparseMatrixView::rowOffsets;
+}
+
+/* This copies the mapped arrays into a HexBasicSparseMatrix, which is all
+ * loading a file takes: there is nothing to parse.
+ */
+template<typename Value, typename Index>
+template<typename Layout>
+auto HexBasicSparseMatrixView<Value, Index>::getSparseMatrix(void) const
+{
+	using Matrix = HexBasicSparseMatrix<Value, Index, Layout>;
+	using ColumnValuePair = typename Matrix::ColumnValuePair;
+	
+	if (not HexBasicSparseMatrixView::hasValidStructure())
+		return Matrix();
+	
+	const auto numberOfValues = HexBasicSparseMatrixView::getNumberOfValues();
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfValues);
+	
+	auto pairs = typename Matrix::Container(numberOfValues);
+	auto newRowOffsets = std::vector<Index>(HexBasicSparseMatrixView::rowOffsets, HexBasicSparseMatrixView::rowOffsets + HexBasicSparseMatrixView::numberOfRows + 1);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto last = numberOfValues*(thread + 1)/numberOfThreads;
+		
+		for (auto index = numberOfValues*thread/numberOfThreads; index < last; ++index)
+			pairs[index] = ColumnValuePair(HexBasicSparseMatrixView::values[index], HexBasicSparseMatrixView::columns[index]);
+	});
+	
+	return Matrix(std::move(pairs), std::move(newRowOffsets), HexBasicSparseMatrixView::numberOfColumns);
+}
+
+template<typename Value, typename Index>
+const Value* HexBasicSparseMatrixView<Value, Index>::getValues(void) const
+{
+	return HexBasicSparseMatrixView::values;
+}
+
+/* Row offsets have to go up, and columns to be those of the matrix, which
+ * together with both ends of the row offsets, checked by open, keep every
+ * access inside the mapping. This reads all of them, on as many threads as
+ * the products use, the first time only: the answer is kept until close.
+ */
+template<typename Value, typename Index>
+bool HexBasicSparseMatrixView<Value, Index>::hasValidStructure(void) const
+{
+	if (HexBasicSparseMatrixView::validStructure != 0)
+		return (HexBasicSparseMatrixView::validStructure > 0);
+	
+	const auto numberOfValues = HexBasicSparseMatrixView::getNumberOfValues();
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(numberOfValues);
+	const auto numberOfColumns = HexBasicSparseMatrixView::numberOfColumns;
+	
+	auto valid = std::atomic<bool>(true);
+	
+	for (auto row = Index(0); row < HexBasicSparseMatrixView::numberOfRows and valid; ++row)
+		if (HexBasicSparseMatrixView::rowOffsets[row] > HexBasicSparseMatrixView::rowOffsets[row + 1])
+			valid = false;
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		const auto last = numberOfValues*(thread + 1)/numberOfThreads;
+		
+		for (auto index = numberOfValues*thread/numberOfThreads; index < last and valid.load(std::memory_order_relaxed); ++index)
+			if (HexBasicSparseMatrixView::columns[index] < 0 or HexBasicSparseMatrixView::columns[index] >= numberOfColumns)
+				valid.store(false, std::memory_order_relaxed);
+	});
+	
+	HexBasicSparseMatrixView::validStructure = (valid ? 1 : -1);
+	return valid;
+}
+
+template<typename Value, typename Index>
+bool HexBasicSparseMatrixView<Value, Index>::isOpen(void) const
+{
+	return (HexBasicSparseMatrixView::memory != nullptr);
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixView<Value, Index>::multiply(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBasicSparseMatrixView::multiply(Value(1), x, Value(), y);
+}
+
+/* Same as HexBasicSparseMatrix::multiply, y = alpha*A*x + beta*y, on the
+ * mapped arrays. The first product on a freshly opened file is slower, as
+ * it is the one that loads the pages.
+ */
+template<typename Value, typename Index>
+void HexBasicSparseMatrixView<Value, Index>::multiply(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBasicSparseMatrixView::numberOfColumns) or not HexBasicSparseMatrixView::hasValidStructure())
+		return;
+	
+	y.resize(HexBasicSparseMatrixView::numberOfRows, Value());
+	
+	const auto numberOfThreads = HexParallel::GetNumberOfThreads(HexBasicSparseMatrixView::getNumberOfValues());
+	const auto boundaries = HexParallel::PartitionOffsets(std::span<const Index>(HexBasicSparseMatrixView::rowOffsets, HexBasicSparseMatrixView::numberOfRows + 1), numberOfThreads);
+	
+	const auto accumulatedAlpha = static_cast<Accumulator>(alpha);
+	
+	HexParallel::Run(numberOfThreads, [&](qint32 thread)
+	{
+		for (auto row = boundaries[thread]; row < boundaries[thread + 1]; ++row)
+		{
+			const auto stopIndex = HexBasicSparseMatrixView::rowOffsets[row + 1];
+			auto sum = Accumulator();
+			
+			for (auto index = HexBasicSparseMatrixView::rowOffsets[row]; index < stopIndex; ++index)
+				sum += static_cast<Accumulator>(HexBasicSparseMatrixView::values[index])*static_cast<Accumulator>(x[HexBasicSparseMatrixView::columns[index]]);
+			
+			y[row] = HexScalarTraits<Value>::UpdateOutput(accumulatedAlpha*sum, beta, y[row]);
+		}
+	});
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixView<Value, Index>::multiplyTransposed(const std::vector<Value>& x, std::vector<Value>& y) const
+{
+	HexBasicSparseMatrixView::multiplyTransposed(Value(1), x, Value(), y);
+}
+
+template<typename Value, typename Index>
+void HexBasicSparseMatrixView<Value, Index>::multiplyTransposed(Value alpha, const std::vector<Value>& x, Value beta, std::vector<Value>& y) const
+{
+	if (x.size() < static_cast<std::size_t>(HexBasicSparseMatrixView::numberOfRows) or not HexBasicSparseMatrixView::hasValidStructure())
+		return;
+	
+	y.resize(HexBasicSparseMatrixView::numberOfColumns, Value());
+	
+	for (auto& val : y)
+		val = HexScalarTraits<Value>::ScaleOutput(beta, val);
+	
+	if (HexBasicSparseMatrixView::getNumberOfValues() < 1)
+		return;
+	
+	if constexpr (std::is_same_v<Accumulator, Value>)
+		HexBasicSparseMatrixView::accumulateTransposed(alpha, x, y);
+	else // Sums are taken in Accumulator precision, so y gets widened for the time of the product.
+	{
+		auto accumulatedY = std::vector<Accumulator>(y.cbegin(), y.cend());
+		HexBasicSparseMatrixView::accumulateTransposed(alpha, x, accumulatedY);
+		
+		std::transform(accumulatedY.cbegin(), accumulatedY.cend(), y.begin(), [](Accumulator val) { return static_cast<Value>(val); });
+	}
+}
+
+/* Everything in the header is checked against the file and the types of
+ * this view, including its own checksum, as well as both ends of the row
+ * offsets, but not the sections as a whole, which is what verify is for.
+ * Anything wrong leaves the view closed.
+ */
+template<typename Value, typename Index>
+bool HexBasicSparseMatrixView<Value, Index>::open(const QString& fileName)
+{
+	HexBasicSparseMatrixView::close();
+	HexBasicSparseMatrixView::file.setFileName(fileName);
+	
+	if (not HexBasicSparseMatrixView::file.open(QIODevice::ReadOnly))
+		return false;
+	
+	const auto fileSize = HexBasicSparseMatrixView::file.size();
+	
+	if (fileSize < static_cast<qint64>(sizeof(HexSparseMatrixFileHeader)) or (HexBasicSparseMatrixView::memory = HexBasicSparseMatrixView::file.map(0, fileSize)) == nullptr)
+	{
+		HexBasicSparseMatrixView::close();
+		return false;
+	}
+	
+	auto& header = HexBasicSparseMatrixView::header;
+	std::memcpy(&header, HexBasicSparseMatrixView::memory, sizeof(header));
+	
+	const auto maximumIndex = static_cast<qint64>(std::numeric_limits<Index>::max());
+	const auto fits = [fileSize](qint64 position, qint64 count, qint64 size) { return position >= 0 and position%HexBasicSparseMatrixView::SectionAlignment == 0 and position <= fileSize and count <= (fileSize - position)/size; };
+	
+	auto valid = (std::memcmp(header.magic, HexSparseMatrixFileHeader().magic, sizeof(header.magic)) == 0);
+	valid = valid and header.version == HexBasicSparseMatrixView::Version and header.byteOrder == HexBasicSparseMatrixView::ByteOrderMark;
+	valid = valid and header.valueSize == sizeof(Value) and header.valueKind == HexBasicSparseMatrixView::ValueKind and header.indexSize == sizeof(Index);
+	valid = valid and header.headerChecksum == HexBasicSparseMatrixView::ChecksumOfHeader(header);
+	valid = valid and header.numberOfRows >= 0 and header.numberOfRows < maximumIndex and header.numberOfColumns >= 0 and header.numberOfColumns <= maximumIndex;
+	valid = valid and header.numberOfValues >= 0 and header.numberOfValues <= maximumIndex;
+	valid = valid and fits(header.rowOffsetsPosition, header.numberOfRows + 1, sizeof(Index)) and fits(header.columnsPosition, header.numberOfValues, sizeof(Index)) and fits(header.valuesPosition, header.numberOfValues, sizeof(Value));
+	
+	if (valid)
+	{
+		HexBasicSparseMatrixView::rowOffsets = reinterpret_cast<const Index*>(HexBasicSparseMatrixView::memory + header.rowOffsetsPosition);
+		HexBasicSparseMatrixView::columns = reinterpret_cast<const Index*>(HexBasicSparseMatrixView::memory + header.columnsPosition);
+		HexBasicSparseMatrixView::values = reinterpret_cast<const Value*>(HexBasicSparseMatrixView::memory + header.valuesPosition);
+		
+		valid = (HexBasicSparseMatrixView::rowOffsets[0] == 0 and static_cast<qint64>(HexBasicSparseMatrixView::rowOffsets[header.numberOfRows]) == header.numberOfValues);
+	}
+	
+	if (not valid)
+	{
+		HexBasicSparseMatrixView::close();
+		return false;
+	}
+	
+	HexBasicSparseMatrixView::numberOfRows = static_cast<Index>(header.numberOfRows);
+	HexBasicSparseMatrixView::numberOfColumns = static_cast<Index>(header.numberOfColumns);
+	
+	return true;
+}
+
+/* The file is written in one sequential pass, through a buffer of a single
+ * checksum block, so that saving needs no more memory than a megabyte on top
+ * of the matrix, whatever its layout. The header goes last, once all the
+ * checksums are known: a file whose writing was interrupted has a blank
+ * header, and is refused by open.
+ */
+template<typename Value, typename Index>
+template<typename Layout>
+bool HexBasicSparseMatrixView<Value, Index>::Save(const HexBasicSparseMatrix<Value, Index, Layout>& matrix, const QString& fileName)
+{
+	const auto& pairs = matrix.getPairs();
+	const auto& matrixRowOffsets = matrix.getRowOffsets();
+	
+	auto header = HexSparseMatrixFileHeader();
+	
+	header.version = HexBasicSparseMatrixView::Version;
+	header.byteOrder = HexBasicSparseMatrixView::ByteOrderMark;
+	header.valueSize = sizeof(Value);
+	header.valueKind = HexBasicSparseMatrixView::ValueKind;
+	header.indexSize = sizeof(Index);
+	header.numberOfRows = matrix.getNumberOfRows();
+	header.numberOfColumns = matrix.getNumberOfColumns();
+	header.numberOfValues = static_cast<qint64>(pairs.size());
+	header.rowOffsetsPosition = HexBasicSparseMatrixView::Align(sizeof(header));
+	header.columnsPosition = HexBasicSparseMatrixView::Align(header.rowOffsetsPosition + (header.numberOfRows + 1)*static_cast<qint64>(sizeof(Index)));
+	header.valuesPosition = HexBasicSparseMatrixView::Align(header.columnsPosition + header.numberOfValues*static_cast<qint64>(sizeof(Index)));
+	
+	auto file = QFile(fileName);
+	
+	if (not file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	
+	auto buffer = std::vector<uchar>();
+	auto position = static_cast<qint64>(0);
+	auto checksum = static_cast<quint64>(0);
+	auto block = static_cast<quint64>(0);
+	auto written = true;
+	
+	buffer.reserve(HexBasicSparseMatrixView::ChecksumBlockSize);
+	
+	const auto flush = [&](void)
+	{
+		const auto size = static_cast<qint64>(buffer.size());
+		
+		checksum += HexBasicSparseMatrixView::ChecksumOfBlock(buffer.data(), size, block++);
+		written = written and file.write(reinterpret_cast<const char*>(buffer.data()), size) == size;
+		position += size;
+		buffer.clear();
+	};
+	
+	const auto append = [&](const void* data, qint64 size)
+	{
+		auto bytes = static_cast<const uchar*>(data);
+		
+		while (size > 0)
+		{
+			const auto length = qMin(size, HexBasicSparseMatrixView::ChecksumBlockSize - static_cast<qint64>(buffer.size()));
+			
+			buffer.insert(buffer.end(), bytes, bytes + length);
+			bytes += length;
+			size -= length;
+			
+			if (static_cast<qint64>(buffer.size()) == HexBasicSparseMatrixView::ChecksumBlockSize)
+				flush();
+		}
+	};
+	
+	const auto startSection = [&](qint64 sectionPosition) // Pads the file up to the section with zeroes, which no checksum covers.
+	{
+		const auto padding = std::vector<char>(sectionPosition - position, 0);
+		
+		written = written and file.write(padding.data(), static_cast<qint64>(padding.size())) == static_cast<qint64>(padding.size());
+		position = sectionPosition;
+		checksum = 0;
+		block = 0;
+	};
+	
+	const auto endSection = [&](void)
+	{
+		if (not buffer.empty())
+			flush();
+		
+		return checksum;
+	};
+	
+	startSection(header.rowOffsetsPosition);
+	
+	if (matrixRowOffsets.empty()) // A matrix that was never written to has no row offsets at all.
+	{
+		const auto zero = Index(0);
+		append(&zero, sizeof(zero));
+	}
+	else
+		append(matrixRowOffsets.data(), static_cast<qint64>(matrixRowOffsets.size()*sizeof(Index)));
+	
+	header.rowOffsetsChecksum = endSection();
+	startSection(header.columnsPosition);
+	
+	for (const auto& pr : pairs)
+	{
+		const auto column = static_cast<Index>(pr.column);
+		append(&column, sizeof(column));
+	}
+	
+	header.columnsChecksum = endSection();
+	startSection(header.valuesPosition);
+	
+	for (const auto& pr : pairs)
+	{
+		const auto value = static_cast<Value>(pr.value);
+		append(&value, sizeof(value));
+	}
+	
+	header.valuesChecksum = endSection();
+	header.headerChecksum = HexBasicSparseMatrixView::ChecksumOfHeader(header);
+	
+	written = written and file.seek(0) and file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == static_cast<qint64>(sizeof(header));
+	file.close();
+	
+	return written;
+}
+
+/* This is the scalar product of two rows, the first one conjugated, which
+ * HexBasicSparseMatrix used to compute for Gram-Schmidt, merged over the
+ * columns of both rows, which are in increasing order. Rows outside of the
+ * matrix, or a broken file, give zero.
+ */
+template<typename Value, typename Index>
+typename HexBasicSparseMatrixView<Value, Index>::Accumulator HexBasicSparseMatrixView<Value, Index>::scalar(Index row1, Index row2) const
+{
+	const auto numberOfRows = HexBasicSparseMatrixView::numberOfRows;
+	
+	if (row1 < 0 or row1 >= numberOfRows or row2 < 0 or row2 >= numberOfRows or not HexBasicSparseMatrixView::hasValidStructure())
+		return Accumulator();
+	
+	const auto end1 = HexBasicSparseMatrixView::rowOffsets[row1 + 1];
+	const auto end2 = HexBasicSparseMatrixView::rowOffsets[row2 + 1];
+	
+	auto index2 = HexBasicSparseMatrixView::rowOffsets[row2];
+	auto result = Accumulator();
+	
+	for (auto index1 = HexBasicSparseMatrixView::rowOffsets[row1]; index1 < end1 and index2 < end2; ++index1)
+	{
+		const auto column = HexBasicSparseMatrixView::columns[index1];
+		
+		while (index2 < end2 and HexBasicSparseMatrixView::columns[index2] < column)
+			++index2;
+		
+		if (index2 < end2 and HexBasicSparseMatrixView::columns[index2] == column)
+			result += HexScalarTraits<Accumulator>::Conjugate(static_cast<Accumulator>(HexBasicSparseMatrixView::values[index1]))*static_cast<Accumulator>(HexBasicSparseMatrixView::values[index2]);
+	}
+	
+	return result;
+}
+
+/* Transposing copies the matrix out of the file, with the same counting
+ * sort as HexBasicSparseMatrix, reading every mapped row once. Products
+ * by the transpose don't need it, see multiplyTransposed.
+ */
+template<typename Value, typename Index>
+template<typename Layout>
+auto HexBasicSparseMatrixView<Value, Index>::transposed(void) const
+{
+	using Matrix = HexBasicSparseMatrix<Value, Index, Layout>;
+	using ColumnValuePair = typename Matrix::ColumnValuePair;
+	
+	if (not HexBasicSparseMatrixView::hasValidStructure())
+		return Matrix();
+	
+	const auto numberOfColumns = HexBasicSparseMatrixView::numberOfColumns;
+	const auto numberOfValues = HexBasicSparseMatrixView::getNumberOfValues();
+	
+	auto pairs = typename Matrix::Container(numberOfValues);
+	auto newRowOffsets = std::vector<Index>(numberOfColumns + 1, 0);
+	
+	for (auto index = qint64(0); index < numberOfValues; ++index)
+		++newRowOffsets[HexBasicSparseMatrixView::columns[index] + 1];
+	
+	for (auto column = Index(0); column < numberOfColumns; ++column)
+		newRowOffsets[column + 1] += newRowOffsets[column];
+	
+	auto positions = std::vector<Index>(newRowOffsets.cbegin(), newRowOffsets.cend() - 1);
+	
+	for (auto row = Index(0); row < HexBasicSparseMatrixView::numberOfRows; ++row)
+		for (auto index = HexBasicSparseMatrixView::rowOffsets[row]; index < HexBasicSparseMatrixView::rowOffsets[row + 1]; ++index)
+			pairs[positions[HexBasicSparseMatrixView::columns[index]]++] = ColumnValuePair(HexBasicSparseMatrixView::values[index], row);
+	
+	return Matrix(std::move(pairs), std::move(newRowOffsets), HexBasicSparseMatrixView::numberOfRows);
+}
+
+/* This reads the whole file, on as many threads as it is worth, and
+ * compares every section with its checksum, then checks that the row
+ * offsets and columns do describe a matrix.
+ */
+template<typename Value, typename Index>
+bool HexBasicSparseMatrixView<Value, Index>::verify(void) const
+{
+	if (not HexBasicSparseMatrixView::isOpen())
+		return false;
+	
+	const auto& header = HexBasicSparseMatrixView::header;
+	const auto memory = HexBasicSparseMatrixView::memory;
+	
+	return HexBasicSparseMatrixView::Checksum(memory + header.rowOffsetsPosition, (header.numberOfRows + 1)*static_cast<qint64>(sizeof(Index))) == header.rowOffsetsChecksum
+		and HexBasicSparseMatrixView::Checksum(memory + header.columnsPosition, header.numberOfValues*static_cast<qint64>(sizeof(Index))) == header.columnsChecksum
+		and HexBasicSparseMatrixView::Checksum(memory + header.valuesPosition, header.numberOfValues*static_cast<qint64>(sizeof(Value))) == header.valuesChecksum
+		and HexBasicSparseMatrixView::hasValidStructure();
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef __HEX_VERSIONED_CACHE_HPP__
+#define __HEX_VERSIONED_CACHE_HPP__
+
+// Standard Libraries
+#include <memory>
+#include <mutex>
+
+// Qt Libraries
+#include <QtGlobal>
+
+/* This keeps something computed from an object until that object changes.
+ * The object counts its own changes and passes the count as a version:
+ * whenever the version the value was built from isn't the current one, the
+ * value is built again. Const methods of the object may ask for the value
+ * from several threads at once, hence the mutex, and the value is handed
+ * out as a shared pointer so that a rebuild never pulls it from under a
+ * reader. Copies share the value, moves leave the source empty.
+ */
+template<typename Type>
+class HexVersionedCache
+{
+	private:
+	
+		mutable std::mutex							mutex;
+		std::shared_ptr<Type>							value;
+		quint64									version = 0;
+		
+	public:
+	
+		inline									HexVersionedCache(void);
+		inline									HexVersionedCache(const HexVersionedCache&);
+		inline									HexVersionedCache(HexVersionedCache&&);
+		
+		inline HexVersionedCache&						operator=(const HexVersionedCache&);
+		inline HexVersionedCache&						operator=(HexVersionedCache&&);
+		
+		template<typename Function> inline std::shared_ptr<const Type>		get(quint64, Function);
+		inline std::shared_ptr<const Type>					getIfCurrent(quint64) const;
+		inline void								release(void);
+		template<typename Function> inline bool					update(quint64, quint64, Function);
+};
+
+template<typename Type>
+HexVersionedCache<Type>::HexVersionedCache(void)
+{
+}
+
+template<typename Type>
+HexVersionedCache<Type>::HexVersionedCache(const HexVersionedCache& cache)
+{
+	const auto lock = std::lock_guard(cache.mutex);
+	
+	HexVersionedCache::value = cache.value;
+	HexVersionedCache::version = cache.version;
+}
+
+template<typename Type>
+HexVersionedCache<Type>::HexVersionedCache(HexVersionedCache&& cache)
+{
+	const auto lock = std::lock_guard(cache.mutex);
+	
+	HexVersionedCache::value.swap(cache.value);
+	HexVersionedCache::version = cache.version;
+}
+
+template<typename Type>
+HexVersionedCache<Type>& HexVersionedCache<Type>::operator=(const HexVersionedCache& cache)
+{
+	if (&cache != this)
+	{
+		const auto lock = std::scoped_lock(HexVersionedCache::mutex, cache.mutex);
+		
+		HexVersionedCache::value = cache.value;
+		HexVersionedCache::version = cache.version;
+	}
+	
+	return *this;
+}
+
+template<typename Type>
+HexVersionedCache<Type>& HexVersionedCache<Type>::operator=(HexVersionedCache&& cache)
+{
+	if (&cache != this)
+	{
+		const auto lock = std::scoped_lock(HexVersionedCache::mutex, cache.mutex);
+		
+		HexVersionedCache::value = std::move(cache.value);
+		HexVersionedCache::version = cache.version;
+		cache.value.reset();
+	}
+	
+	return *this;
+}
+
+/* The value is built while holding the lock, so that threads asking
+ * for it at the same time wait for a single build rather than each
+ * doing their own. Function returns the value itself.
+ */
+template<typename Type>
+template<typename Function>
+std::shared_ptr<const Type> HexVersionedCache<Type>::get(quint64 currentVersion, Function build)
+{
+	const auto lock = std::lock_guard(HexVersionedCache::mutex);
+	
+	if (not HexVersionedCache::value or HexVersionedCache::version != currentVersion)
+	{
+		HexVersionedCache::value = std::make_shared<Type>(build());
+		HexVersionedCache::version = currentVersion;
+	}
+	
+	return HexVersionedCache::value;
+}
+
+/* For callers that only want the value if it comes for free.
+ */
+template<typename Type>
+std::shared_ptr<const Type> HexVersionedCache<Type>::getIfCurrent(quint64 currentVersion) const
+{
+	const auto lock = std::lock_guard(HexVersionedCache::mutex);
+	
+	if (HexVersionedCache::version != currentVersion)
+		return nullptr;
+	
+	return HexVersionedCache::value;
+}
+
+template<typename Type>
+void HexVersionedCache<Type>::release(void)
+{
+	const auto lock = std::lock_guard(HexVersionedCache::mutex);
+	HexVersionedCache::value.reset();
+}
+
+/* Some changes are cheaper to mirror on the value than to rebuild it for.
+ * The value is only changed in place when it is current and nobody else
+ * holds it, copies of the object included; otherwise it is dropped and
+ * the next get builds it again. Returns whether the value was kept.
+ */
+template<typename Type>
+template<typename Function>
+bool HexVersionedCache<Type>::update(quint64 oldVersion, quint64 newVersion, Function change)
+{
+	const auto lock = std::lock_guard(HexVersionedCache::mutex);
+	
+	if (not HexVersionedCache::value or HexVersionedCache::version != oldVersion or HexVersionedCache::value.use_count() > 1)
+	{
+		HexVersionedCache::value.reset();
+		return false;
+	}
+	
+	change(*HexVersionedCache::value);
+	HexVersionedCache::version = newVersion;
+	
+	return true;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef __HEX_WORKSPACE_HPP__
+#define __HEX_WORKSPACE_HPP__
+
+// Standard Libraries
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+
+// Qt Libraries
+#include <QtGlobal>
+
+/* Scratch memory for decompositions, transposes and products, which all
+ * need large temporary arrays. Given back, big blocks are kept rather
+ * than freed, and handed out again to the next request of about the
+ * same size, so that repeated factorizations of similar matrices stop
+ * paying for fresh pages every time. Small blocks are cheap to get from
+ * the system allocator and go straight to it. Threads may share a
+ * workspace. Blocks are only freed for good by release or the
+ * destructor, which must come after every container using them is gone.
+ */
+class HexWorkspace : public std::pmr::memory_resource
+{
+	private:
+	
+		static constexpr std::size_t						BlockAlignment = 64;
+		static constexpr std::size_t						MinimumCachedSize = 1 << 16;
+		
+		std::mutex								mutex;
+		std::multimap<std::size_t, void*>					freeBlocks;
+		std::unordered_map<void*, std::size_t>					sizesOfBlocksInUse;
+		std::size_t								numberOfFreeBytes = 0;
+		std::pmr::memory_resource*						upstream;
+		
+		inline void*								do_allocate(std::size_t, std::size_t) override;
+		inline void								do_deallocate(void*, std::size_t, std::size_t) override;
+		inline bool								do_is_equal(const std::pmr::memory_resource&) const noexcept override;
+		
+	public:
+	
+		inline explicit								HexWorkspace(std::pmr::memory_resource* = std::pmr::new_delete_resource());
+		inline									HexWorkspace(const HexWorkspace&) = delete;
+		inline									~HexWorkspace(void) override;
+		
+		inline HexWorkspace&							operator=(const HexWorkspace&) = delete;
+		
+		inline std::size_t							getNumberOfFreeBytes(void);
+		inline void								release(void);
+};
+
+HexWorkspace::HexWorkspace(std::pmr::memory_resource* resource) : upstream(resource)
+{
+}
+
+HexWorkspace::~HexWorkspace(void)
+{
+	HexWorkspace::release();
+}
+
+/* A free block is reused if it is at most twice as big as the request,
+ * so that a small array never sits on a huge block for nothing.
+ */
+void* HexWorkspace::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	if (bytes < HexWorkspace::MinimumCachedSize or alignment > HexWorkspace::BlockAlignment)
+		return HexWorkspace::upstream->allocate(bytes, alignment);
+	
+	const auto lock = std::lock_guard(HexWorkspace::mutex);
+	const auto it = HexWorkspace::freeBlocks.lower_bound(bytes);
+	
+	if (it != HexWorkspace::freeBlocks.end() and it->first/2 <= bytes)
+	{
+		const auto [size, block] = *it;
+		
+		HexWorkspace::freeBlocks.erase(it);
+		HexWorkspace::numberOfFreeBytes -= size;
+		HexWorkspace::sizesOfBlocksInUse.emplace(block, size);
+		
+		return block;
+	}
+	
+	auto* const block = HexWorkspace::upstream->allocate(bytes, HexWorkspace::BlockAlignment);
+	
+	HexWorkspace::sizesOfBlocksInUse.emplace(block, bytes);
+	return block;
+}
+
+void HexWorkspace::do_deallocate(void* block, std::size_t bytes, std::size_t alignment)
+{
+	if (bytes < HexWorkspace::MinimumCachedSize or alignment > HexWorkspace::BlockAlignment)
+	{
+		HexWorkspace::upstream->deallocate(block, bytes, alignment);
+		return;
+	}
+	
+	const auto lock = std::lock_guard(HexWorkspace::mutex);
+	const auto it = HexWorkspace::sizesOfBlocksInUse.find(block);
+	const auto size = it->second;
+	
+	HexWorkspace::sizesOfBlocksInUse.erase(it);
+	HexWorkspace::freeBlocks.emplace(size, block);
+	HexWorkspace::numberOfFreeBytes += size;
+}
+
+bool HexWorkspace::do_is_equal(const std::pmr::memory_resource& resource) const noexcept
+{
+	return (&resource == this);
+}
+
+std::size_t HexWorkspace::getNumberOfFreeBytes(void)
+{
+	const auto lock = std::lock_guard(HexWorkspace::mutex);
+	return HexWorkspace::numberOfFreeBytes;
+}
+
+/* Only free blocks are given back, blocks in use stay where they are.
+ */
+void HexWorkspace::release(void)
+{
+	const auto lock = std::lock_guard(HexWorkspace::mutex);
+	
+	for (const auto& [size, block] : HexWorkspace::freeBlocks)
+		HexWorkspace::upstream->deallocate(block, size, HexWorkspace::BlockAlignment);
+	
+	HexWorkspace::freeBlocks.clear();
+	HexWorkspace::numberOfFreeBytes = 0;
+}
+
+#endif
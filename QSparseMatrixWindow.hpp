@@ -244,7 +244,7 @@ void QSparseMatrixWindow::decompose(void)
 	QSparseMatrixWindow::unitaryEdit->setHtml(unitaryString);
 	QSparseMatrixWindow::triangularEdit->setHtml(triangularString);
 	
-	const auto rank = decomp.unitary.getHighestColumn() + 1;
+	const auto rank = QSparseMatrixWindow::matrix.getRank();
 	const auto rankString = "Rank " + QString::number(rank);
 	
 	const auto unitaryDimensionString = QSparseMatrixWindow::decomp.unitary.getDimensionString();
@@ -0,0 +1,308 @@
+// Standard Libraries
+#include <complex>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Qt Libraries
+#include <QtGlobal>
+
+// Custom Libraries
+#include "HexCholesky.hpp"
+#include "HexMatrixMarket.hpp"
+#include "HexOrdering.hpp"
+#include "HexSparseMatrix.hpp"
+#include "HexSparseMatrixBuilder.hpp"
+#include "HexSparseMatrixView.hpp"
+
+/* True if ordering holds every index from 0 to n - 1 exactly once.
+ */
+template<typename Index>
+static bool IsPermutation(const std::vector<Index>& ordering, Index n)
+{
+	auto seen = std::vector<bool>(n, false);
+	
+	if (static_cast<Index>(ordering.size()) != n)
+		return false;
+	
+	for (const auto index : ordering)
+	{
+		if (index < 0 or index >= n or seen[index])
+			return false;
+		
+		seen[index] = true;
+	}
+	
+	return true;
+}
+
+/* An ordering that isn't a permutation used to be written out of bounds
+ * into the inverse permutation.
+ */
+static bool TestBandwidthProfile(void)
+{
+	auto builder = HexSparseMatrixBuilder(4, 4);
+	
+	for (auto row = 0; row < 4; ++row)
+		builder.addValue(row, 3 - row, 1.);
+	
+	const auto matrix = builder.build();
+	const auto reversed = HexOrdering::GetBandwidthProfile(matrix, {3, 2, 1, 0});
+	const auto tooShort = HexOrdering::GetBandwidthProfile(matrix, {0, 1});
+	const auto outOfRange = HexOrdering::GetBandwidthProfile(matrix, {0, 1, 2, 7});
+	const auto repeated = HexOrdering::GetBandwidthProfile(matrix, {0, 1, 1, 2});
+	
+	return (reversed.bandwidth == 3 and tooShort.bandwidth == -1 and outOfRange.bandwidth == -1 and repeated.bandwidth == -1 and repeated.profile == -1);
+}
+
+/* The builder used to take qreal and qint32 only, and computed its row
+ * offsets in int. Complex values and 64-bit indexes must build the same
+ * way, Max keeping the value of highest magnitude.
+ */
+static bool TestBuilderValueAndIndexTypes(void)
+{
+	auto builder = HexBasicSparseMatrixBuilder<std::complex<qreal>, qint64>(3, 3);
+	
+	builder.setDuplicatePolicy(HexDuplicatePolicy::Max);
+	builder.addValue(0, 0, std::complex<qreal>(1., 1.));
+	builder.addValue(0, 0, std::complex<qreal>(0., 3.));
+	builder.addValue(2, 1, std::complex<qreal>(2., 0.));
+	
+	const auto matrix = builder.build();
+	const auto& pairs = matrix.getPairs();
+	
+	return (matrix.getNumberOfRows() == 3 and matrix.getRowOffsets() == std::vector<qint64>({0, 1, 1, 2}) and pairs.size() == 2 and pairs[0].value == std::complex<qreal>(0., 3.) and pairs[1].column == 1);
+}
+
+/* Supernodes used to be factorized one column at a time. They now go
+ * through tiles, panels and blocks, whose edges are all hit by a dense
+ * matrix of 301 rows, real or complex, factorized as a single supernode.
+ */
+static bool TestCholeskyBlocks(void)
+{
+	const auto test = []<typename Value>(Value offDiagonal)
+	{
+		const auto n = 301;
+		auto builder = HexBasicSparseMatrixBuilder<Value, qint32>(n, n);
+		
+		for (auto row = 0; row < n; ++row)
+		{
+			for (auto column = 0; column < n; ++column)
+			{
+				const auto distance = static_cast<qreal>(qAbs(row - column) + 1);
+				builder.addValue(row, column, (row == column ? Value(n) : (row > column ? offDiagonal : HexScalarTraits<Value>::Conjugate(offDiagonal))/Value(distance)));
+			}
+		}
+		
+		const auto matrix = builder.build();
+		auto ordering = std::vector<qint32>(n);
+		auto cholesky = HexCholesky<HexBasicSparseMatrix<Value, qint32>>();
+		
+		std::iota(ordering.begin(), ordering.end(), 0);
+		
+		if (not cholesky.analyse(matrix, ordering) or not cholesky.factorize(matrix))
+			return false;
+		
+		auto b = std::vector<Value>(n);
+		auto x = std::vector<Value>();
+		auto y = std::vector<Value>();
+		
+		for (auto row = 0; row < n; ++row)
+			b[row] = Value(static_cast<qreal>(row % 7) - 3.);
+		
+		cholesky.solve(b, x);
+		matrix.multiply(x, y);
+		
+		for (auto row = 0; row < n; ++row)
+		{
+			if (HexScalarTraits<Value>::SquaredMagnitude(y[row] - b[row]) > 1e-20)
+				return false;
+		}
+		
+		return true;
+	};
+	
+	return (test(-1.) and test(std::complex<qreal>(-0.5, 0.75)));
+}
+
+/* Householder solved R by skipping the rows with a zero diagonal, which
+ * left ||Ax - b|| at 2.5 on a wide matrix of full row rank, and A'(Ax - b)
+ * far from zero on a square matrix of rank 40. Both methods must now give
+ * a least-squares solution of either.
+ */
+static bool TestLeastSquaresRankDeficient(void)
+{
+	auto generator = std::mt19937(18);
+	auto distribution = std::uniform_real_distribution<qreal>(-1., 1.);
+	
+	const auto random = [&generator, &distribution](qint32 numberOfRows, qint32 numberOfColumns, qint32 valuesPerRow)
+	{
+		auto builder = HexSparseMatrixBuilder(numberOfRows, numberOfColumns);
+		
+		for (auto row = 0; row < numberOfRows; ++row)
+		{
+			builder.addValue(row, row % numberOfColumns, distribution(generator));
+			
+			for (auto value = 1; value < valuesPerRow; ++value)
+				builder.addValue(row, static_cast<qint32>(generator() % static_cast<quint32>(numberOfColumns)), distribution(generator));
+		}
+		
+		return builder.build();
+	};
+	
+	const auto wide = random(30, 60, 6);
+	const auto deficient = HexSparseMatrix::Multiply(random(60, 40, 4), random(40, 60, 4));
+	
+	for (const auto method : {HexQrMethod::Householder, HexQrMethod::GramSchmidt})
+	{
+		for (const auto* const matrix : {&wide, &deficient})
+		{
+			auto b = std::vector<qreal>(static_cast<std::size_t>(matrix->getNumberOfRows()));
+			auto x = std::vector<qreal>();
+			auto residual = std::vector<qreal>();
+			auto normal = std::vector<qreal>();
+			
+			for (auto& value : b)
+				value = distribution(generator);
+			
+			matrix->leastSquares(b, x, method);
+			matrix->multiply(x, residual);
+			
+			for (auto row = std::size_t(0); row < b.size(); ++row)
+				residual[row] -= b[row];
+			
+			matrix->multiplyTransposed(residual, normal);
+			
+			// Ax = b for the wide matrix, and A'(Ax - b) = 0 for both.
+			for (const auto value : (matrix == &wide ? residual : normal))
+			{
+				if (qAbs(value) > 1e-9)
+					return false;
+			}
+		}
+	}
+	
+	return true;
+}
+
+/* Read only took HexSparseMatrix, so the complex files Write makes could
+ * not be read back, and anything after the sizes on their line was ignored.
+ */
+static bool TestMatrixMarket(void)
+{
+	using Complex = std::complex<qreal>;
+	
+	const auto fileName = QString("HexMatrixMarketTest.mtx");
+	auto builder = HexBasicSparseMatrixBuilder<Complex, qint64>(3, 3);
+	
+	builder.addValue(0, 0, Complex(2., 0.));
+	builder.addValue(1, 0, Complex(1., -1.));
+	builder.addValue(0, 1, Complex(1., 1.));
+	builder.addValue(2, 2, Complex(0.5, 0.));
+	
+	const auto matrix = builder.build();
+	auto readBack = HexBasicSparseMatrix<Complex, qint64>();
+	
+	if (not HexMatrixMarket::Write(matrix, fileName, HexMatrixMarketSymmetry::Hermitian) or not HexMatrixMarket::Read(fileName, readBack))
+		return false;
+	
+	if (readBack.getRowOffsets() != matrix.getRowOffsets() or readBack.getPairs().size() != matrix.getPairs().size())
+		return false;
+	
+	for (auto index = std::size_t(0); index < matrix.getPairs().size(); ++index)
+	{
+		if (readBack.getPairs()[index].column != matrix.getPairs()[index].column or readBack.getPairs()[index].value != matrix.getPairs()[index].value)
+			return false;
+	}
+	
+	auto realMatrix = HexSparseMatrix();
+	const auto complexIntoReal = HexMatrixMarket::Read(fileName, realMatrix);
+	
+	auto file = QFile(fileName);
+	
+	if (not file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	
+	file.write("%%MatrixMarket matrix coordinate real general\n2 2 1 7\n1 1 1.5\n");
+	file.close();
+	
+	const auto trailingText = HexMatrixMarket::Read(fileName, realMatrix);
+	file.remove();
+	
+	return (not complexIntoReal and not trailingText);
+}
+
+/* Nested dissection used to peel one component of a disconnected pattern
+ * per recursion level, copying the rest each time, which ran out of memory
+ * on a diagonal matrix of 80000 rows.
+ */
+static bool TestNestedDissection(void)
+{
+	for (const auto blockSize : {1, 3})
+	{
+		const auto n = 80000;
+		auto builder = HexSparseMatrixBuilder(n, n);
+		
+		for (auto row = 0; row < n; ++row)
+			for (auto column = row - row % blockSize; column < qMin(n, row - row % blockSize + blockSize); ++column)
+				builder.addValue(row, column, 1.);
+		
+		if (not IsPermutation(HexOrdering::NestedDissection(builder.build()), n))
+			return false;
+	}
+	
+	return true;
+}
+
+/* The view was missing the scalar product of two rows, which has to match
+ * the one taken from the dense matrix, and give zero past the last row.
+ */
+static bool TestViewScalar(void)
+{
+	const auto fileName = QString("HexSparseMatrixViewTest.bin");
+	auto builder = HexSparseMatrixBuilder(3, 4);
+	
+	builder.addValue(0, 0, 1.);
+	builder.addValue(0, 2, 2.);
+	builder.addValue(0, 3, -1.);
+	builder.addValue(1, 1, 5.);
+	builder.addValue(1, 2, 3.);
+	builder.addValue(1, 3, 4.);
+	builder.addValue(2, 0, 7.);
+	
+	if (not HexSparseMatrixView::Save(builder.build(), fileName))
+		return false;
+	
+	auto view = HexSparseMatrixView(fileName);
+	const auto passed = (view.isOpen() and view.scalar(0, 1) == 2. and view.scalar(1, 2) == 0. and view.scalar(2, 0) == 7. and view.scalar(1, 1) == 50. and view.scalar(0, 3) == 0.);
+	
+	view.close();
+	QFile(fileName).remove();
+	
+	return passed;
+}
+
+/* Every test prints whether it passed, and the exit code, which ctest
+ * looks at, is 1 if any of them failed.
+ */
+int main(void)
+{
+	auto numberOfFailures = 0;
+	
+	const auto check = [&numberOfFailures](const char* name, bool passed)
+	{
+		std::printf("%-48s %s\n", name, (passed ? "passed" : "FAILED"));
+		numberOfFailures += (passed ? 0 : 1);
+	};
+	
+	check("GetBandwidthProfile on invalid orderings", TestBandwidthProfile());
+	check("Builder on complex values and qint64 indexes", TestBuilderValueAndIndexTypes());
+	check("HexCholesky on supernodes wider than a panel", TestCholeskyBlocks());
+	check("leastSquares on rank-deficient and wide matrices", TestLeastSquaresRankDeficient());
+	check("HexMatrixMarket round trip of complex values", TestMatrixMarket());
+	check("NestedDissection on block diagonal patterns", TestNestedDissection());
+	check("HexSparseMatrixView scalar products of rows", TestViewScalar());
+	
+	return (numberOfFailures == 0 ? 0 : 1);
+}